@@ -34,6 +34,10 @@ struct xdr_type {
     int   vector;
     int   array;
     int   enumeration;
+    int   boolean;
+    int   outofline;
+    char *narrow;
+    char *inlinecap;
 };
 
 struct xdr_typedef {
@@ -60,6 +64,12 @@ struct xdr_enum_entry {
 struct xdr_struct_member {
     struct xdr_type          *type;
     char                     *name;
+    int                       listctl;
+    int                       checksum;
+    int                       listarray;
+    const char               *hashtype;
+    int                       utf8;
+    const char               *inlined;
     struct xdr_struct_member *prev;
     struct xdr_struct_member *next;
 };
@@ -67,6 +77,9 @@ struct xdr_struct_member {
 struct xdr_struct {
     char                     *name;
     int                       linkedlist;
+    int                       cached;
+    int                       passthrough;
+    int                       checksummed;
     const char               *nextmember;
     struct xdr_struct_member *members;
     struct xdr_struct        *prev;
@@ -86,6 +99,9 @@ struct xdr_union {
     char                  *name;
     struct xdr_type       *pivot_type;
     char                  *pivot_name;
+    int                    cached;
+    int                    passthrough;
+    int                    checksummed;
     struct xdr_union_case *cases;
     struct xdr_union_case *default_case;
     struct xdr_union      *prev;
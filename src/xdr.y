@@ -257,17 +257,26 @@ enum_entry:
 struct_def:
     STRUCT IDENTIFIER LBRACE struct_body RBRACE
     {
-        struct xdr_struct_member *member;
+        struct xdr_struct_member *member, *self = NULL;
+        int nself = 0;
         $$ = xdr_alloc(sizeof(*$$));
         $$->name = $2;
         $$->members = $4;
 
+        /* A struct with exactly one optional pointer to its own type, as
+         * its last member, is a chain and is coded iteratively whatever the
+         * member is called.  Iterating elsewhere would reorder the wire. */
         DL_FOREACH($$->members, member)
-        if (member->type->optional && 
-            strncmp(member->name, "next", 4) == 0) {
+        if (member->type->optional &&
+            strcmp(member->type->name, $2) == 0) {
+            self = member;
+            nself++;
+        }
+
+        if (nself == 1 && self == $$->members->prev) {
             $$->linkedlist = 1;
-            $$->nextmember = member->name;
-            member->type->linkedlist = 1;
+            $$->nextmember = self->name;
+            self->type->linkedlist = 1;
         }
     }
     ;
@@ -449,6 +458,7 @@ type:
         $$ = xdr_alloc(sizeof(*$$));
         $$->name = "uint32_t";
         $$->builtin = 1;
+        $$->boolean = 1;
     }
     | STRING
     {
@@ -2,6 +2,28 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif /* if defined(__SSE2__) */
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif /* if defined(__SSSE3__) */
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif /* if defined(__AVX2__) */
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif /* if defined(__SSE4_2__) && defined(__x86_64__) */
 
 #ifndef XDRZCC_XDR_BUILTIN_H
 /* Just for in-tree builds to suppress warnings*/
@@ -17,6 +39,7 @@
 #endif /* ifndef FALSE */
 
 #define unlikely(x) __builtin_expect(!!(x), 0)
+#define likely(x)   __builtin_expect(!!(x), 1)
 #define FORCE_INLINE __attribute__((always_inline)) inline
 
 static FORCE_INLINE int
@@ -74,12 +97,608 @@ xdr_ntoh64(uint64_t value)
 #endif /* if __BYTE_ORDER == __LITTLE_ENDIAN */
 } /* xdr_ntoh64 */
 
+/*
+ * Bulk conversion of float and double arrays between host and XDR byte
+ * order, 16 bytes at a time with SSSE3, SSE2 or NEON.  dst may equal src.
+ */
+static FORCE_INLINE void
+xdr_bswap32_array(
+    void       *dst,
+    const void *src,
+    uint32_t    n)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    const char *s = src;
+    char       *d = dst;
+    uint32_t    i = 0, w;
+
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                                      4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_si128((__m128i *) (d + i * 4),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (s + i * 4)), mask));
+    }
+#elif defined(__SSE2__)
+    __m128i x;
+
+    for (; i + 4 <= n; i += 4) {
+        x = _mm_loadu_si128((const __m128i *) (s + i * 4));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *) (d + i * 4), x);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_u8((uint8_t *) (d + i * 4),
+                 vrev32q_u8(vld1q_u8((const uint8_t *) (s + i * 4))));
+    }
+#endif /* if defined(__SSSE3__) */
+
+    for (; i < n; ++i) {
+        memcpy(&w, s + i * 4, 4);
+        w = __builtin_bswap32(w);
+        memcpy(d + i * 4, &w, 4);
+    }
+#else  /* if __BYTE_ORDER == __LITTLE_ENDIAN */
+    if (dst != src) {
+        memmove(dst, src, (size_t) n * 4);
+    }
+#endif /* if __BYTE_ORDER == __LITTLE_ENDIAN */
+} /* xdr_bswap32_array */
+
+static FORCE_INLINE void
+xdr_bswap64_array(
+    void       *dst,
+    const void *src,
+    uint32_t    n)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    const char *s = src;
+    char       *d = dst;
+    uint32_t    i = 0;
+    uint64_t    w;
+
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                      0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_si128((__m128i *) (d + i * 8),
+                         _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (s + i * 8)), mask));
+    }
+#elif defined(__SSE2__)
+    __m128i x;
+
+    for (; i + 2 <= n; i += 2) {
+        x = _mm_loadu_si128((const __m128i *) (s + i * 8));
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128((__m128i *) (d + i * 8), x);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 2 <= n; i += 2) {
+        vst1q_u8((uint8_t *) (d + i * 8),
+                 vrev64q_u8(vld1q_u8((const uint8_t *) (s + i * 8))));
+    }
+#endif /* if defined(__SSSE3__) */
+
+    for (; i < n; ++i) {
+        memcpy(&w, s + i * 8, 8);
+        w = __builtin_bswap64(w);
+        memcpy(d + i * 8, &w, 8);
+    }
+#else  /* if __BYTE_ORDER == __LITTLE_ENDIAN */
+    if (dst != src) {
+        memmove(dst, src, (size_t) n * 8);
+    }
+#endif /* if __BYTE_ORDER == __LITTLE_ENDIAN */
+} /* xdr_bswap64_array */
+
 static FORCE_INLINE uint32_t
 xdr_pad(uint32_t length)
 {
     return (4 - (length & 0x3)) & 0x3;
 } /* xdr_pad */
 
+/*
+ * Payload copies of at least XDR_NT_COPY_MIN bytes use non-temporal stores
+ * where the target has them, so that a large opaque passing through the
+ * dbuf or scratch buffer does not evict the caller's working set from the
+ * cache.  Smaller copies use memcpy() and stay cache resident, as the
+ * data is usually consumed right away.  The choice is made on the size of
+ * the whole payload, so one gathered from many small iovecs is streamed
+ * too.  tests/ntcopy.c doubles as a benchmark for choosing the threshold.
+ */
+#ifndef XDR_NT_COPY_MIN
+#define XDR_NT_COPY_MIN (256 * 1024)
+#endif /* ifndef XDR_NT_COPY_MIN */
+
+static inline void
+xdr_copy_nt(
+    void       *dst,
+    const void *src,
+    size_t      len)
+{
+#if defined(__SSE2__)
+    char       *d = dst;
+    const char *s = src;
+    size_t      head;
+    __m128i     a, b, c, e;
+
+    /* Streaming stores need 16 byte aligned destinations */
+    head = -(uintptr_t) d & 15;
+
+    if (head > len) {
+        head = len;
+    }
+
+    memcpy(d, s, head);
+    d   += head;
+    s   += head;
+    len -= head;
+
+    while (len >= 64) {
+        a = _mm_loadu_si128((const __m128i *) s);
+        b = _mm_loadu_si128((const __m128i *) (s + 16));
+        c = _mm_loadu_si128((const __m128i *) (s + 32));
+        e = _mm_loadu_si128((const __m128i *) (s + 48));
+        _mm_stream_si128((__m128i *) d, a);
+        _mm_stream_si128((__m128i *) (d + 16), b);
+        _mm_stream_si128((__m128i *) (d + 32), c);
+        _mm_stream_si128((__m128i *) (d + 48), e);
+        d   += 64;
+        s   += 64;
+        len -= 64;
+    }
+
+    /* Order the streaming stores before anything that follows */
+    _mm_sfence();
+
+    memcpy(d, s, len);
+#else  /* if defined(__SSE2__) */
+    memcpy(dst, src, len);
+#endif /* if defined(__SSE2__) */
+} /* xdr_copy_nt */
+
+/* Copies one piece of a payload of 'total' bytes */
+static FORCE_INLINE void
+xdr_copy_part(
+    void       *dst,
+    const void *src,
+    size_t      len,
+    size_t      total)
+{
+    if (unlikely(total >= XDR_NT_COPY_MIN)) {
+        xdr_copy_nt(dst, src, len);
+    } else {
+        memcpy(dst, src, len);
+    }
+} /* xdr_copy_part */
+
+static FORCE_INLINE void
+xdr_copy(
+    void       *dst,
+    const void *src,
+    size_t      len)
+{
+    xdr_copy_part(dst, src, len, len);
+} /* xdr_copy */
+
+/*
+ * CRC32C (Castagnoli) of the payloads of opaque members named with -k.  The
+ * SSE4.2 or ARMv8 CRC instructions are used when the generated code is
+ * built for a target that has them, slicing-by-8 tables otherwise.  Copies
+ * are checksummed in the same pass, a word at a time with the instructions
+ * or a cache resident block at a time with the tables.
+ */
+#ifndef XDR_CRC32C_BLOCK
+#define XDR_CRC32C_BLOCK 4096
+#endif /* ifndef XDR_CRC32C_BLOCK */
+
+#if defined(__SSE4_2__) && defined(__x86_64__)
+#define XDR_CRC32C_HW 1
+#define xdr_crc32c_u64(crc, word) ((uint32_t) _mm_crc32_u64((crc), (word)))
+#define xdr_crc32c_u8(crc, byte)  _mm_crc32_u8((crc), (byte))
+#elif defined(__ARM_FEATURE_CRC32)
+#define XDR_CRC32C_HW 1
+#define xdr_crc32c_u64(crc, word) __crc32cd((crc), (word))
+#define xdr_crc32c_u8(crc, byte)  __crc32cb((crc), (byte))
+#else  /* if defined(__SSE4_2__) && defined(__x86_64__) */
+
+static uint32_t xdr_crc32c_table[8][256];
+
+static void __attribute__((constructor))
+xdr_crc32c_init(void)
+{
+    uint32_t crc;
+    int      i, j;
+
+    for (i = 0; i < 256; ++i) {
+        crc = i;
+
+        for (j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1));
+        }
+
+        xdr_crc32c_table[0][i] = crc;
+    }
+
+    for (i = 0; i < 256; ++i) {
+        for (j = 1; j < 8; ++j) {
+            crc                    = xdr_crc32c_table[j - 1][i];
+            xdr_crc32c_table[j][i] = (crc >> 8) ^ xdr_crc32c_table[0][crc & 0xff];
+        }
+    }
+} /* xdr_crc32c_init */
+
+#endif /* if defined(__SSE4_2__) && defined(__x86_64__) */
+
+/* Update a running CRC without the initial and final inversion */
+static FORCE_INLINE uint32_t
+xdr_crc32c_update(
+    uint32_t    crc,
+    const void *buf,
+    size_t      len)
+{
+    const unsigned char *p = buf;
+
+#ifdef XDR_CRC32C_HW
+    uint64_t word;
+
+    while (len >= 8) {
+        memcpy(&word, p, 8);
+        crc  = xdr_crc32c_u64(crc, word);
+        p   += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = xdr_crc32c_u8(crc, *p++);
+    }
+#else  /* ifdef XDR_CRC32C_HW */
+    uint32_t (*t)[256] = xdr_crc32c_table;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    uint32_t lo, hi;
+
+    while (len >= 8) {
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+
+        lo ^= crc;
+
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+            t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+            t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+
+        p   += 8;
+        len -= 8;
+    }
+#endif /* if __BYTE_ORDER == __LITTLE_ENDIAN */
+
+    while (len--) {
+        crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+#endif /* ifdef XDR_CRC32C_HW */
+
+    return crc;
+} /* xdr_crc32c_update */
+
+/* memcpy() that also updates a running CRC over the bytes copied */
+static FORCE_INLINE uint32_t
+xdr_crc32c_copy(
+    uint32_t    crc,
+    void       *dst,
+    const void *src,
+    size_t      len)
+{
+#ifdef XDR_CRC32C_HW
+    const unsigned char *s = src;
+    unsigned char       *d = dst;
+    uint64_t             word;
+
+    while (len >= 8) {
+        memcpy(&word, s, 8);
+        memcpy(d, &word, 8);
+        crc  = xdr_crc32c_u64(crc, word);
+        s   += 8;
+        d   += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        *d  = *s++;
+        crc = xdr_crc32c_u8(crc, *d++);
+    }
+#else  /* ifdef XDR_CRC32C_HW */
+    size_t chunk;
+
+    while (len) {
+        chunk = len < XDR_CRC32C_BLOCK ? len : XDR_CRC32C_BLOCK;
+
+        memcpy(dst, src, chunk);
+        crc = xdr_crc32c_update(crc, dst, chunk);
+
+        dst  = (char *) dst + chunk;
+        src  = (const char *) src + chunk;
+        len -= chunk;
+    }
+#endif /* ifdef XDR_CRC32C_HW */
+
+    return crc;
+} /* xdr_crc32c_copy */
+
+/* CRC32C of 'len' bytes, continuing from 'crc' (0 to start) */
+static inline uint32_t
+xdr_crc32c(
+    uint32_t    crc,
+    const void *buf,
+    size_t      len)
+{
+    return ~xdr_crc32c_update(~crc, buf, len);
+} /* xdr_crc32c */
+
+/*
+ * UTF-8 validation of typedefs named with -u, per RFC 3629: no overlong
+ * forms, surrogates or code points above U+10FFFF.  ASCII is skipped a
+ * word or vector at a time.  With SSSE3 the rest is checked 16 bytes at a
+ * time, or 32 with AVX2, using the Keiser-Lemire lookup tables, and
+ * otherwise byte by byte.
+ */
+static FORCE_INLINE int
+xdr_utf8_valid_scalar(
+    const uint8_t *p,
+    uint32_t       len)
+{
+    uint32_t i = 0;
+    uint64_t w;
+    uint8_t  c, c1;
+
+    while (i < len) {
+
+        if (i + 8 <= len) {
+            memcpy(&w, p + i, sizeof(w));
+
+            if (!(w & 0x8080808080808080ULL)) {
+                i += 8;
+                continue;
+            }
+        }
+
+        c = p[i];
+
+        if (c < 0x80) {
+            i++;
+        } else if (c >= 0xc2 && c <= 0xdf) {
+            if (len - i < 2 || (p[i + 1] & 0xc0) != 0x80) {
+                return 0;
+            }
+            i += 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            if (len - i < 3) {
+                return 0;
+            }
+
+            c1 = p[i + 1];
+
+            if ((c1 & 0xc0) != 0x80 || (p[i + 2] & 0xc0) != 0x80 ||
+                (c == 0xe0 && c1 < 0xa0) || (c == 0xed && c1 >= 0xa0)) {
+                return 0;
+            }
+            i += 3;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            if (len - i < 4) {
+                return 0;
+            }
+
+            c1 = p[i + 1];
+
+            if ((c1 & 0xc0) != 0x80 || (p[i + 2] & 0xc0) != 0x80 ||
+                (p[i + 3] & 0xc0) != 0x80 ||
+                (c == 0xf0 && c1 < 0x90) || (c == 0xf4 && c1 >= 0x90)) {
+                return 0;
+            }
+            i += 4;
+        } else {
+            return 0;
+        }
+    }
+
+    return 1;
+} /* xdr_utf8_valid_scalar */
+
+#if defined(__SSSE3__)
+
+/* Error bits of each table, see simdjson's utf8_lookup4_algorithm */
+static const uint8_t xdr_utf8_byte1_high[16] = {
+    0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+    0x80, 0x80, 0x80, 0x80, 0x21, 0x01, 0x15, 0x49
+};
+
+static const uint8_t xdr_utf8_byte1_low[16] = {
+    0xe7, 0xa3, 0x83, 0x83, 0x8b, 0xcb, 0xcb, 0xcb,
+    0xcb, 0xcb, 0xcb, 0xcb, 0xcb, 0xdb, 0xcb, 0xcb
+};
+
+static const uint8_t xdr_utf8_byte2_high[16] = {
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+    0xe6, 0xae, 0xba, 0xba, 0x01, 0x01, 0x01, 0x01
+};
+
+/* A block ending in these bytes needs continuations from the next one */
+static const uint8_t xdr_utf8_incomplete[16] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf
+};
+
+static FORCE_INLINE __m128i
+xdr_utf8_shr4(__m128i v)
+{
+    return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+} /* xdr_utf8_shr4 */
+
+/* Non-zero lanes mark errors in 'input' given the block before it */
+static FORCE_INLINE __m128i
+xdr_utf8_check_block(
+    __m128i input,
+    __m128i prev_input)
+{
+    __m128i prev1, prev2, prev3, special, must23;
+
+    prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+    special = _mm_and_si128(
+        _mm_and_si128(
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) xdr_utf8_byte1_high),
+                             xdr_utf8_shr4(prev1)),
+            _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) xdr_utf8_byte1_low),
+                             _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) xdr_utf8_byte2_high),
+                         xdr_utf8_shr4(input)));
+
+    /* Third and fourth bytes of a sequence must be continuations */
+    must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+                          _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80)));
+
+    return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char) 0x80)),
+                         special);
+} /* xdr_utf8_check_block */
+
+#if defined(__AVX2__)
+static FORCE_INLINE __m256i
+xdr_utf8_shr4_256(__m256i v)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f));
+} /* xdr_utf8_shr4_256 */
+
+static FORCE_INLINE __m256i
+xdr_utf8_table256(const uint8_t *table)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) table));
+} /* xdr_utf8_table256 */
+
+/* As xdr_utf8_check_block(), with the previous bytes carried across lanes */
+static FORCE_INLINE __m256i
+xdr_utf8_check_block256(
+    __m256i input,
+    __m256i prev_input)
+{
+    __m256i carry, prev1, prev2, prev3, special, must23;
+
+    carry = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    prev1 = _mm256_alignr_epi8(input, carry, 15);
+    prev2 = _mm256_alignr_epi8(input, carry, 14);
+    prev3 = _mm256_alignr_epi8(input, carry, 13);
+
+    special = _mm256_and_si256(
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(xdr_utf8_table256(xdr_utf8_byte1_high),
+                                xdr_utf8_shr4_256(prev1)),
+            _mm256_shuffle_epi8(xdr_utf8_table256(xdr_utf8_byte1_low),
+                                _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+        _mm256_shuffle_epi8(xdr_utf8_table256(xdr_utf8_byte2_high),
+                            xdr_utf8_shr4_256(input)));
+
+    must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+                             _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char) 0x80)),
+                            special);
+} /* xdr_utf8_check_block256 */
+#endif /* if defined(__AVX2__) */
+
+#endif /* if defined(__SSSE3__) */
+
+static FORCE_INLINE int
+xdr_utf8_valid(
+    const void *data,
+    uint32_t    len)
+{
+    const uint8_t *p = data;
+    uint32_t       i = 0;
+
+#if defined(__SSSE3__)
+    const __m128i incomplete_max = _mm_loadu_si128((const __m128i *) xdr_utf8_incomplete);
+    __m128i       input, prev = _mm_setzero_si128();
+    __m128i       error = _mm_setzero_si128(), incomplete = _mm_setzero_si128();
+    uint8_t       tail[16];
+    int           last = 0;
+
+#if defined(__AVX2__)
+    {
+        const __m256i incomplete_max256 = _mm256_inserti128_si256(
+            _mm256_set1_epi8(-1), incomplete_max, 1);
+        __m256i       input256, prev256 = _mm256_setzero_si256();
+        __m256i       error256      = _mm256_setzero_si256();
+        __m256i       incomplete256 = _mm256_setzero_si256();
+
+        for (; i + 32 <= len; i += 32) {
+            input256 = _mm256_loadu_si256((const __m256i *) (p + i));
+
+            if (!_mm256_movemask_epi8(input256)) {
+                error256 = _mm256_or_si256(error256, incomplete256);
+            } else {
+                error256 = _mm256_or_si256(error256,
+                                           xdr_utf8_check_block256(input256, prev256));
+                incomplete256 = _mm256_subs_epu8(input256, incomplete_max256);
+            }
+
+            prev256 = input256;
+        }
+
+        /* Hand the state over to the 16 byte loop for the tail */
+        error = _mm_or_si128(_mm256_castsi256_si128(error256),
+                             _mm256_extracti128_si256(error256, 1));
+        incomplete = _mm256_extracti128_si256(incomplete256, 1);
+        prev       = _mm256_extracti128_si256(prev256, 1);
+    }
+#endif /* if defined(__AVX2__) */
+
+    while (!last) {
+        if (i + 16 <= len) {
+            input = _mm_loadu_si128((const __m128i *) (p + i));
+            i    += 16;
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, p + i, len - i);
+            input = _mm_loadu_si128((const __m128i *) tail);
+            last  = 1;
+        }
+
+        if (!_mm_movemask_epi8(input)) {
+            error = _mm_or_si128(error, incomplete);
+        } else {
+            error      = _mm_or_si128(error, xdr_utf8_check_block(input, prev));
+            incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+
+        prev = input;
+    }
+
+    error = _mm_or_si128(error, incomplete);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff;
+#else  /* if defined(__SSSE3__) */
+
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (p + i)))) {
+            break;
+        }
+    }
+#endif /* if defined(__SSE2__) */
+
+    return xdr_utf8_valid_scalar(p + i, len - i);
+#endif /* if defined(__SSSE3__) */
+} /* xdr_utf8_valid */
+
 struct xdr_read_cursor {
     const xdr_iovec             *cur;
     const xdr_iovec             *last;
@@ -98,6 +717,10 @@ struct xdr_write_cursor {
     int                          scratch_used;
     int                          total;
     struct evpl_rpc2_rdma_chunk *write_chunk;
+    xdr_marshall_layout         *layout;
+    int                          npayload;
+    int                          nchunk;
+    int                          error;
 };
 
 static FORCE_INLINE void
@@ -135,7 +758,11 @@ xdr_write_cursor_init(
 
     xdr_iovec_set_len(scratch_iov, 0);
 
-    cursor->total = 0;
+    cursor->total    = 0;
+    cursor->layout   = NULL;
+    cursor->npayload = 0;
+    cursor->nchunk   = 0;
+    cursor->error    = 0;
 
 } /* xdr_write_cursor_init */
 
@@ -166,6 +793,45 @@ xdr_write_cursor_flush(struct xdr_write_cursor *cursor)
 
 } /* xdr_write_cursor_finish */
 
+/*
+ * Skip scratch space up to the next multiple of 'alignment'.  The skipped
+ * bytes are accounted to the scratch iovec but never appear in the output.
+ */
+static FORCE_INLINE void
+xdr_write_cursor_align(
+    struct xdr_write_cursor *cursor,
+    uint32_t                 alignment)
+{
+    int skip = -(uintptr_t) cursor->scratch_data & (alignment - 1);
+
+    if (unlikely(skip > cursor->scratch_size)) {
+        abort();
+    }
+
+    xdr_iovec_set_len(cursor->scratch_iov, xdr_iovec_len(cursor->scratch_iov) + skip);
+
+    cursor->scratch_data += skip;
+    cursor->scratch_size -= skip;
+} /* xdr_write_cursor_align */
+
+/* Report a payload about to be emitted at the current output position */
+static FORCE_INLINE void
+xdr_write_cursor_payload(
+    struct xdr_write_cursor *cursor,
+    uint32_t                 length)
+{
+    struct xdr_payload_layout *payload;
+
+    if (cursor->npayload < XDR_LAYOUT_MAX_PAYLOADS) {
+        payload         = &cursor->layout->payload[cursor->npayload];
+        payload->offset = cursor->total;
+        payload->length = length;
+        payload->iov    = cursor->niov;
+    }
+
+    cursor->npayload++;
+} /* xdr_write_cursor_payload */
+
 static inline int
 xdr_read_cursor_extract(
     struct xdr_read_cursor *cursor,
@@ -177,14 +843,19 @@ xdr_read_cursor_extract(
     left = bytes;
 
     while (left) {
+        /* A length running past the end of the input is malformed */
+        if (unlikely(cursor->cur > cursor->last)) {
+            return -1;
+        }
+
         chunk = xdr_iovec_len(cursor->cur) - cursor->iov_offset;
         if (left < chunk) {
             chunk = left;
         }
 
-        memcpy(out,
-               xdr_iovec_data(cursor->cur) + cursor->iov_offset,
-               chunk);
+        xdr_copy_part(out,
+                      xdr_iovec_data(cursor->cur) + cursor->iov_offset,
+                      chunk, bytes);
 
         left               -= chunk;
         out                 = (char *) out + chunk;
@@ -200,6 +871,40 @@ xdr_read_cursor_extract(
     return bytes;
 } /* xdr_read_cursor_extract */
 
+/* xdr_read_cursor_extract() updating a running CRC over the bytes copied */
+static inline uint32_t
+xdr_read_cursor_extract_crc32c(
+    struct xdr_read_cursor *cursor,
+    void                   *out,
+    unsigned int            bytes,
+    uint32_t                crc)
+{
+    unsigned int chunk;
+
+    while (bytes) {
+        chunk = xdr_iovec_len(cursor->cur) - cursor->iov_offset;
+        if (bytes < chunk) {
+            chunk = bytes;
+        }
+
+        crc = xdr_crc32c_copy(crc, out,
+                              xdr_iovec_data(cursor->cur) + cursor->iov_offset,
+                              chunk);
+
+        bytes              -= chunk;
+        out                 = (char *) out + chunk;
+        cursor->iov_offset += chunk;
+        cursor->offset     += chunk;
+
+        if (cursor->iov_offset == xdr_iovec_len(cursor->cur)) {
+            cursor->cur++;
+            cursor->iov_offset = 0;
+        }
+    }
+
+    return crc;
+} /* xdr_read_cursor_extract_crc32c */
+
 static inline void
 xdr_write_cursor_append(
     struct xdr_write_cursor *cursor,
@@ -212,11 +917,34 @@ xdr_write_cursor_append(
         abort();
     }
 
-    memcpy(cursor->scratch_data + cursor->scratch_used, in, bytes);
+    xdr_copy(cursor->scratch_data + cursor->scratch_used, in, bytes);
 
     cursor->scratch_used += bytes;
 } /* xdr_write_cursor_append */
 
+/* xdr_write_cursor_append() storing the CRC32C of the bytes to *crc if set */
+static FORCE_INLINE void
+xdr_write_cursor_append_crc32c(
+    struct xdr_write_cursor *cursor,
+    const void              *in,
+    unsigned int             bytes,
+    uint32_t                *crc)
+{
+    if (!crc) {
+        xdr_write_cursor_append(cursor, in, bytes);
+        return;
+    }
+
+    if (unlikely(cursor->scratch_used + bytes > cursor->scratch_size)) {
+        abort();
+    }
+
+    *crc = ~xdr_crc32c_copy(~0U, cursor->scratch_data + cursor->scratch_used,
+                            in, bytes);
+
+    cursor->scratch_used += bytes;
+} /* xdr_write_cursor_append_crc32c */
+
 static inline int
 xdr_read_cursor_skip(
     struct xdr_read_cursor *cursor,
@@ -224,12 +952,22 @@ xdr_read_cursor_skip(
 {
     unsigned int done, chunk;
 
-    if (cursor->iov_offset + bytes <= xdr_iovec_len(cursor->cur)) {
+    /* The cursor may already sit past the last iovec at end of message */
+    if (bytes == 0) {
+        return 0;
+    }
+
+    if (cursor->cur <= cursor->last &&
+        cursor->iov_offset + bytes <= xdr_iovec_len(cursor->cur)) {
         cursor->iov_offset += bytes;
         cursor->offset     += bytes;
     } else {
         done = 0;
         while (done < bytes) {
+            if (unlikely(cursor->cur > cursor->last)) {
+                return -1;
+            }
+
             chunk = xdr_iovec_len(cursor->cur) - cursor->iov_offset;
             if (chunk > bytes - done) {
                 chunk = bytes - done;
@@ -239,10 +977,6 @@ xdr_read_cursor_skip(
             cursor->iov_offset += chunk;
             cursor->offset     += chunk;
 
-            if (done < bytes && cursor->cur == cursor->last) {
-                abort();
-            }
-
             if (cursor->iov_offset == xdr_iovec_len(cursor->cur)) {
                 cursor->cur++;
                 cursor->iov_offset = 0;
@@ -426,12 +1160,16 @@ __unmarshall_int64_t(
     return 8;
 } /* __unmarshall_int64_t */
 
+/* Floats travel as the big-endian image of their IEEE 754 bits */
 static FORCE_INLINE void
 __marshall_float(
     const float             *v,
     struct xdr_write_cursor *cursor)
 {
-    xdr_write_cursor_append(cursor, v, 4);
+    uint32_t bits;
+
+    memcpy(&bits, v, 4);
+    __marshall_uint32_t(&bits, cursor);
 } /* __marshall_float */
 
 static FORCE_INLINE int
@@ -440,7 +1178,18 @@ __unmarshall_float(
     struct xdr_read_cursor *cursor,
     xdr_dbuf               *dbuf)
 {
-    return xdr_read_cursor_extract(cursor, v, 4);
+    uint32_t bits;
+    int      rc;
+
+    rc = __unmarshall_uint32_t(&bits, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    memcpy(v, &bits, 4);
+
+    return 4;
 } /* __unmarshall_float */
 
 static FORCE_INLINE void
@@ -448,7 +1197,10 @@ __marshall_double(
     const double            *v,
     struct xdr_write_cursor *cursor)
 {
-    xdr_write_cursor_append(cursor, v, 8);
+    uint64_t bits;
+
+    memcpy(&bits, v, 8);
+    __marshall_uint64_t(&bits, cursor);
 } /* __marshall_double */
 
 static FORCE_INLINE int
@@ -457,35 +1209,177 @@ __unmarshall_double(
     struct xdr_read_cursor *cursor,
     xdr_dbuf               *dbuf)
 {
-    return xdr_read_cursor_extract(cursor, v, 8);
+    uint64_t bits;
+    int      rc;
+
+    rc = __unmarshall_uint64_t(&bits, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    memcpy(v, &bits, 8);
+
+    return 8;
 } /* __unmarshall_double */
 
+/*
+ * Whole arrays and vectors of 32 or 64-bit words (floats, doubles and
+ * structs laid out like their wire form) are converted in bulk.  The input
+ * is swapped straight into the destination when it lies within one iovec,
+ * otherwise it is gathered first and swapped in place.
+ */
 static FORCE_INLINE void
-__marshall_xdr_string(
-    const xdr_string        *str,
+__marshall_bswap32_array(
+    const void              *v,
+    uint32_t                 n,
     struct xdr_write_cursor *cursor)
 {
-    const uint32_t zero = 0;
-    int            pad;
-
-    __marshall_uint32_t(&str->len, cursor);
+    if (unlikely(cursor->scratch_used + (uint64_t) n * 4 > cursor->scratch_size)) {
+        abort();
+    }
 
-    xdr_write_cursor_append(cursor, str->str, str->len);
+    xdr_bswap32_array(cursor->scratch_data + cursor->scratch_used, v, n);
 
-    pad = (4 - (str->len & 0x3)) & 0x3;
+    cursor->scratch_used += n * 4;
+} /* __marshall_bswap32_array */
 
-    if (pad) {
-        xdr_write_cursor_append(cursor, &zero, pad);
+static FORCE_INLINE void
+__marshall_bswap64_array(
+    const void              *v,
+    uint32_t                 n,
+    struct xdr_write_cursor *cursor)
+{
+    if (unlikely(cursor->scratch_used + (uint64_t) n * 8 > cursor->scratch_size)) {
+        abort();
     }
-} /* __marshall_xdr_string */
+
+    xdr_bswap64_array(cursor->scratch_data + cursor->scratch_used, v, n);
+
+    cursor->scratch_used += n * 8;
+} /* __marshall_bswap64_array */
 
 static FORCE_INLINE int
-__unmarshall_xdr_string(
-    xdr_string             *str,
+__unmarshall_bswap32_array(
+    void                   *v,
+    uint32_t                n,
     struct xdr_read_cursor *cursor,
     xdr_dbuf               *dbuf)
 {
-    int rc, pad, len = 0;
+    const void *in;
+    int         rc;
+
+    if (cursor->cur <= cursor->last &&
+        xdr_iovec_len(cursor->cur) - cursor->iov_offset >= (uint64_t) n * 4) {
+        in = xdr_iovec_data(cursor->cur) + cursor->iov_offset;
+        xdr_read_cursor_skip(cursor, n * 4);
+        xdr_bswap32_array(v, in, n);
+    } else {
+        rc = xdr_read_cursor_extract(cursor, v, n * 4);
+
+        if (unlikely(rc < 0)) {
+            return rc;
+        }
+
+        xdr_bswap32_array(v, v, n);
+    }
+
+    return n * 4;
+} /* __unmarshall_bswap32_array */
+
+static FORCE_INLINE int
+__unmarshall_bswap64_array(
+    void                   *v,
+    uint32_t                n,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    const void *in;
+    int         rc;
+
+    if (cursor->cur <= cursor->last &&
+        xdr_iovec_len(cursor->cur) - cursor->iov_offset >= (uint64_t) n * 8) {
+        in = xdr_iovec_data(cursor->cur) + cursor->iov_offset;
+        xdr_read_cursor_skip(cursor, n * 8);
+        xdr_bswap64_array(v, in, n);
+    } else {
+        rc = xdr_read_cursor_extract(cursor, v, n * 8);
+
+        if (unlikely(rc < 0)) {
+            return rc;
+        }
+
+        xdr_bswap64_array(v, v, n);
+    }
+
+    return n * 8;
+} /* __unmarshall_bswap64_array */
+
+static FORCE_INLINE void
+__marshall_float_array(
+    const float             *v,
+    uint32_t                 n,
+    struct xdr_write_cursor *cursor)
+{
+    __marshall_bswap32_array(v, n, cursor);
+} /* __marshall_float_array */
+
+static FORCE_INLINE void
+__marshall_double_array(
+    const double            *v,
+    uint32_t                 n,
+    struct xdr_write_cursor *cursor)
+{
+    __marshall_bswap64_array(v, n, cursor);
+} /* __marshall_double_array */
+
+static FORCE_INLINE int
+__unmarshall_float_array(
+    float                  *v,
+    uint32_t                n,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    return __unmarshall_bswap32_array(v, n, cursor, dbuf);
+} /* __unmarshall_float_array */
+
+static FORCE_INLINE int
+__unmarshall_double_array(
+    double                 *v,
+    uint32_t                n,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    return __unmarshall_bswap64_array(v, n, cursor, dbuf);
+} /* __unmarshall_double_array */
+
+
+static FORCE_INLINE void
+__marshall_xdr_string(
+    const xdr_string        *str,
+    struct xdr_write_cursor *cursor)
+{
+    const uint32_t zero = 0;
+    int            pad;
+
+    __marshall_uint32_t(&str->len, cursor);
+
+    xdr_write_cursor_append(cursor, str->str, str->len);
+
+    pad = (4 - (str->len & 0x3)) & 0x3;
+
+    if (pad) {
+        xdr_write_cursor_append(cursor, &zero, pad);
+    }
+} /* __marshall_xdr_string */
+
+static FORCE_INLINE int
+__unmarshall_xdr_string(
+    xdr_string             *str,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc, pad, len = 0;
 
     rc = __unmarshall_uint32_t(&str->len, cursor, dbuf);
 
@@ -495,7 +1389,9 @@ __unmarshall_xdr_string(
 
     len += rc;
 
-    if (xdr_iovec_len(cursor->cur) - cursor->iov_offset >= str->len) {
+    /* An empty string may end the message with the cursor past the end */
+    if (cursor->cur <= cursor->last &&
+        xdr_iovec_len(cursor->cur) - cursor->iov_offset >= str->len) {
         str->str            = xdr_iovec_data(cursor->cur) + cursor->iov_offset;
         cursor->iov_offset += str->len;
         cursor->offset     += str->len;
@@ -550,7 +1446,8 @@ __unmarshall_opaque_fixed(
     v->length = size;
     v->niov   = 0;
 
-    do {
+    /* An empty payload may end the message with the cursor past the end */
+    while (left) {
 
         xdr_iovec_set_data(&v->iov[v->niov], xdr_iovec_data(cursor->cur) +
                            cursor->iov_offset);
@@ -575,26 +1472,40 @@ __unmarshall_opaque_fixed(
 
         v->niov++;
 
-    } while (left);
+    }
 
     pad = (4 - (size & 0x3)) & 0x3;
 
-    xdr_read_cursor_skip(cursor, pad);
+    if (unlikely(xdr_read_cursor_skip(cursor, pad) < 0)) {
+        return -1;
+    }
 
     return size + pad;
 } /* __unmarshall_opaque_fixed */
 
 static FORCE_INLINE void
-__marshall_opaque(
+__marshall_opaque_crc32c(
     const xdr_opaque        *v,
     uint32_t                 bound,
+    uint32_t                *crc,
     struct xdr_write_cursor *cursor)
 {
     int      rc, pad;
     uint32_t zero = 0;
 
     __marshall_uint32_t(&v->len, cursor);
-    xdr_write_cursor_append(cursor, v->data, v->len);
+
+    if (cursor->layout && cursor->layout->alignment &&
+        v->len >= cursor->layout->alignment) {
+        xdr_write_cursor_flush(cursor);
+        xdr_write_cursor_payload(cursor, v->len);
+        xdr_write_cursor_align(cursor, cursor->layout->alignment);
+        xdr_write_cursor_append_crc32c(cursor, v->data, v->len, crc);
+        xdr_write_cursor_flush(cursor);
+        xdr_write_cursor_align(cursor, cursor->layout->alignment);
+    } else {
+        xdr_write_cursor_append_crc32c(cursor, v->data, v->len, crc);
+    }
 
     pad = (4 - (v->len & 0x3)) & 0x3;
 
@@ -602,6 +1513,15 @@ __marshall_opaque(
         xdr_write_cursor_append(cursor, &zero, pad);
     }
 
+} /* __marshall_opaque_crc32c */
+
+static FORCE_INLINE void
+__marshall_opaque(
+    const xdr_opaque        *v,
+    uint32_t                 bound,
+    struct xdr_write_cursor *cursor)
+{
+    __marshall_opaque_crc32c(v, bound, NULL, cursor);
 } /* __marshall_opaque */
 
 static FORCE_INLINE void
@@ -620,12 +1540,17 @@ __marshall_opaque_zerocopy(
         cursor->write_chunk->iov    = v->iov;
         cursor->write_chunk->niov   = v->niov;
         cursor->write_chunk->length = v->length;
+        cursor->nchunk++;
         return;
     }
  #endif /* if EVPL_RPC2 */
 
     xdr_write_cursor_flush(cursor);
 
+    if (cursor->layout) {
+        xdr_write_cursor_payload(cursor, v->length);
+    }
+
     for (i = 0; i < v->niov && left; ++i) {
 
         if (unlikely(cursor->niov + 1 > cursor->maxiov)) {
@@ -659,9 +1584,10 @@ __marshall_opaque_zerocopy(
 } /* __marshall_opaque_zerocopy */
 
 static FORCE_INLINE int
-__unmarshall_opaque(
+__unmarshall_opaque_sum(
     xdr_opaque             *v,
     uint32_t                bound,
+    uint32_t               *crc,
     struct xdr_read_cursor *cursor,
     xdr_dbuf               *dbuf)
 {
@@ -673,8 +1599,12 @@ __unmarshall_opaque(
         return rc;
     }
 
-    if (xdr_iovec_len(cursor->cur) - cursor->iov_offset >= v->len) {
+    if (cursor->cur <= cursor->last &&
+        xdr_iovec_len(cursor->cur) - cursor->iov_offset >= v->len) {
         v->data             = xdr_iovec_data(cursor->cur) + cursor->iov_offset;
+        if (crc) {
+            *crc = xdr_crc32c(0, v->data, v->len);
+        }
         cursor->iov_offset += v->len;
         cursor->offset     += v->len;
         if (cursor->iov_offset == xdr_iovec_len(cursor->cur)) {
@@ -685,13 +1615,72 @@ __unmarshall_opaque(
     } else {
         xdr_dbuf_alloc_space(v->data, v->len, dbuf);
 
-        rc = xdr_read_cursor_extract(cursor, v->data, v->len);
+        if (crc) {
+            *crc = ~xdr_read_cursor_extract_crc32c(cursor, v->data, v->len, ~0U);
+        } else {
+            rc = xdr_read_cursor_extract(cursor, v->data, v->len);
+
+            if (unlikely(rc < 0)) {
+                return rc;
+            }
+        }
+    }
+
+    pad = (4 - (v->len & 0x3)) & 0x3;
+
+    if (pad) {
+        rc = xdr_read_cursor_skip(cursor, pad);
 
         if (unlikely(rc < 0)) {
             return rc;
         }
     }
 
+    return 4 + v->len + pad;
+} /* __unmarshall_opaque_sum */
+
+static FORCE_INLINE int
+__unmarshall_opaque(
+    xdr_opaque             *v,
+    uint32_t                bound,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    return __unmarshall_opaque_sum(v, bound, NULL, cursor, dbuf);
+} /* __unmarshall_opaque */
+
+/*
+ * Opaque copied into storage inside the decoded struct (-i) when it fits,
+ * and into the dbuf when it does not, so it never refers to the wire buffer
+ */
+static FORCE_INLINE int
+__unmarshall_opaque_inline(
+    xdr_opaque             *v,
+    void                   *storage,
+    uint32_t                capacity,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc, pad;
+
+    rc = __unmarshall_uint32_t(&v->len, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    if (likely(v->len <= capacity)) {
+        v->data = storage;
+    } else {
+        xdr_dbuf_alloc_space(v->data, v->len, dbuf);
+    }
+
+    rc = xdr_read_cursor_extract(cursor, v->data, v->len);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
     pad = (4 - (v->len & 0x3)) & 0x3;
 
     if (pad) {
@@ -703,11 +1692,214 @@ __unmarshall_opaque(
     }
 
     return 4 + v->len + pad;
-} /* __unmarshall_opaque_variable_bound */
+} /* __unmarshall_opaque_inline */
+
+/* Decoded CRC32C is stored in the dbuf and referenced through *crc */
+static FORCE_INLINE int
+__unmarshall_opaque_crc32c(
+    xdr_opaque             *v,
+    uint32_t                bound,
+    uint32_t              **crc,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    xdr_dbuf_alloc_space(*crc, sizeof(**crc), dbuf);
+
+    return __unmarshall_opaque_sum(v, bound, *crc, cursor, dbuf);
+} /* __unmarshall_opaque_crc32c */
+
+/*
+ * Validate (-u) and hash (-H) a decoded value while it is still in cache,
+ * and offer it for interning
+ */
+static FORCE_INLINE int
+__unmarshall_hash_intern(
+    const char *type,
+    void      **data,
+    uint32_t    len,
+    uint64_t   *hash,
+    int         utf8,
+    xdr_dbuf   *dbuf)
+{
+    const void *interned;
+
+    if (utf8 && unlikely(!xdr_utf8_valid(*data, len))) {
+        return -1;
+    }
+
+    *hash = xdr_hash64(*data, len);
+
+    if (dbuf->intern) {
+        interned = dbuf->intern->intern(type, *data, len, *hash,
+                                        dbuf->intern->private_data);
+
+        if (unlikely(!interned)) {
+            return -1;
+        }
+
+        *data = (void *) interned;
+    }
+
+    return 0;
+} /* __unmarshall_hash_intern */
+
+static FORCE_INLINE int
+__unmarshall_xdr_string_hash(
+    xdr_string             *str,
+    const char             *type,
+    uint64_t               *hash,
+    int                     utf8,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    void *data;
+    int   rc;
+
+    rc = __unmarshall_xdr_string(str, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    data = str->str;
+
+    if (unlikely(__unmarshall_hash_intern(type, &data, str->len, hash, utf8, dbuf))) {
+        return -1;
+    }
+
+    str->str = data;
+
+    return rc;
+} /* __unmarshall_xdr_string_hash */
+
+static FORCE_INLINE int
+__unmarshall_opaque_hash(
+    xdr_opaque             *v,
+    uint32_t                bound,
+    const char             *type,
+    uint64_t               *hash,
+    int                     utf8,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc;
+
+    rc = __unmarshall_opaque(v, bound, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    if (unlikely(__unmarshall_hash_intern(type, &v->data, v->len, hash, utf8,
+                                          dbuf))) {
+        return -1;
+    }
+
+    return rc;
+} /* __unmarshall_opaque_hash */
+
+static FORCE_INLINE int
+__unmarshall_xdr_string_utf8(
+    xdr_string             *str,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc;
+
+    rc = __unmarshall_xdr_string(str, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    return likely(xdr_utf8_valid(str->str, str->len)) ? rc : -1;
+} /* __unmarshall_xdr_string_utf8 */
+
+static FORCE_INLINE int
+__unmarshall_opaque_utf8(
+    xdr_opaque             *v,
+    uint32_t                bound,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc;
+
+    rc = __unmarshall_opaque(v, bound, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    return likely(xdr_utf8_valid(v->data, v->len)) ? rc : -1;
+} /* __unmarshall_opaque_utf8 */
+
+/*
+ * Copy a zero-copy payload of 'size' bytes into the destination chosen by
+ * the dbuf's placement callback.  Returns the number of bytes consumed,
+ * 0 if the payload should be referenced in place, or -1 on error.
+ */
+static FORCE_INLINE int
+__unmarshall_opaque_place(
+    xdr_iovecr             *v,
+    uint32_t                size,
+    const char             *member,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    xdr_placement *placement = dbuf->placement;
+    xdr_iovec      iov;
+    uintptr_t      addr;
+    int            rc, pad;
+
+    /* A payload starting at the end of the input has no iovec to check */
+    if (placement->alignment && cursor->cur <= cursor->last &&
+        cursor->iov_offset + size <= xdr_iovec_len(cursor->cur)) {
+        addr = (uintptr_t) ((char *) xdr_iovec_data(cursor->cur) +
+                            cursor->iov_offset);
+
+        if ((addr & (placement->alignment - 1)) == 0) {
+            return 0;
+        }
+    }
+
+    xdr_iovec_set_data(&iov, NULL);
+    xdr_iovec_set_len(&iov, 0);
+
+    rc = placement->place(member, size, &iov, placement->private_data);
+
+    if (rc) {
+        return rc < 0 ? -1 : 0;
+    }
+
+    if (unlikely(xdr_iovec_len(&iov) < size)) {
+        return -1;
+    }
+
+    if (unlikely(xdr_read_cursor_extract(cursor, xdr_iovec_data(&iov), size) < 0)) {
+        return -1;
+    }
+
+    xdr_iovec_set_len(&iov, size);
+
+    xdr_dbuf_alloc_space(v->iov, sizeof(*v->iov), dbuf);
+
+    *v->iov   = iov;
+    v->niov   = 1;
+    v->length = size;
+
+    pad = (4 - (size & 0x3)) & 0x3;
+
+    if (unlikely(xdr_read_cursor_skip(cursor, pad) < 0)) {
+        return -1;
+    }
+
+    return size + pad;
+} /* __unmarshall_opaque_place */
 
 static FORCE_INLINE int
 __unmarshall_opaque_zerocopy(
     xdr_iovecr             *v,
+    const char             *member,
     struct xdr_read_cursor *cursor,
     xdr_dbuf               *dbuf)
 {
@@ -733,6 +1925,14 @@ __unmarshall_opaque_zerocopy(
     }
 #endif /* if EVPL_RPC2 */
 
+    if (dbuf->placement && size) {
+        rc = __unmarshall_opaque_place(v, size, member, cursor, dbuf);
+
+        if (rc) {
+            return rc < 0 ? rc : 4 + rc;
+        }
+    }
+
     rc = __unmarshall_opaque_fixed(v, size, cursor, dbuf);
 
     if (unlikely(rc < 0)) {
@@ -742,6 +1942,1190 @@ __unmarshall_opaque_zerocopy(
     return 4 + rc;
 } /* __unmarshall_opaque_variable */
 
+/*
+ * Records the input consumed since 'start' as the wire range of a
+ * passthrough value.  The slices reference the input and are allocated
+ * from the dbuf.  A value that took a payload from an RDMA read chunk is
+ * not contiguous with the input and gets no range, so it is always
+ * encoded afresh.
+ */
+static void
+__unmarshall_wire(
+    xdr_wire_range               *wire,
+    const xdr_iovec              *start,
+    unsigned int                  iov_offset,
+    unsigned int                  offset,
+    const struct xdr_read_cursor *cursor,
+    xdr_dbuf                     *dbuf)
+{
+    xdr_iovecr *v = &wire->range;
+    uint32_t    chunk, left;
+
+    wire->dirty = 0;
+    v->iov      = NULL;
+    v->niov     = 0;
+    v->length   = cursor->offset - offset;
+
+#if EVPL_RPC2
+    if (cursor->read_chunk && cursor->read_chunk->length &&
+        cursor->read_chunk->xdr_position >= offset &&
+        cursor->read_chunk->xdr_position <= cursor->offset) {
+        v->length = 0;
+    }
+#endif /* if EVPL_RPC2 */
+
+    if (!v->length) {
+        return;
+    }
+
+    xdr_dbuf_alloc_space(v->iov, sizeof(*v->iov) * ((cursor->cur - start) + 1), dbuf);
+
+    for (left = v->length; left; start++, iov_offset = 0) {
+        chunk = xdr_iovec_len(start) - iov_offset;
+
+        if (chunk > left) {
+            chunk = left;
+        }
+
+        if (!chunk) {
+            continue;
+        }
+
+        xdr_iovec_set_data(&v->iov[v->niov], (char *) xdr_iovec_data(start) + iov_offset);
+        xdr_iovec_copy_private(&v->iov[v->niov], start);
+        xdr_iovec_set_len(&v->iov[v->niov], chunk);
+
+        v->niov++;
+        left -= chunk;
+    }
+} /* __unmarshall_wire */
+
+/*
+ * Writer for marshalling straight into one contiguous buffer.  Running out
+ * of room latches overflow rather than aborting so the caller can retry
+ * with a larger buffer.
+ */
+struct xdr_flat_cursor {
+    char        *data;
+    unsigned int used;
+    unsigned int size;
+    int          overflow;
+};
+
+static FORCE_INLINE void
+xdr_flat_cursor_init(
+    struct xdr_flat_cursor *cursor,
+    void                   *buf,
+    size_t                  size)
+{
+    cursor->data     = buf;
+    cursor->used     = 0;
+    cursor->size     = size > UINT32_MAX ? UINT32_MAX : size;
+    cursor->overflow = 0;
+} /* xdr_flat_cursor_init */
+
+static FORCE_INLINE void *
+xdr_flat_cursor_reserve(
+    struct xdr_flat_cursor *cursor,
+    unsigned int            bytes)
+{
+    void *ptr;
+
+    if (unlikely(bytes > cursor->size - cursor->used)) {
+        cursor->overflow = 1;
+        return NULL;
+    }
+
+    ptr           = cursor->data + cursor->used;
+    cursor->used += bytes;
+
+    return ptr;
+} /* xdr_flat_cursor_reserve */
+
+static FORCE_INLINE void
+xdr_flat_cursor_append(
+    struct xdr_flat_cursor *cursor,
+    const void             *in,
+    unsigned int            bytes)
+{
+    if (unlikely(bytes > cursor->size - cursor->used)) {
+        cursor->overflow = 1;
+        return;
+    }
+
+    xdr_copy(cursor->data + cursor->used, in, bytes);
+
+    cursor->used += bytes;
+} /* xdr_flat_cursor_append */
+
+static FORCE_INLINE void
+xdr_flat_cursor_pad(
+    struct xdr_flat_cursor *cursor,
+    uint32_t                length)
+{
+    uint32_t pad = xdr_pad(length);
+    void    *out;
+
+    if (pad) {
+        out = xdr_flat_cursor_reserve(cursor, pad);
+
+        if (likely(out)) {
+            memset(out, 0, pad);
+        }
+    }
+} /* xdr_flat_cursor_pad */
+
+static FORCE_INLINE void
+__marshall_flat_uint32_t(
+    const uint32_t         *v,
+    struct xdr_flat_cursor *cursor)
+{
+    uint32_t out = xdr_hton32(*v);
+
+    xdr_flat_cursor_append(cursor, &out, sizeof(out));
+} /* __marshall_flat_uint32_t */
+
+static FORCE_INLINE void
+__marshall_flat_int32_t(
+    const int32_t          *v,
+    struct xdr_flat_cursor *cursor)
+{
+    int32_t out = xdr_hton32(*v);
+
+    xdr_flat_cursor_append(cursor, &out, sizeof(out));
+} /* __marshall_flat_int32_t */
+
+static FORCE_INLINE void
+__marshall_flat_uint64_t(
+    const uint64_t         *v,
+    struct xdr_flat_cursor *cursor)
+{
+    uint64_t out = xdr_hton64(*v);
+
+    xdr_flat_cursor_append(cursor, &out, sizeof(out));
+} /* __marshall_flat_uint64_t */
+
+static FORCE_INLINE void
+__marshall_flat_int64_t(
+    const int64_t          *v,
+    struct xdr_flat_cursor *cursor)
+{
+    int64_t out = xdr_hton64(*v);
+
+    xdr_flat_cursor_append(cursor, &out, sizeof(out));
+} /* __marshall_flat_int64_t */
+
+static FORCE_INLINE void
+__marshall_flat_float(
+    const float            *v,
+    struct xdr_flat_cursor *cursor)
+{
+    uint32_t bits;
+
+    memcpy(&bits, v, 4);
+    __marshall_flat_uint32_t(&bits, cursor);
+} /* __marshall_flat_float */
+
+static FORCE_INLINE void
+__marshall_flat_double(
+    const double           *v,
+    struct xdr_flat_cursor *cursor)
+{
+    uint64_t bits;
+
+    memcpy(&bits, v, 8);
+    __marshall_flat_uint64_t(&bits, cursor);
+} /* __marshall_flat_double */
+
+static FORCE_INLINE void
+__marshall_flat_bswap32_array(
+    const void             *v,
+    uint32_t                n,
+    struct xdr_flat_cursor *cursor)
+{
+    void *out = NULL;
+
+    if (likely((uint64_t) n * 4 <= cursor->size - cursor->used)) {
+        out = xdr_flat_cursor_reserve(cursor, n * 4);
+    } else {
+        cursor->overflow = 1;
+    }
+
+    if (likely(out)) {
+        xdr_bswap32_array(out, v, n);
+    }
+} /* __marshall_flat_bswap32_array */
+
+static FORCE_INLINE void
+__marshall_flat_bswap64_array(
+    const void             *v,
+    uint32_t                n,
+    struct xdr_flat_cursor *cursor)
+{
+    void *out = NULL;
+
+    if (likely((uint64_t) n * 8 <= cursor->size - cursor->used)) {
+        out = xdr_flat_cursor_reserve(cursor, n * 8);
+    } else {
+        cursor->overflow = 1;
+    }
+
+    if (likely(out)) {
+        xdr_bswap64_array(out, v, n);
+    }
+} /* __marshall_flat_bswap64_array */
+
+static FORCE_INLINE void
+__marshall_flat_float_array(
+    const float            *v,
+    uint32_t                n,
+    struct xdr_flat_cursor *cursor)
+{
+    __marshall_flat_bswap32_array(v, n, cursor);
+} /* __marshall_flat_float_array */
+
+static FORCE_INLINE void
+__marshall_flat_double_array(
+    const double           *v,
+    uint32_t                n,
+    struct xdr_flat_cursor *cursor)
+{
+    __marshall_flat_bswap64_array(v, n, cursor);
+} /* __marshall_flat_double_array */
+
+static FORCE_INLINE void
+__marshall_flat_xdr_string(
+    const xdr_string       *str,
+    struct xdr_flat_cursor *cursor)
+{
+    __marshall_flat_uint32_t(&str->len, cursor);
+    xdr_flat_cursor_append(cursor, str->str, str->len);
+    xdr_flat_cursor_pad(cursor, str->len);
+} /* __marshall_flat_xdr_string */
+
+static FORCE_INLINE void
+__marshall_flat_opaque(
+    const xdr_opaque       *v,
+    uint32_t                bound,
+    struct xdr_flat_cursor *cursor)
+{
+    __marshall_flat_uint32_t(&v->len, cursor);
+    xdr_flat_cursor_append(cursor, v->data, v->len);
+    xdr_flat_cursor_pad(cursor, v->len);
+} /* __marshall_flat_opaque */
+
+static FORCE_INLINE void
+__marshall_flat_opaque_crc32c(
+    const xdr_opaque       *v,
+    uint32_t                bound,
+    uint32_t               *crc,
+    struct xdr_flat_cursor *cursor)
+{
+    void *out;
+
+    __marshall_flat_uint32_t(&v->len, cursor);
+
+    out = xdr_flat_cursor_reserve(cursor, v->len);
+
+    if (likely(out) && crc) {
+        *crc = ~xdr_crc32c_copy(~0U, out, v->data, v->len);
+    } else if (likely(out)) {
+        xdr_copy(out, v->data, v->len);
+    }
+
+    xdr_flat_cursor_pad(cursor, v->len);
+} /* __marshall_flat_opaque_crc32c */
+
+/* Reads a whole file segment range, returns -1 on error or early EOF */
+static int
+xdr_file_segment_read(
+    const xdr_file_segment *seg,
+    void                   *out,
+    uint32_t                len)
+{
+    ssize_t  rc;
+    uint32_t done = 0;
+
+    while (done < len) {
+        rc = pread(seg->fd, (char *) out + done, len - done,
+                   seg->offset + done);
+
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (rc <= 0) {
+            return -1;
+        }
+
+        done += rc;
+    }
+
+    return 0;
+} /* xdr_file_segment_read */
+
+/* There are no iovecs to reference in a flat buffer, so zero-copy
+ * payloads are gathered inline */
+static FORCE_INLINE void
+__marshall_flat_opaque_zerocopy_crc32c(
+    const xdr_iovecr       *v,
+    uint32_t               *crc,
+    struct xdr_flat_cursor *cursor)
+{
+    char    *out;
+    uint32_t chunk, left = v->length, sum = ~0U;
+    int      i;
+
+    __marshall_flat_uint32_t(&v->length, cursor);
+
+    out = xdr_flat_cursor_reserve(cursor, v->length);
+
+    if (unlikely(!out)) {
+        return;
+    }
+
+    for (i = 0; i < v->niov && left; ++i) {
+        chunk = xdr_iovec_len(&v->iov[i]);
+
+        if (chunk > left) {
+            chunk = left;
+        }
+
+        if (xdr_iovec_is_file(&v->iov[i])) {
+            if (unlikely(xdr_file_segment_read(xdr_iovec_data(&v->iov[i]),
+                                               out, chunk))) {
+                cursor->overflow = 1;
+                return;
+            }
+
+            if (crc) {
+                sum = xdr_crc32c_update(sum, out, chunk);
+            }
+        } else if (crc) {
+            sum = xdr_crc32c_copy(sum, out, xdr_iovec_data(&v->iov[i]), chunk);
+        } else {
+            xdr_copy_part(out, xdr_iovec_data(&v->iov[i]), chunk, v->length);
+        }
+
+        out  += chunk;
+        left -= chunk;
+    }
+
+    if (unlikely(left)) {
+        abort();
+    }
+
+    if (crc) {
+        *crc = ~sum;
+    }
+
+    xdr_flat_cursor_pad(cursor, v->length);
+} /* __marshall_flat_opaque_zerocopy_crc32c */
+
+static FORCE_INLINE void
+__marshall_flat_opaque_zerocopy(
+    const xdr_iovecr       *v,
+    struct xdr_flat_cursor *cursor)
+{
+    __marshall_flat_opaque_zerocopy_crc32c(v, NULL, cursor);
+} /* __marshall_flat_opaque_zerocopy */
+
+/*
+ * CRC32C of the first 'length' bytes referenced by an iovec array.  File
+ * segments are read back a block at a time.  Returns -1 if that fails.
+ */
+static int
+xdr_crc32c_iov(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         length,
+    uint32_t        *crc)
+{
+    xdr_file_segment seg;
+    char             block[XDR_CRC32C_BLOCK];
+    uint32_t         sum = ~0U, chunk, part;
+    int              i;
+
+    for (i = 0; i < niov && length; ++i) {
+        chunk = xdr_iovec_len(&iov[i]);
+
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        length -= chunk;
+
+        if (!xdr_iovec_is_file(&iov[i])) {
+            sum = xdr_crc32c_update(sum, xdr_iovec_data(&iov[i]), chunk);
+            continue;
+        }
+
+        seg = *(const xdr_file_segment *) xdr_iovec_data(&iov[i]);
+
+        while (chunk) {
+            part = chunk < sizeof(block) ? chunk : sizeof(block);
+
+            if (xdr_file_segment_read(&seg, block, part)) {
+                return -1;
+            }
+
+            sum         = xdr_crc32c_update(sum, block, part);
+            seg.offset += part;
+            chunk      -= part;
+        }
+    }
+
+    *crc = ~sum;
+
+    return 0;
+} /* xdr_crc32c_iov */
+
+/*
+ * The payload is referenced, so it is checksummed where it lies.  A file
+ * segment that cannot be read back fails the marshall through the cursor.
+ */
+static FORCE_INLINE void
+__marshall_opaque_zerocopy_crc32c(
+    const xdr_iovecr        *v,
+    uint32_t                *crc,
+    struct xdr_write_cursor *cursor)
+{
+    __marshall_opaque_zerocopy(v, cursor);
+
+    if (crc && unlikely(xdr_crc32c_iov(v->iov, v->niov, v->length, crc))) {
+        cursor->error = 1;
+    }
+} /* __marshall_opaque_zerocopy_crc32c */
+
+static FORCE_INLINE int
+__unmarshall_opaque_zerocopy_crc32c(
+    xdr_iovecr             *v,
+    const char             *member,
+    uint32_t              **crc,
+    struct xdr_read_cursor *cursor,
+    xdr_dbuf               *dbuf)
+{
+    int rc;
+
+    xdr_dbuf_alloc_space(*crc, sizeof(**crc), dbuf);
+
+    rc = __unmarshall_opaque_zerocopy(v, member, cursor, dbuf);
+
+    if (unlikely(rc < 0)) {
+        return rc;
+    }
+
+    if (unlikely(xdr_crc32c_iov(v->iov, v->niov, v->length, *crc))) {
+        return -1;
+    }
+
+    return rc;
+} /* __unmarshall_opaque_zerocopy_crc32c */
+
+static FORCE_INLINE int
+xdr_encode_cache_hit(
+    const xdr_encode_cache *cache,
+    uint64_t                key)
+{
+    return cache && cache->valid && cache->key == key;
+} /* xdr_encode_cache_hit */
+
+static FORCE_INLINE void
+__marshall_cached(
+    const xdr_encode_cache  *cache,
+    struct xdr_write_cursor *cursor)
+{
+    xdr_iovec *iov;
+
+    if (cache->len < XDR_CACHE_REF_MIN) {
+        xdr_write_cursor_append(cursor, cache->data, cache->len);
+        return;
+    }
+
+    xdr_write_cursor_flush(cursor);
+
+    if (unlikely(cursor->niov + 1 > cursor->maxiov)) {
+        abort();
+    }
+
+    iov = &cursor->iov[cursor->niov++];
+
+    xdr_iovec_set_data(iov, cache->data);
+    xdr_iovec_set_len(iov, cache->len);
+    xdr_iovec_set_private_null(iov);
+
+    cursor->total += cache->len;
+} /* __marshall_cached */
+
+/*
+ * Records what was encoded since scratch offset 'start' as the cached
+ * encoding for 'key'.  Encodings interrupted by a flush, i.e. that
+ * reference zero-copy payloads, are not contiguous and are not cached.
+ * Neither are encodings that handed a payload to the RDMA write chunk,
+ * since replaying the bytes would not set the chunk again.
+ */
+static FORCE_INLINE void
+__marshall_cache_fill(
+    xdr_encode_cache              *cache,
+    uint64_t                       key,
+    const struct xdr_write_cursor *cursor,
+    int                            start,
+    int                            niov,
+    int                            nchunk)
+{
+    uint32_t len = cursor->scratch_used - start;
+
+    if (cursor->niov != niov || cursor->nchunk != nchunk ||
+        len > cache->size) {
+        cache->valid = 0;
+        return;
+    }
+
+    memcpy(cache->data, cursor->scratch_data + start, len);
+
+    cache->key   = key;
+    cache->len   = len;
+    cache->valid = 1;
+} /* __marshall_cache_fill */
+
+static FORCE_INLINE void
+__marshall_flat_cached(
+    const xdr_encode_cache *cache,
+    struct xdr_flat_cursor *cursor)
+{
+    xdr_flat_cursor_append(cursor, cache->data, cache->len);
+} /* __marshall_flat_cached */
+
+/* Replays the input bytes a clean passthrough value was decoded from */
+static void
+__marshall_wire(
+    const xdr_wire_range    *wire,
+    struct xdr_write_cursor *cursor)
+{
+    const xdr_iovecr *v = &wire->range;
+    xdr_iovec        *iov;
+    int               i;
+
+    if (v->length < XDR_WIRE_REF_MIN) {
+        for (i = 0; i < v->niov; ++i) {
+            xdr_write_cursor_append(cursor, xdr_iovec_data(&v->iov[i]),
+                                    xdr_iovec_len(&v->iov[i]));
+        }
+        return;
+    }
+
+    xdr_write_cursor_flush(cursor);
+
+    if (unlikely(cursor->niov + v->niov > cursor->maxiov)) {
+        abort();
+    }
+
+    for (i = 0; i < v->niov; ++i) {
+        iov = &cursor->iov[cursor->niov++];
+
+        xdr_iovec_set_data(iov, xdr_iovec_data(&v->iov[i]));
+        xdr_iovec_copy_private(iov, &v->iov[i]);
+        xdr_iovec_set_len(iov, xdr_iovec_len(&v->iov[i]));
+    }
+
+    cursor->total += v->length;
+} /* __marshall_wire */
+
+static FORCE_INLINE void
+__marshall_flat_wire(
+    const xdr_wire_range   *wire,
+    struct xdr_flat_cursor *cursor)
+{
+    int i;
+
+    for (i = 0; i < wire->range.niov; ++i) {
+        xdr_flat_cursor_append(cursor, xdr_iovec_data(&wire->range.iov[i]),
+                               xdr_iovec_len(&wire->range.iov[i]));
+    }
+} /* __marshall_flat_wire */
+
+static FORCE_INLINE void
+__marshall_flat_cache_fill(
+    xdr_encode_cache             *cache,
+    uint64_t                      key,
+    const struct xdr_flat_cursor *cursor,
+    unsigned int                  start)
+{
+    uint32_t len = cursor->used - start;
+
+    if (cursor->overflow || len > cache->size) {
+        cache->valid = 0;
+        return;
+    }
+
+    memcpy(cache->data, cursor->data + start, len);
+
+    cache->key   = key;
+    cache->len   = len;
+    cache->valid = 1;
+} /* __marshall_flat_cache_fill */
+
+/*
+ * Overwrites 'len' bytes at 'offset' within an already marshalled iovec
+ * array, which may straddle iovec boundaries.  Returns -1 without writing
+ * anything if the range extends past the end of the array.
+ */
+static int
+xdr_iovec_patch(
+    xdr_iovec  *iov,
+    int         niov,
+    uint32_t    offset,
+    const void *data,
+    uint32_t    len)
+{
+    const char *in = data;
+    uint32_t    left, chunk;
+    int         i;
+
+    while (niov && offset >= xdr_iovec_len(iov)) {
+        offset -= xdr_iovec_len(iov);
+        iov++;
+        niov--;
+    }
+
+    left = offset + len;
+
+    for (i = 0; i < niov && left > xdr_iovec_len(&iov[i]); ++i) {
+        left -= xdr_iovec_len(&iov[i]);
+    }
+
+    if (unlikely(i == niov)) {
+        return -1;
+    }
+
+    while (len) {
+        chunk = xdr_iovec_len(iov) - offset;
+
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(xdr_iovec_data(iov) + offset, in, chunk);
+
+        in    += chunk;
+        len   -= chunk;
+        offset = 0;
+        iov++;
+    }
+
+    return 0;
+} /* xdr_iovec_patch */
+
+/*
+ * Copies 'len' bytes at 'offset' within an iovec array into 'out', which
+ * may straddle iovec boundaries.  Returns -1 if the range extends past the
+ * end of the array or into a file segment, which views cannot read.
+ */
+static int
+xdr_view_read(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    void            *out,
+    uint32_t         len)
+{
+    char    *o = out;
+    uint32_t chunk;
+
+    while (niov && offset >= xdr_iovec_len(iov)) {
+        offset -= xdr_iovec_len(iov);
+        iov++;
+        niov--;
+    }
+
+    while (len) {
+        if (unlikely(!niov || xdr_iovec_is_file(iov))) {
+            return -1;
+        }
+
+        chunk = xdr_iovec_len(iov) - offset;
+
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(o, (const char *) xdr_iovec_data(iov) + offset, chunk);
+
+        o     += chunk;
+        len   -= chunk;
+        offset = 0;
+        iov++;
+        niov--;
+    }
+
+    return 0;
+} /* xdr_view_read */
+
+static int
+xdr_view_read32(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    void            *out)
+{
+    uint32_t v;
+
+    if (unlikely(xdr_view_read(iov, niov, offset, &v, sizeof(v)))) {
+        return -1;
+    }
+
+    v = xdr_ntoh32(v);
+
+    memcpy(out, &v, sizeof(v));
+
+    return 0;
+} /* xdr_view_read32 */
+
+static int
+xdr_view_read64(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    void            *out)
+{
+    uint64_t v;
+
+    if (unlikely(xdr_view_read(iov, niov, offset, &v, sizeof(v)))) {
+        return -1;
+    }
+
+    v = xdr_ntoh64(v);
+
+    memcpy(out, &v, sizeof(v));
+
+    return 0;
+} /* xdr_view_read64 */
+
+/*
+ * Points 'out' at 'len' bytes at 'offset' in place.  Views never copy, so
+ * this fails if the bytes straddle iovecs as well as if they are missing.
+ */
+static int
+xdr_view_opaque(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    uint32_t         len,
+    xdr_opaque      *out)
+{
+    out->len  = len;
+    out->data = NULL;
+
+    if (!len) {
+        return 0;
+    }
+
+    while (niov && offset >= xdr_iovec_len(iov)) {
+        offset -= xdr_iovec_len(iov);
+        iov++;
+        niov--;
+    }
+
+    if (unlikely(!niov || xdr_iovec_is_file(iov) ||
+                 xdr_iovec_len(iov) - offset < len)) {
+        return -1;
+    }
+
+    out->data = (char *) xdr_iovec_data(iov) + offset;
+
+    return 0;
+} /* xdr_view_opaque */
+
+static int
+xdr_view_opaque_var(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    xdr_opaque      *out)
+{
+    uint32_t len;
+
+    if (unlikely(xdr_view_read32(iov, niov, offset, &len))) {
+        return -1;
+    }
+
+    return xdr_view_opaque(iov, niov, offset + 4, len, out);
+} /* xdr_view_opaque_var */
+
+/* Strings are not NUL terminated on the wire, and so not in a view */
+static int
+xdr_view_string(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset,
+    xdr_string      *out)
+{
+    xdr_opaque opaque;
+
+    if (unlikely(xdr_view_opaque_var(iov, niov, offset, &opaque))) {
+        return -1;
+    }
+
+    out->len = opaque.len;
+    out->str = opaque.data;
+
+    return 0;
+} /* xdr_view_string */
+
+/*
+ * Moves a view offset along by 'bytes', which may come from a length on the
+ * wire.  Whether the bytes are present is left to whatever reads them next.
+ */
+static FORCE_INLINE int
+xdr_view_advance(
+    uint32_t *offset,
+    uint64_t  bytes)
+{
+    if (unlikely(*offset + bytes > UINT32_MAX)) {
+        return -1;
+    }
+
+    *offset += bytes;
+
+    return 0;
+} /* xdr_view_advance */
+
+static int
+xdr_view_skip_opaque(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t        *offset)
+{
+    uint32_t len;
+
+    if (unlikely(xdr_view_read32(iov, niov, *offset, &len))) {
+        return -1;
+    }
+
+    return xdr_view_advance(offset, 4 + (uint64_t) len + xdr_pad(len));
+} /* xdr_view_skip_opaque */
+
+/* Skips a vector whose elements all encode to 'size' bytes */
+static int
+xdr_view_skip_vector(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t        *offset,
+    uint32_t         size)
+{
+    uint32_t num;
+
+    if (unlikely(xdr_view_read32(iov, niov, *offset, &num))) {
+        return -1;
+    }
+
+    return xdr_view_advance(offset, 4 + (uint64_t) num * size);
+} /* xdr_view_skip_vector */
+
+/* Returns -1 unless 'offset' is within or just past the end of the data */
+static int
+xdr_view_check(
+    const xdr_iovec *iov,
+    int              niov,
+    uint32_t         offset)
+{
+    int i;
+
+    for (i = 0; i < niov && offset > xdr_iovec_len(&iov[i]); ++i) {
+        offset -= xdr_iovec_len(&iov[i]);
+    }
+
+    return i < niov || offset == 0 ? 0 : -1;
+} /* xdr_view_check */
+
+/*
+ * Bump allocator over the block that clone_<type>() copies a value into.
+ * Every allocation is rounded up to 8 bytes, so the block must be 8-byte
+ * aligned and clone_size_<type>() accounts for the rounding.  Running out
+ * of room fails the clone and returns NULL, which callers must check
+ * before following the pointer.
+ */
+struct xdr_clone_cursor {
+    char    *data;
+    uint32_t used;
+    uint32_t size;
+    int      error;
+};
+
+static FORCE_INLINE uint32_t
+xdr_clone_space(uint32_t size)
+{
+    return (size + 7) & ~7;
+} /* xdr_clone_space */
+
+static FORCE_INLINE void *
+xdr_clone_alloc(
+    struct xdr_clone_cursor *cursor,
+    uint32_t                 size)
+{
+    void    *ptr;
+    uint64_t space = ((uint64_t) size + 7) & ~7ULL;
+
+    if (unlikely(space > cursor->size - cursor->used)) {
+        cursor->error = 1;
+        return NULL;
+    }
+
+    ptr           = cursor->data + cursor->used;
+    cursor->used += space;
+
+    return ptr;
+} /* xdr_clone_alloc */
+
+static FORCE_INLINE void *
+xdr_clone_copy(
+    struct xdr_clone_cursor *cursor,
+    const void              *src,
+    uint32_t                 len)
+{
+    void *ptr = xdr_clone_alloc(cursor, len);
+
+    if (likely(ptr) && len) {
+        xdr_copy(ptr, src, len);
+    }
+
+    return ptr;
+} /* xdr_clone_copy */
+
+/*
+ * Gathers a zero-copy opaque into the block behind a single iovec of its
+ * own, which drops whatever the source iovecs were holding on to.  File
+ * segments are read in, and a failed read fails the clone.
+ */
+static void
+xdr_clone_iovecr(
+    struct xdr_clone_cursor *cursor,
+    xdr_iovecr              *out,
+    const xdr_iovecr        *in)
+{
+    xdr_iovec *iov   = xdr_clone_alloc(cursor, sizeof(*iov));
+    char      *start = xdr_clone_alloc(cursor, in->length), *data = start;
+    uint32_t   chunk, left = in->length;
+    int        i;
+
+    if (unlikely(!iov || !start)) {
+        out->iov    = NULL;
+        out->niov   = 0;
+        out->length = 0;
+        return;
+    }
+
+    for (i = 0; i < in->niov && left; ++i) {
+        chunk = xdr_iovec_len(&in->iov[i]);
+
+        if (chunk > left) {
+            chunk = left;
+        }
+
+        if (xdr_iovec_is_file(&in->iov[i])) {
+            if (unlikely(xdr_file_segment_read(xdr_iovec_data(&in->iov[i]),
+                                               data, chunk))) {
+                cursor->error = 1;
+            }
+        } else {
+            xdr_copy_part(data, xdr_iovec_data(&in->iov[i]), chunk,
+                          in->length);
+        }
+
+        data += chunk;
+        left -= chunk;
+    }
+
+    xdr_iovec_set_data(iov, start);
+    xdr_iovec_set_len(iov, in->length - left);
+    xdr_iovec_set_private_null(iov);
+
+    out->iov    = iov;
+    out->niov   = 1;
+    out->length = in->length - left;
+} /* xdr_clone_iovecr */
+
+static FORCE_INLINE void *
+xdr_write_cursor_reserve(
+    struct xdr_write_cursor *cursor,
+    unsigned int             bytes)
+{
+    void *ptr;
+
+    if (unlikely(cursor->scratch_used + bytes > cursor->scratch_size)) {
+        abort();
+    }
+
+    ptr                   = cursor->scratch_data + cursor->scratch_used;
+    cursor->scratch_used += bytes;
+
+    return ptr;
+} /* xdr_write_cursor_reserve */
+
+/* Bytes encoded so far, used to hold list members to their budget */
+static FORCE_INLINE uint32_t
+xdr_write_cursor_position(const struct xdr_write_cursor *cursor)
+{
+    return cursor->total + cursor->scratch_used;
+} /* xdr_write_cursor_position */
+
+static FORCE_INLINE uint32_t
+xdr_flat_cursor_position(const struct xdr_flat_cursor *cursor)
+{
+    return cursor->used;
+} /* xdr_flat_cursor_position */
+
+/*
+ * Next element of a vector member under an xdr_marshall_list control,
+ * either from the application's iterator or from the member's array.
+ */
+static FORCE_INLINE const void *
+xdr_marshall_list_next(
+    xdr_marshall_list *ctl,
+    const void        *base,
+    size_t             size,
+    uint32_t           num)
+{
+    if (ctl->next) {
+        return ctl->next(ctl->arg);
+    }
+
+    return ctl->count < num ? (const char *) base + ctl->count * size : NULL;
+} /* xdr_marshall_list_next */
+
+/* Fills in a vector count reserved before its elements were known */
+static FORCE_INLINE void
+xdr_marshall_list_count(
+    void    *slot,
+    uint32_t count)
+{
+    uint32_t v = xdr_hton32(count);
+
+    if (likely(slot)) {
+        memcpy(slot, &v, sizeof(v));
+    }
+} /* xdr_marshall_list_count */
+
+static FORCE_INLINE int
+xdr_write_cursor_room(
+    const struct xdr_write_cursor *cursor,
+    unsigned int                   bytes)
+{
+    return cursor->scratch_used + bytes <= cursor->scratch_size;
+} /* xdr_write_cursor_room */
+
+/*
+ * Returns NULL and fails the stream for values nested deeper than
+ * XDR_MAX_STREAM_DEPTH, which the caller unwinds like a yield.
+ */
+static FORCE_INLINE struct xdr_stream_frame *
+xdr_marshall_stream_enter(xdr_marshall_stream *stream)
+{
+    if (unlikely(stream->depth == XDR_MAX_STREAM_DEPTH)) {
+        stream->error = 1;
+        return NULL;
+    }
+
+    return &stream->frames[stream->depth++];
+} /* xdr_marshall_stream_enter */
+
+static FORCE_INLINE void
+xdr_marshall_stream_leave(
+    xdr_marshall_stream     *stream,
+    struct xdr_stream_frame *frame)
+{
+    frame->state  = 0;
+    frame->index  = 0;
+    frame->offset = 0;
+    frame->ptr    = NULL;
+
+    stream->depth--;
+} /* xdr_marshall_stream_leave */
+
+/*
+ * Writes as much as fits of the encoding of a byte string (optional length
+ * word, data, then padding) into scratch, starting at *offset into that
+ * encoding.  Returns 0 once it has all been written, or 1 if scratch
+ * filled first, in which case *offset records where to continue.
+ */
+static FORCE_INLINE int
+__marshall_stream_opaque(
+    const void              *data,
+    uint32_t                 len,
+    int                      counted,
+    uint32_t                *offset,
+    struct xdr_write_cursor *cursor)
+{
+    const uint32_t zero = 0;
+    uint32_t       header, pos, hdrlen, total, chunk;
+    char          *out;
+
+    header = xdr_hton32(len);
+    hdrlen = counted ? 4 : 0;
+    total  = hdrlen + len + (counted ? xdr_pad(len) : 0);
+
+    while (*offset < total) {
+
+        chunk = cursor->scratch_size - cursor->scratch_used;
+
+        if (chunk == 0) {
+            return 1;
+        }
+
+        pos = *offset;
+        out = cursor->scratch_data + cursor->scratch_used;
+
+        if (pos < hdrlen) {
+            if (chunk > hdrlen - pos) {
+                chunk = hdrlen - pos;
+            }
+            memcpy(out, (const char *) &header + pos, chunk);
+        } else if (pos < hdrlen + len) {
+            if (chunk > hdrlen + len - pos) {
+                chunk = hdrlen + len - pos;
+            }
+            xdr_copy_part(out, (const char *) data + (pos - hdrlen), chunk,
+                          len);
+        } else {
+            if (chunk > total - pos) {
+                chunk = total - pos;
+            }
+            memcpy(out, &zero, chunk);
+        }
+
+        cursor->scratch_used += chunk;
+        *offset              += chunk;
+    }
+
+    return 0;
+} /* __marshall_stream_opaque */
+
+/*
+ * Zero-copy payloads are referenced rather than copied, so they only need
+ * room for the length word, padding and enough output iovecs to hold the
+ * references plus the scratch on either side of them.
+ */
+static FORCE_INLINE int
+__marshall_stream_opaque_zerocopy(
+    const xdr_iovecr        *v,
+    uint32_t                *offset,
+    struct xdr_write_cursor *cursor)
+{
+    if (*offset == 0) {
+
+        if (unlikely(!xdr_write_cursor_room(cursor, 4 + xdr_pad(v->length)) ||
+                     cursor->niov + v->niov + 2 > cursor->maxiov)) {
+            return 1;
+        }
+
+        __marshall_opaque_zerocopy(v, cursor);
+
+        *offset = 1;
+    }
+
+    return 0;
+} /* __marshall_stream_opaque_zerocopy */
+
 static FORCE_INLINE int
 is_ascii(
     const char *s,
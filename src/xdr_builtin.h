@@ -23,10 +23,15 @@ typedef struct {
     void    *data;
 } xdr_opaque;
 
+struct xdr_placement;
+struct xdr_intern;
+
 typedef struct {
-    void *buffer;
-    int   size;
-    int   used;
+    void                 *buffer;
+    int                   size;
+    int                   used;
+    struct xdr_placement *placement;
+    struct xdr_intern    *intern;
 } xdr_dbuf;
 
 static inline xdr_dbuf *
@@ -38,8 +43,10 @@ xdr_dbuf_alloc(int bytes)
 
     dbuf->buffer = malloc(bytes);
 
-    dbuf->used = 0;
-    dbuf->size = bytes;
+    dbuf->used      = 0;
+    dbuf->size      = bytes;
+    dbuf->placement = NULL;
+    dbuf->intern    = NULL;
 
     return dbuf;
 } /* xdr_dbuf_alloc */
@@ -116,6 +123,18 @@ xdr_dbuf_reset(xdr_dbuf *dbuf)
             (structp)->member.length = (ilength);                       \
         }
 
+/*
+ * A file range that a zero-copy opaque can reference in place of memory,
+ * such as page cache contents for a READ reply.  The iovec's data points
+ * at the segment and its length is the number of bytes taken from the file
+ * starting at 'offset'.  Such iovecs are passed through marshall output as
+ * is and are sent with sendfile() by the socket writer.
+ */
+typedef struct {
+    int      fd;
+    uint64_t offset;
+} xdr_file_segment;
+
 #ifdef XDR_CUSTOM_IOVEC
 #define QUOTED(x)   #x
 #define TOSTRING(x) QUOTED(x)
@@ -125,25 +144,774 @@ xdr_dbuf_reset(xdr_dbuf *dbuf)
 typedef struct {
     void    *iov_base;
     uint32_t iov_len;
+    uint32_t iov_flags;
 } xdr_iovec;
 
+#define XDR_IOVEC_FILE               0x1
+
 #define xdr_iovec_data(iov)          ((iov)->iov_base)
 #define xdr_iovec_len(iov)           ((iov)->iov_len)
 
-#define xdr_iovec_set_data(iov, ptr) ((iov)->iov_base = (ptr))
+#define xdr_iovec_set_data(iov, ptr) ((iov)->iov_base = (ptr), (iov)->iov_flags = 0)
 #define xdr_iovec_set_len(iov, len)  ((iov)->iov_len = (len))
 
-#define xdr_iovec_copy_private(out, in)
-#define xdr_iovec_set_private_null(out)
+#define xdr_iovec_copy_private(out, in) ((out)->iov_flags = (in)->iov_flags)
+#define xdr_iovec_set_private_null(out) ((out)->iov_flags = 0)
+
+#define xdr_iovec_is_file(iov)       ((iov)->iov_flags & XDR_IOVEC_FILE)
+
+#define xdr_iovec_set_file(iov, seg, len) \
+        {                                                    \
+            (iov)->iov_base  = (seg);                        \
+            (iov)->iov_len   = (len);                        \
+            (iov)->iov_flags = XDR_IOVEC_FILE;               \
+        }
 
 #endif /* ifdef XDR_CUSTOM_IOVEC */
 
+/* Custom iovecs that cannot carry file segments never have any */
+#ifndef xdr_iovec_is_file
+#define xdr_iovec_is_file(iov) 0
+#endif /* ifndef xdr_iovec_is_file */
+
 typedef struct {
     xdr_iovec *iov;
     int        niov;
     uint32_t   length;
 } xdr_iovecr;
 
+/*
+ * A value in place within marshalled data, 'offset' bytes into an iovec
+ * array.  Generated view_<type> structs begin with one of these and read
+ * members straight from the wire rather than decoding the whole value.
+ */
+typedef struct {
+    const xdr_iovec *iov;
+    int              niov;
+    uint32_t         offset;
+} xdr_view;
+
+/*
+ * Caller supplied destination for zero-copy opaque payloads, attached to
+ * the dbuf used for unmarshalling with xdr_dbuf_set_placement().  Once the
+ * length of a payload is known, place() is called with the member name in
+ * "<type>.<member>" form and fills in 'iov' with a buffer of at least that
+ * length, whose private data travels with the payload.  The payload is
+ * copied there and the member references it instead of the input.
+ *
+ * A payload that lies within one input iovec at an address that is a
+ * multiple of 'alignment' already satisfies the caller and is referenced
+ * in place without calling place(); an alignment of zero places every
+ * payload.  place() returns 0 once 'iov' is filled in, 1 to reference the
+ * payload in place anyway, or -1 to fail the unmarshall.
+ */
+typedef struct xdr_placement {
+    uint32_t alignment;
+    int      (*place)(
+        const char *member,
+        uint32_t    length,
+        xdr_iovec  *iov,
+        void       *private_data);
+    void    *private_data;
+} xdr_placement;
+
+static inline void
+xdr_dbuf_set_placement(
+    xdr_dbuf      *dbuf,
+    xdr_placement *placement)
+{
+    dbuf->placement = placement;
+} /* xdr_dbuf_set_placement */
+
+#ifndef XDR_HASH_SEED
+#define XDR_HASH_SEED 0x2d358dccaa6c78a5ULL
+#endif /* ifndef XDR_HASH_SEED */
+
+static inline uint64_t
+xdr_hash_mix(
+    uint64_t a,
+    uint64_t b)
+{
+    __uint128_t r = (__uint128_t) a * b;
+
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+} /* xdr_hash_mix */
+
+static inline uint64_t
+xdr_hash_read64(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+} /* xdr_hash_read64 */
+
+static inline uint64_t
+xdr_hash_read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+} /* xdr_hash_read32 */
+
+/*
+ * 64-bit wyhash style hash of names decoded from typedefs named with -H.
+ * Not cryptographic, and the value depends on host byte order, so it is
+ * only meant for in-memory tables.  Callers use it to hash their own keys
+ * for comparison with decoded hashes.
+ */
+static inline uint64_t
+xdr_hash64(
+    const void *data,
+    uint32_t    len)
+{
+    const uint64_t p0 = 0xa0761d6478bd642fULL;
+    const uint64_t p1 = 0xe7037ed1a0b428dbULL;
+    const uint8_t *p  = data;
+    uint64_t       a, b, h = XDR_HASH_SEED ^ p0;
+    uint32_t       left = len;
+
+    while (left > 16) {
+        h     = xdr_hash_mix(xdr_hash_read64(p) ^ p1, xdr_hash_read64(p + 8) ^ h);
+        p    += 16;
+        left -= 16;
+    }
+
+    if (left >= 8) {
+        a = xdr_hash_read64(p);
+        b = xdr_hash_read64(p + left - 8);
+    } else if (left >= 4) {
+        a = xdr_hash_read32(p);
+        b = xdr_hash_read32(p + left - 4);
+    } else if (left) {
+        a = ((uint64_t) p[0] << 16) | ((uint64_t) p[left >> 1] << 8) | p[left - 1];
+        b = 0;
+    } else {
+        a = 0;
+        b = 0;
+    }
+
+    return xdr_hash_mix(p1 ^ len, xdr_hash_mix(a ^ p1, b ^ h));
+} /* xdr_hash64 */
+
+/*
+ * Caller supplied interning for typedefs named with -H, attached to the
+ * dbuf used for unmarshalling with xdr_dbuf_set_intern().  intern() is
+ * called with the typedef name and each decoded value and its hash, and
+ * returns the bytes the member should reference instead, such as an
+ * existing copy of the same name, or NULL to fail the unmarshall.
+ */
+typedef struct xdr_intern {
+    const void *(*intern)(
+        const char *type,
+        const void *data,
+        uint32_t    len,
+        uint64_t    hash,
+        void       *private_data);
+    void       *private_data;
+} xdr_intern;
+
+static inline void
+xdr_dbuf_set_intern(
+    xdr_dbuf   *dbuf,
+    xdr_intern *intern)
+{
+    dbuf->intern = intern;
+} /* xdr_dbuf_set_intern */
+
+#ifndef XDR_CACHE_REF_MIN
+#define XDR_CACHE_REF_MIN 512
+#endif /* ifndef XDR_CACHE_REF_MIN */
+
+/*
+ * Memoized encoding of a cached type (see -c).  Attach one to a value via
+ * its xdr_cache member together with a caller chosen xdr_cache_key, such
+ * as an inode generation number.  While the key matches, marshalling
+ * splices in the stored bytes instead of encoding the value again, by copy
+ * if shorter than XDR_CACHE_REF_MIN and by iovec reference otherwise, so
+ * the cache must not be refilled while such output is still in flight.
+ */
+typedef struct {
+    uint64_t key;
+    int      valid;
+    uint32_t len;
+    uint32_t size;
+    void    *data;
+} xdr_encode_cache;
+
+static inline void
+xdr_encode_cache_init(
+    xdr_encode_cache *cache,
+    void             *buf,
+    uint32_t          size)
+{
+    cache->key   = 0;
+    cache->valid = 0;
+    cache->len   = 0;
+    cache->size  = size;
+    cache->data  = buf;
+} /* xdr_encode_cache_init */
+
+static inline void
+xdr_encode_cache_invalidate(xdr_encode_cache *cache)
+{
+    cache->valid = 0;
+} /* xdr_encode_cache_invalidate */
+
+#ifndef XDR_WIRE_REF_MIN
+#define XDR_WIRE_REF_MIN 512
+#endif /* ifndef XDR_WIRE_REF_MIN */
+
+/*
+ * Where a value of a passthrough type (see -p) was decoded from, as slices
+ * of the input iovecs.  While the value is not marked dirty, marshalling
+ * replays these bytes instead of encoding the value again, by copy if
+ * shorter than XDR_WIRE_REF_MIN and by iovec reference otherwise.  Values
+ * built by the caller rather than decoded must start out zeroed.
+ */
+typedef struct {
+    xdr_iovecr range;
+    int        dirty;
+} xdr_wire_range;
+
+/* Re-encode 'value' from its members the next time it is marshalled */
+#define xdr_wire_dirty(value) ((value)->xdr_wire.dirty = 1)
+
+/*
+ * Marshall-time control of a list or vector member named with -l, attached
+ * through the member's <member>_ctl pointer.  If 'next' is set, elements
+ * are pulled from next(arg) until it returns NULL instead of being read
+ * from the member itself, so the list never needs to exist in memory.  An
+ * element returned by next() need only remain valid until the following
+ * call.
+ *
+ * The member's whole encoding, including the vector count or list markers,
+ * is kept within 'budget' bytes by stopping before the first element that
+ * would not fit.  'count' reports how many elements were encoded and
+ * 'truncated' whether any were left out, in which case the last element
+ * taken from next() was not encoded.
+ */
+typedef struct {
+    const void *(*next)(void *arg);
+    void        *arg;
+    uint32_t     budget;
+    uint32_t     count;
+    int          truncated;
+} xdr_marshall_list;
+
+static inline void
+xdr_marshall_list_init(
+    xdr_marshall_list *ctl,
+    const void *(*next)(void *arg),
+    void *arg)
+{
+    ctl->next      = next;
+    ctl->arg       = arg;
+    ctl->budget    = UINT32_MAX;
+    ctl->count     = 0;
+    ctl->truncated = 0;
+} /* xdr_marshall_list_init */
+
+/* Initial capacity of the array a -a list is decoded into */
+#ifndef XDR_LIST_ARRAY_MIN
+#define XDR_LIST_ARRAY_MIN 16
+#endif /* ifndef XDR_LIST_ARRAY_MIN */
+
+#ifndef XDR_LAYOUT_MAX_PAYLOADS
+#define XDR_LAYOUT_MAX_PAYLOADS 4
+#endif /* ifndef XDR_LAYOUT_MAX_PAYLOADS */
+
+/* Where one opaque payload ended up in marshall_aligned_<type> output */
+struct xdr_payload_layout {
+    uint32_t offset;    /* wire offset of the payload, including out_offset */
+    uint32_t length;
+    int      iov;       /* index of its first output iovec */
+};
+
+/*
+ * Payload alignment policy for marshall_aligned_<type>, and report of the
+ * resulting payload positions.  Every zero-copy opaque is reported.  With
+ * a non-zero, power of two 'alignment', so is every copied opaque of at
+ * least that many bytes, which is copied to an aligned address of the
+ * scratch buffer in its own output iovec and followed by XDR starting on
+ * the next aligned boundary, so it never shares a page with header bytes.
+ * The encoding itself is unchanged; a transport can use the reported wire
+ * offsets to land each payload at an aligned address on the receiver.
+ * 'npayload' counts every payload, even beyond XDR_LAYOUT_MAX_PAYLOADS.
+ */
+typedef struct {
+    uint32_t                  alignment;
+    int                       npayload;
+    struct xdr_payload_layout payload[XDR_LAYOUT_MAX_PAYLOADS];
+} xdr_marshall_layout;
+
+static inline void
+xdr_marshall_layout_init(
+    xdr_marshall_layout *layout,
+    uint32_t             alignment)
+{
+    layout->alignment = alignment;
+    layout->npayload  = 0;
+} /* xdr_marshall_layout_init */
+
+#ifndef XDR_MAX_STREAM_DEPTH
+#define XDR_MAX_STREAM_DEPTH 32
+#endif /* ifndef XDR_MAX_STREAM_DEPTH */
+
+/* Progress of one nesting level of a resumable marshall */
+struct xdr_stream_frame {
+    int         state;
+    uint32_t    index;
+    uint32_t    offset;
+    const void *ptr;
+};
+
+/* Continuation of a resumable marshall, see marshall_stream_<type> */
+typedef struct {
+    int                     depth;
+    int                     complete;
+    int                     error;
+    struct xdr_stream_frame frames[XDR_MAX_STREAM_DEPTH];
+} xdr_marshall_stream;
+
+static inline void
+xdr_marshall_stream_init(xdr_marshall_stream *stream)
+{
+    memset(stream, 0, sizeof(*stream));
+} /* xdr_marshall_stream_init */
+
+static inline int
+xdr_marshall_stream_done(const xdr_marshall_stream *stream)
+{
+    return stream->complete;
+} /* xdr_marshall_stream_done */
+
+#ifdef XDR_SOCKET_WRITER
+
+/*
+ * Optional helper, enabled by defining XDR_SOCKET_WRITER before including
+ * the generated header, that transmits marshalled xdr_iovec arrays on a
+ * stream socket.  iovecs are handed to sendmsg() in batches, optionally
+ * with MSG_ZEROCOPY, and each is passed to the release callback once the
+ * kernel no longer references its memory, so any private data carried by
+ * a custom xdr_iovec can be used to return the buffer to its owner.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#endif /* ifdef __linux__ */
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY           60
+#endif /* ifndef SO_ZEROCOPY */
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY          0x4000000
+#endif /* ifndef MSG_ZEROCOPY */
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif /* ifndef SO_EE_ORIGIN_ZEROCOPY */
+
+#ifndef XDR_SOCKET_BATCH
+#define XDR_SOCKET_BATCH      64
+#endif /* ifndef XDR_SOCKET_BATCH */
+
+/* Sends smaller than this are copied, pinning pages would cost more */
+#ifndef XDR_SOCKET_ZEROCOPY_MIN
+#define XDR_SOCKET_ZEROCOPY_MIN 16384
+#endif /* ifndef XDR_SOCKET_ZEROCOPY_MIN */
+
+#define XDR_SOCKET_ZEROCOPY   0x1
+
+typedef void (*xdr_socket_release_cb)(
+    xdr_iovec *iov,
+    void      *private_data);
+
+/*
+ * One sendmsg() worth of one xdr_iovec.  Entries retire strictly in order
+ * so an iovec split across sends is only released after all of them.
+ */
+struct xdr_socket_pending {
+    xdr_iovec iov;
+    uint32_t  seq;
+    uint8_t   done;
+    uint8_t   last;
+};
+
+typedef struct {
+    int                        fd;
+    int                        flags;
+    xdr_socket_release_cb      release;
+    void                      *private_data;
+    uint32_t                   seq;
+    uint32_t                   head;
+    uint32_t                   tail;
+    uint32_t                   size;
+    struct xdr_socket_pending *pending;
+} xdr_socket_writer;
+
+static inline int
+xdr_socket_writer_init(
+    xdr_socket_writer    *writer,
+    int                   fd,
+    int                   flags,
+    uint32_t              max_pending,
+    xdr_socket_release_cb release,
+    void                 *private_data)
+{
+    int one = 1;
+
+    writer->fd           = fd;
+    writer->flags        = flags;
+    writer->release      = release;
+    writer->private_data = private_data;
+    writer->seq          = 0;
+    writer->head         = 0;
+    writer->tail         = 0;
+    writer->size         = max_pending;
+    writer->pending      = malloc(max_pending * sizeof(*writer->pending));
+
+    if (!writer->pending) {
+        return -1;
+    }
+
+    /* Without kernel support every send is simply copied */
+    if ((flags & XDR_SOCKET_ZEROCOPY) &&
+        setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one))) {
+        writer->flags &= ~XDR_SOCKET_ZEROCOPY;
+    }
+
+    return 0;
+} /* xdr_socket_writer_init */
+
+static inline void
+xdr_socket_writer_destroy(xdr_socket_writer *writer)
+{
+    free(writer->pending);
+} /* xdr_socket_writer_destroy */
+
+static inline int
+xdr_socket_writer_pending(const xdr_socket_writer *writer)
+{
+    return writer->tail - writer->head;
+} /* xdr_socket_writer_pending */
+
+static inline void
+xdr_socket_writer_retire(xdr_socket_writer *writer)
+{
+    struct xdr_socket_pending *pending;
+
+    while (writer->head != writer->tail) {
+
+        pending = &writer->pending[writer->head % writer->size];
+
+        if (!pending->done) {
+            break;
+        }
+
+        writer->head++;
+
+        if (pending->last && writer->release) {
+            writer->release(&pending->iov, writer->private_data);
+        }
+    }
+} /* xdr_socket_writer_retire */
+
+/*
+ * Consumes MSG_ZEROCOPY completions from the socket error queue without
+ * blocking and releases whatever they allow.  Returns the number of
+ * completion notifications seen, or -1 on error.
+ */
+static inline int
+xdr_socket_writer_reap(xdr_socket_writer *writer)
+{
+    int count = 0;
+
+#ifdef __linux__
+    struct msghdr                    msg;
+    struct cmsghdr                  *cmsg;
+    const struct sock_extended_err *serr;
+    char                             control[128];
+    uint32_t                         i, lo, hi;
+    struct xdr_socket_pending       *pending;
+
+    for (;;) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(writer->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+
+            serr = (const struct sock_extended_err *) CMSG_DATA(cmsg);
+
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+                serr->ee_errno != 0) {
+                continue;
+            }
+
+            lo = serr->ee_info;
+            hi = serr->ee_data;
+
+            for (i = writer->head; i != writer->tail; ++i) {
+                pending = &writer->pending[i % writer->size];
+
+                if (pending->seq - lo <= hi - lo) {
+                    pending->done = 1;
+                }
+            }
+
+            count++;
+        }
+    }
+#endif /* ifdef __linux__ */
+
+    xdr_socket_writer_retire(writer);
+
+    return count;
+} /* xdr_socket_writer_reap */
+
+/* Blocks until the error queue has something to reap */
+static inline int
+xdr_socket_writer_wait(xdr_socket_writer *writer)
+{
+    struct pollfd pfd = { .fd = writer->fd, .events = 0 };
+
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+        return -1;
+    }
+
+    return xdr_socket_writer_reap(writer) < 0 ? -1 : 0;
+} /* xdr_socket_writer_wait */
+
+/* Waits until every iovec sent so far has been released */
+static inline int
+xdr_socket_writer_drain(xdr_socket_writer *writer)
+{
+    xdr_socket_writer_reap(writer);
+
+    while (writer->head != writer->tail) {
+        if (xdr_socket_writer_wait(writer)) {
+            return -1;
+        }
+    }
+
+    return 0;
+} /* xdr_socket_writer_drain */
+
+/*
+ * Waits for room to record 'n' more pending entries.  Room is made before
+ * each send so its entries are all recorded before any completion for it
+ * can be reaped.
+ */
+static inline int
+xdr_socket_writer_reserve(
+    xdr_socket_writer *writer,
+    uint32_t           n)
+{
+    xdr_socket_writer_retire(writer);
+
+    while (writer->size - (writer->tail - writer->head) < n) {
+        if (xdr_socket_writer_wait(writer)) {
+            return -1;
+        }
+    }
+
+    return 0;
+} /* xdr_socket_writer_reserve */
+
+static inline void
+xdr_socket_writer_push(
+    xdr_socket_writer *writer,
+    const xdr_iovec   *iov,
+    int                zerocopy,
+    int                last)
+{
+    struct xdr_socket_pending *pending;
+
+    pending       = &writer->pending[writer->tail++ % writer->size];
+    pending->iov  = *iov;
+    pending->seq  = writer->seq;
+    pending->done = !zerocopy;
+    pending->last = last;
+} /* xdr_socket_writer_push */
+
+/* Sends part of a file segment, returning bytes sent as send() would */
+static inline ssize_t
+xdr_socket_sendfile(
+    int                     fd,
+    const xdr_file_segment *seg,
+    uint32_t                off,
+    uint32_t                len)
+{
+#ifdef __linux__
+    off_t pos = seg->offset + off;
+
+    return sendfile(fd, seg->fd, &pos, len);
+#else  /* ifdef __linux__ */
+    char    buf[16384];
+    ssize_t rc;
+
+    rc = pread(seg->fd, buf, len < sizeof(buf) ? len : sizeof(buf),
+               seg->offset + off);
+
+    if (rc <= 0) {
+        return rc;
+    }
+
+    return send(fd, buf, rc, MSG_NOSIGNAL);
+#endif /* ifdef __linux__ */
+} /* xdr_socket_sendfile */
+
+/*
+ * Transmits the whole iovec array, blocking as needed.  Returns the number
+ * of bytes sent, or -1 with errno set.  Memory referenced by the iovecs
+ * must stay intact until they have been passed to the release callback.
+ */
+static inline ssize_t
+xdr_socket_writev(
+    xdr_socket_writer *writer,
+    const xdr_iovec   *iov,
+    int                niov)
+{
+    struct iovec  vec[XDR_SOCKET_BATCH];
+    struct msghdr msg;
+    struct pollfd pfd;
+    ssize_t       total = 0, rc;
+    uint32_t      off   = 0, avail, left, bytes;
+    int           i     = 0, j, n, max, zerocopy;
+
+    max = writer->size < XDR_SOCKET_BATCH ? writer->size : XDR_SOCKET_BATCH;
+
+    while (i < niov) {
+
+        if (xdr_iovec_is_file(&iov[i])) {
+            avail = xdr_iovec_len(&iov[i]) - off;
+
+            if (xdr_socket_writer_reserve(writer, 1)) {
+                return -1;
+            }
+
+            rc = avail ? xdr_socket_sendfile(writer->fd, xdr_iovec_data(&iov[i]),
+                                             off, avail) : 0;
+
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    pfd.fd     = writer->fd;
+                    pfd.events = POLLOUT;
+                    poll(&pfd, 1, -1);
+                    continue;
+                }
+                return -1;
+            } else if (rc == 0 && avail) {
+                /* File is shorter than the segment claims */
+                errno = EIO;
+                return -1;
+            }
+
+            off   += rc;
+            total += rc;
+
+            if (off == xdr_iovec_len(&iov[i])) {
+                xdr_socket_writer_push(writer, &iov[i], 0, 1);
+                xdr_socket_writer_retire(writer);
+                off = 0;
+                i++;
+            }
+
+            continue;
+        }
+
+        for (j = i, n = 0, bytes = 0;
+             j < niov && n < max && !xdr_iovec_is_file(&iov[j]);
+             ++j, ++n) {
+            vec[n].iov_base = (char *) xdr_iovec_data(&iov[j]) + (j == i ? off : 0);
+            vec[n].iov_len  = xdr_iovec_len(&iov[j]) - (j == i ? off : 0);
+            bytes          += vec[n].iov_len;
+        }
+
+        if (xdr_socket_writer_reserve(writer, n)) {
+            return -1;
+        }
+
+        zerocopy = (writer->flags & XDR_SOCKET_ZEROCOPY) &&
+            bytes >= XDR_SOCKET_ZEROCOPY_MIN;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = vec;
+        msg.msg_iovlen = n;
+
+        rc = bytes ? sendmsg(writer->fd, &msg,
+                             MSG_NOSIGNAL | (zerocopy ? MSG_ZEROCOPY : 0)) : 0;
+
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pfd.fd     = writer->fd;
+                pfd.events = POLLOUT;
+                poll(&pfd, 1, -1);
+                continue;
+            } else if (errno == ENOBUFS && zerocopy &&
+                       writer->head != writer->tail) {
+                /* Out of pinned page quota until completions arrive */
+                if (xdr_socket_writer_wait(writer)) {
+                    return -1;
+                }
+                continue;
+            }
+            return -1;
+        }
+
+        for (left = rc; i < j; off = 0, ++i) {
+            avail = xdr_iovec_len(&iov[i]) - off;
+
+            if (avail > left) {
+                if (left) {
+                    xdr_socket_writer_push(writer, &iov[i], zerocopy, 0);
+                }
+                off += left;
+                break;
+            }
+
+            xdr_socket_writer_push(writer, &iov[i], zerocopy, 1);
+
+            left -= avail;
+        }
+
+        if (zerocopy) {
+            writer->seq++;
+        }
+
+        total += rc;
+
+        xdr_socket_writer_retire(writer);
+    }
+
+    return total;
+} /* xdr_socket_writev */
+
+#endif /* ifdef XDR_SOCKET_WRITER */
+
 void
 dump_output(
     const char *format,
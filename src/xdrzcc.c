@@ -5,8 +5,11 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <getopt.h>
 #include "y.tab.h"
 
@@ -46,6 +49,27 @@ struct xdr_identifier {
 
 struct xdr_identifier *xdr_identifiers = NULL;
 
+static int             emit_stream = 0;
+
+/* Emit read-only view_<type> accessors over encoded data */
+static int             emit_views = 0;
+
+/* Union arms estimated larger than this many bytes are stored behind a pointer, 0 for none */
+static int             union_arm_limit = 0;
+
+/* Order struct members by alignment and narrow enums and bools to fit */
+static int             compact_layout = 0;
+
+/* Per-type generator options given on the command line, e.g. -c <type> */
+struct xdr_option {
+    int                opt;
+    const char        *value;
+    struct xdr_option *prev;
+    struct xdr_option *next;
+};
+
+static struct xdr_option *xdr_options = NULL;
+
 void *
 xdr_alloc(unsigned int size)
 {
@@ -80,6 +104,36 @@ xdr_strdup(const char *str)
     return out;
 } /* xdr_strdup */
 
+/* snprintf that gives up on output that would not fit rather than truncate */
+static void
+xdr_format(
+    char       *out,
+    size_t      outlen,
+    const char *fmt,
+    ...)
+__attribute__((format(printf, 3, 4)));
+
+static void
+xdr_format(
+    char       *out,
+    size_t      outlen,
+    const char *fmt,
+    ...)
+{
+    va_list args;
+    int     len;
+
+    va_start(args, fmt);
+    len = vsnprintf(out, outlen, fmt, args);
+    va_end(args);
+
+    if (len < 0 || (size_t) len >= outlen) {
+        fprintf(stderr, "Generated name '%.*s...' is too long.\n",
+                (int) outlen - 1, out);
+        exit(1);
+    }
+} /* xdr_format */
+
 void
 xdr_add_identifier(
     int   type,
@@ -103,10 +157,257 @@ xdr_add_identifier(
 
     HASH_ADD_STR(xdr_identifiers, name, ident);
 } /* xdr_add_identifier */
+
+/* The member that chains a linked list struct to its next element */
+static int
+struct_member_is_next(
+    const struct xdr_struct        *xdr_structp,
+    const struct xdr_struct_member *member)
+{
+    return xdr_structp->linkedlist &&
+           strcmp(member->name, xdr_structp->nextmember) == 0;
+} /* struct_member_is_next */
+
+/* Float and double arrays and vectors are byte swapped in bulk */
+static int
+type_is_bulk_float(struct xdr_type *type)
+{
+    return type->builtin && (strcmp(type->name, "float") == 0 ||
+                             strcmp(type->name, "double") == 0);
+} /* type_is_bulk_float */
+
+/* Width of a scalar laid out in C exactly as on the wire, or 0 */
+static int
+wire_scalar_width(struct xdr_type *type)
+{
+    if (type->optional || type->vector || type->array || type->opaque ||
+        type->narrow) {
+        return 0;
+    }
+
+    if (type->enumeration) {
+        return 4;
+    }
+
+    if (!type->builtin) {
+        return 0;
+    }
+
+    if (strcmp(type->name, "int32_t") == 0 ||
+        strcmp(type->name, "uint32_t") == 0 ||
+        strcmp(type->name, "float") == 0) {
+        return 4;
+    }
+
+    if (strcmp(type->name, "int64_t") == 0 ||
+        strcmp(type->name, "uint64_t") == 0 ||
+        strcmp(type->name, "double") == 0) {
+        return 8;
+    }
+
+    return 0;
+} /* wire_scalar_width */
+
+/*
+ * A struct of only 32 and 64-bit scalars, each at an offset that is a
+ * multiple of its width, has the same layout in C as on the wire apart
+ * from byte order.  Returns the wire size of such a struct or 0, and sets
+ * *width to the width shared by all its members, or 0 if they are mixed.
+ */
+static int
+struct_wire_size(
+    struct xdr_struct *xdr_structp,
+    int               *width)
+{
+    struct xdr_struct_member *member;
+    int                       size = 0, w, widest = 0;
+
+    if (xdr_structp->linkedlist || xdr_structp->cached ||
+        xdr_structp->passthrough) {
+        return 0;
+    }
+
+    *width = -1;
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        w = wire_scalar_width(member->type);
+
+        if (!w || size % w) {
+            return 0;
+        }
+
+        *width = (*width == -1 || *width == w) ? w : 0;
+
+        if (w > widest) {
+            widest = w;
+        }
+
+        size += w;
+    }
+
+    if (!size || size % widest) {
+        return 0;
+    }
+
+    return size;
+} /* struct_wire_size */
+
+/* Arrays and vectors of these are converted with the *_array kernels */
+static int
+type_is_bulk_array(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+    int                    width;
+
+    if (type_is_bulk_float(type)) {
+        return 1;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    return chk && chk->type == XDR_STRUCT &&
+           struct_wire_size((struct xdr_struct *) chk->ptr, &width);
+} /* type_is_bulk_array */
+
+/*
+ * The marshall functions come in variants that share their shape but not
+ * their cursor, e.g. "" for the iovec writer and "flat_" for the contiguous
+ * buffer writer.  The variant is spliced into every runtime call emitted.
+ */
 void
 emit_marshall(
     FILE            *output,
     const char      *name,
+    struct xdr_type *type,
+    const char      *variant)
+{
+    struct xdr_identifier *chk;
+    struct xdr_struct     *liststruct;
+    const char            *append;
+
+    append = variant[0] ? "xdr_flat_cursor_append" : "xdr_write_cursor_append";
+
+    if (type->opaque) {
+        if (type->array) {
+            fprintf(output,
+                    "    %s(cursor, in->%s, %s);\n",
+                    append, name, type->array_size);
+        } else if (type->zerocopy) {
+            fprintf(output,
+                    "    __marshall_%sopaque_zerocopy(&in->%s, cursor);\n",
+                    variant, name);
+        } else {
+            fprintf(output,
+                    "    __marshall_%sopaque(&in->%s, %s, cursor);\n",
+                    variant, name, type->vector_bound ? type->vector_bound : "0");
+        }
+    } else if (strcmp(type->name, "xdr_string") == 0) {
+        fprintf(output,
+                "    __marshall_%sxdr_string(&in->%s, cursor);\n",
+                variant, name);
+    } else if (type->linkedlist) {
+
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        if (!chk) {
+            fprintf(stderr, "Linked list '%s' not found.\n", type->name);
+            exit(1);
+        }
+
+        liststruct = (struct xdr_struct *) chk->ptr;
+
+        fprintf(output, "    {\n");
+        fprintf(output, "            uint32_t more;\n");
+        fprintf(output, "        const struct %s *current = in->%s;\n", type->
+                name, name);
+        fprintf(output, "        while (current != NULL) {\n");
+        fprintf(output, "            more = 1;\n");
+        fprintf(output,
+                "            __marshall_%suint32_t(&more, cursor);\n", variant);
+        fprintf(output,
+                "            __marshall_%s%s(current, cursor);\n",
+                variant, type->name);
+        fprintf(output, "            current = current->%s;\n", liststruct->
+                nextmember);
+        fprintf(output, "        }\n");
+        fprintf(output, "        more = 0;\n");
+        fprintf(output, "        __marshall_%suint32_t(&more, cursor);\n", variant);
+        fprintf(output, "    }\n");
+    } else if (type->outofline) {
+        fprintf(output, "    __marshall_%s%s(in->%s, cursor);\n",
+                variant, type->name, name);
+    } else if (type->narrow) {
+        fprintf(output, "    {\n");
+        fprintf(output, "        uint32_t v = in->%s;\n", name);
+        fprintf(output, "        __marshall_%suint32_t(&v, cursor);\n", variant);
+        fprintf(output, "    }\n");
+    } else if (type->optional) {
+        fprintf(output, "    {\n");
+        fprintf(output, "        uint32_t more = !!(in->%s);\n", name);
+        fprintf(output,
+                "        __marshall_%suint32_t(&more, cursor);\n", variant);
+        fprintf(output, "        if (more) {\n");
+        fprintf(output,
+                "        __marshall_%s%s(in->%s, cursor);\n",
+                variant, type->name, name);
+        fprintf(output, "        }\n");
+        fprintf(output, "    }\n");
+    } else if (type->vector && type_is_bulk_array(type)) {
+        fprintf(output,
+                "    __marshall_%suint32_t(&in->num_%s, cursor);\n",
+                variant, name);
+        fprintf(output, "    __marshall_%s%s_array(in->%s, in->num_%s, cursor);\n",
+                variant, type->name, name, name);
+    } else if (type->vector) {
+        fprintf(output,
+                "    __marshall_%suint32_t(&in->num_%s, cursor);\n",
+                variant, name);
+        fprintf(output, "    for (int i = 0; i < in->num_%s; i++) {\n", name);
+        fprintf(output, "        __marshall_%s%s(&in->%s[i], cursor);\n",
+                variant, type->name, name);
+        fprintf(output, "    }\n");
+    } else if (type->array && type_is_bulk_array(type)) {
+        fprintf(output, "    __marshall_%s%s_array(in->%s, %s, cursor);\n",
+                variant, type->name, name, type->array_size);
+    } else if (type->array) {
+        fprintf(output, "    for (int i = 0; i < %s; ++i) {\n",
+                type->array_size);
+        fprintf(output, "        __marshall_%s%s(&in->%s[i], cursor);\n",
+                variant, type->name, name);
+        fprintf(output, "    }\n");
+    } else {
+        fprintf(output, "    __marshall_%s%s(&in->%s, cursor);\n",
+                variant, type->name, name);
+    }
+} /* emit_marshall */
+
+/* Room for a decoded vector, inside the struct if it fits there (-i) */
+static void
+emit_vector_reserve(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type)
+{
+    if (type->inlinecap) {
+        fprintf(output, "    if (likely(out->num_%s <= %s)) {\n",
+                name, type->inlinecap);
+        fprintf(output, "        out->%s = out->%s_inline;\n", name, name);
+        fprintf(output, "    } else {\n");
+        fprintf(output, "        xdr_dbuf_reserve(out, %s, out->num_%s, dbuf);\n",
+                name, name);
+        fprintf(output, "    }\n");
+    } else {
+        fprintf(output, "    xdr_dbuf_reserve(out, %s, out->num_%s, dbuf);\n",
+                name, name);
+    }
+} /* emit_vector_reserve */
+
+void
+emit_unmarshall(
+    FILE            *output,
+    const char      *owner,
+    const char      *name,
     struct xdr_type *type)
 {
     struct xdr_identifier *chk;
@@ -115,201 +416,2592 @@ emit_marshall(
     if (type->opaque) {
         if (type->array) {
             fprintf(output,
-                    "    xdr_write_cursor_append(cursor, in->%s, %s);\n",
+                    "    rc = xdr_read_cursor_extract(cursor, out->%s, %s);\n",
                     name, type->array_size);
         } else if (type->zerocopy) {
             fprintf(output,
-                    "    __marshall_opaque_zerocopy(&in->%s, cursor);\n",
-                    name);
+                    "    rc = __unmarshall_opaque_zerocopy(&out->%s, \"%s.%s\", cursor, dbuf);\n",
+                    name, owner, name);
+        } else if (type->inlinecap) {
+            fprintf(output,
+                    "    rc = __unmarshall_opaque_inline(&out->%s, out->%s_inline, %s, cursor, dbuf);\n",
+                    name, name, type->inlinecap);
         } else {
             fprintf(output,
-                    "    __marshall_opaque(&in->%s, %s, cursor);\n",
+                    "    rc = __unmarshall_opaque(&out->%s, %s, cursor, dbuf);\n",
                     name, type->vector_bound ? type->vector_bound : "0");
         }
     } else if (strcmp(type->name, "xdr_string") == 0) {
         fprintf(output,
-                "    __marshall_xdr_string(&in->%s, cursor);\n",
-                name);
+                "    rc = __unmarshall_%s(&out->%s, cursor, dbuf);\n",
+                type->name, name);
     } else if (type->linkedlist) {
 
-        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        if (!chk) {
+            fprintf(stderr, "Linked list '%s' not found.\n", type->name);
+            exit(1);
+        }
+
+        liststruct = (struct xdr_struct *) chk->ptr;
+
+        fprintf(output, "    {\n");
+        fprintf(output, "            uint32_t more;\n");
+        fprintf(output,
+                "        rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n")
+        ;
+        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "        len += rc;\n");
+
+        fprintf(output, "        out->%s = NULL;\n", name);
+        fprintf(output, "        struct %s *current = NULL, *last = NULL;\n", type->name);
+        fprintf(output, "        while (more) {\n");
+        fprintf(output, "          xdr_dbuf_alloc_space(current, sizeof(*current), dbuf);\n");
+        fprintf(output,
+                "        rc = __unmarshall_%s(current, cursor, dbuf);\n",
+                type->name);
+        fprintf(output, "         if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "         len += rc;\n");
+        fprintf(output, "         if (last) {\n");
+        fprintf(output, "             last->%s = current;\n", liststruct->nextmember);
+        fprintf(output, "         } else {\n");
+        fprintf(output, "             out->%s = current;\n", name);
+        fprintf(output, "        }\n");
+        fprintf(output, "         last = current;\n");
+        fprintf(output, "        last->%s = NULL;\n", liststruct->nextmember);
+        fprintf(output, "         rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n");
+        fprintf(output, "         if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "         len += rc;\n");
+        fprintf(output, "        }\n");
+        fprintf(output, "        rc = 0;\n");
+        fprintf(output, "    }\n");
+    } else if (type->narrow) {
+        /* Values that do not survive narrowing are rejected */
+        fprintf(output, "    {\n");
+        fprintf(output, "        uint32_t v;\n");
+        fprintf(output, "        rc = __unmarshall_uint32_t(&v, cursor, dbuf);\n");
+        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "        out->%s = v;\n", name);
+        fprintf(output, "        if (unlikely((uint32_t) out->%s != v)) return -1;\n",
+                name);
+        fprintf(output, "    }\n");
+    } else if (type->outofline) {
+        fprintf(output,
+                "    xdr_dbuf_alloc_space(out->%s, sizeof(*out->%s), dbuf);\n",
+                name, name);
+        fprintf(output,
+                "    rc = __unmarshall_%s(out->%s, cursor, dbuf);\n",
+                type->name, name);
+    } else if (type->optional) {
+        fprintf(output, "    {\n");
+        fprintf(output, "        uint32_t more;\n");
+        fprintf(output,
+                "        rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n")
+        ;
+        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "        len += rc;\n");
+        fprintf(output, "        rc = 0;\n");
+        fprintf(output, "        if (more) {\n");
+        fprintf(output, "         xdr_dbuf_alloc_space(out->%s, sizeof(*out->%s), dbuf);\n", name, name);
+        fprintf(output,
+                "        rc = __unmarshall_%s(out->%s, cursor, dbuf);\n",
+                type->name, name);
+        fprintf(output, "        } else {\n");
+        fprintf(output, "            out->%s = NULL;\n", name);
+        fprintf(output, "        };\n");
+        fprintf(output, "    }\n");
+    } else if (type->vector && type_is_bulk_array(type)) {
+        fprintf(output,
+                "    rc = __unmarshall_uint32_t(&out->num_%s, cursor, dbuf);\n",
+                name);
+        fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "    len += rc;\n");
+        emit_vector_reserve(output, name, type);
+        fprintf(output,
+                "    rc = __unmarshall_%s_array(out->%s, out->num_%s, cursor, dbuf);\n",
+                type->name, name, name);
+    } else if (type->array && type_is_bulk_array(type)) {
+        fprintf(output,
+                "    rc = __unmarshall_%s_array(out->%s, %s, cursor, dbuf);\n",
+                type->name, name, type->array_size);
+    } else if (type->vector) {
+        fprintf(output,
+                "    rc = __unmarshall_uint32_t(&out->num_%s, cursor, dbuf);\n",
+                name);
+        fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "    len += rc;\n");
+        emit_vector_reserve(output, name, type);
+        fprintf(output, "    for (int i = 0; i < out->num_%s; i++) {\n", name);
+        fprintf(output,
+                "    rc = __unmarshall_%s(&out->%s[i], cursor, dbuf);\n",
+                type->name, name);
+        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "        len += rc;\n");
+        fprintf(output, "    }\n");
+        fprintf(output, "    rc = 0;\n");
+    } else if (type->array) {
+        fprintf(output, "    for (int i = 0; i < %s; i++) {\n",
+                type->array_size);
+        fprintf(output,
+                "    rc = __unmarshall_%s(&out->%s[i], cursor, dbuf);\n",
+                type->name, name);
+        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+        fprintf(output, "        len += rc;\n");
+        fprintf(output, "    }\n");
+        fprintf(output, "    rc = 0;\n");
+    } else {
+        fprintf(output,
+                "    rc = __unmarshall_%s(&out->%s, cursor, dbuf);\n",
+                type->name, name);
+    }
+
+    fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "    len += rc;\n");
+} /* emit_unmarshall */
+
+/*
+ * Lists named with -a are decoded into one array of num_<member> elements.
+ * The count is unknown until the terminating marker, so the array is grown
+ * by doubling within the dbuf.  The next pointers are linked up afterwards
+ * so that the result can still be walked as a list.
+ */
+static void
+emit_unmarshall_listarray(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+    struct xdr_struct     *liststruct;
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    liststruct = (struct xdr_struct *) chk->ptr;
+
+    fprintf(output, "    {\n");
+    fprintf(output, "        uint32_t more, cap = 0;\n");
+    fprintf(output, "        struct %s *grown;\n", type->name);
+    fprintf(output, "        rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n");
+    fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "        len += rc;\n");
+    fprintf(output, "        out->%s = NULL;\n", name);
+    fprintf(output, "        out->num_%s = 0;\n", name);
+    fprintf(output, "        while (more) {\n");
+    fprintf(output, "            if (out->num_%s == cap) {\n", name);
+    fprintf(output, "                cap = cap ? cap * 2 : XDR_LIST_ARRAY_MIN;\n");
+    fprintf(output, "                xdr_dbuf_alloc_space(grown, cap * sizeof(*grown), dbuf);\n");
+    fprintf(output, "                if (out->num_%s) {\n", name);
+    fprintf(output, "                    memcpy(grown, out->%s, out->num_%s * sizeof(*grown));\n",
+            name, name);
+    fprintf(output, "                }\n");
+    fprintf(output, "                out->%s = grown;\n", name);
+    fprintf(output, "            }\n");
+    fprintf(output, "            rc = __unmarshall_%s(&out->%s[out->num_%s], cursor, dbuf);\n",
+            type->name, name, name);
+    fprintf(output, "            if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "            len += rc;\n");
+    fprintf(output, "            out->num_%s++;\n", name);
+    fprintf(output, "            rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n");
+    fprintf(output, "            if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "            len += rc;\n");
+    fprintf(output, "        }\n");
+    fprintf(output, "        for (uint32_t i = 0; i < out->num_%s; ++i) {\n", name);
+    fprintf(output, "            out->%s[i].%s = i + 1 < out->num_%s ? &out->%s[i + 1] : NULL;\n",
+            name, liststruct->nextmember, name, name);
+    fprintf(output, "        }\n");
+    fprintf(output, "    }\n");
+} /* emit_unmarshall_listarray */
+
+/* Unmarshall an opaque member named with -k along with its CRC32C */
+static void
+emit_unmarshall_checksum(
+    FILE            *output,
+    const char      *owner,
+    const char      *name,
+    struct xdr_type *type)
+{
+    if (type->zerocopy) {
+        fprintf(output,
+                "    rc = __unmarshall_opaque_zerocopy_crc32c(&out->%s, \"%s.%s\", &out->%s_crc32c, cursor, dbuf);\n",
+                name, owner, name, name);
+    } else {
+        fprintf(output,
+                "    rc = __unmarshall_opaque_crc32c(&out->%s, %s, &out->%s_crc32c, cursor, dbuf);\n",
+                name, type->vector_bound ? type->vector_bound : "0", name);
+    }
+
+    fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "    len += rc;\n");
+} /* emit_unmarshall_checksum */
+
+/*
+ * Unmarshall a member declared with a -H typedef along with its hash,
+ * and/or with a -u typedef with UTF-8 validation
+ */
+static void
+emit_unmarshall_name(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type,
+    const char      *hashtype,
+    int              utf8)
+{
+    struct xdr_identifier *chk;
+    struct xdr_type       *emit_type = type;
+    const char            *bound;
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    if (chk && chk->type == XDR_TYPEDEF) {
+        emit_type = ((struct xdr_typedef *) chk->ptr)->type;
+    }
+
+    bound = emit_type->vector_bound ? emit_type->vector_bound : "0";
+
+    if (hashtype && emit_type->opaque) {
+        fprintf(output,
+                "    rc = __unmarshall_opaque_hash(&out->%s, %s, \"%s\", &out->%s_hash, %d, cursor, dbuf);\n",
+                name, bound, hashtype, name, utf8);
+    } else if (hashtype) {
+        fprintf(output,
+                "    rc = __unmarshall_xdr_string_hash(&out->%s, \"%s\", &out->%s_hash, %d, cursor, dbuf);\n",
+                name, hashtype, name, utf8);
+    } else if (emit_type->opaque) {
+        fprintf(output,
+                "    rc = __unmarshall_opaque_utf8(&out->%s, %s, cursor, dbuf);\n",
+                name, bound);
+    } else {
+        fprintf(output,
+                "    rc = __unmarshall_xdr_string_utf8(&out->%s, cursor, dbuf);\n",
+                name);
+    }
+
+    fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
+    fprintf(output, "    len += rc;\n");
+} /* emit_unmarshall_name */
+
+/*
+ * List and vector members named with -l are encoded from their
+ * xdr_marshall_list control when one is attached.  Vector counts are not
+ * known until the elements run out, so a slot is reserved and filled in.
+ * Each element is sized before it is encoded, so one that would break the
+ * budget is never written and a buffer sized to the budget cannot overflow.
+ */
+static void
+emit_marshall_listctl(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type,
+    const char      *variant)
+{
+    struct xdr_identifier *chk;
+    struct xdr_struct     *liststruct;
+    const char            *structstr = type->builtin ? "" : "struct ";
+    const char            *kind      = variant[0] ? "flat" : "write";
+
+    fprintf(output, "    if (in->%s_ctl) {\n", name);
+    fprintf(output, "        xdr_marshall_list *ctl = in->%s_ctl;\n", name);
+    fprintf(output, "        const %s%s *current;\n", structstr, type->name);
+    fprintf(output,
+            "        uint32_t start = xdr_%s_cursor_position(cursor);\n",
+            kind);
+
+    if (type->linkedlist) {
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        liststruct = (struct xdr_struct *) chk->ptr;
+
+        fprintf(output, "        uint32_t more = 1;\n");
+        fprintf(output, "        ctl->count = 0;\n");
+        fprintf(output, "        ctl->truncated = 0;\n");
+        fprintf(output,
+                "        current = ctl->next ? ctl->next(ctl->arg) : in->%s;\n",
+                name);
+        fprintf(output, "        while (current) {\n");
+        /* Room must remain for the element's marker and the terminating one */
+        fprintf(output,
+                "            if (unlikely(xdr_%s_cursor_position(cursor) - start + 8 +\n",
+                kind);
+        fprintf(output,
+                "                         __marshall_length_%s(current) > ctl->budget)) {\n",
+                type->name);
+        fprintf(output, "                ctl->truncated = 1;\n");
+        fprintf(output, "                break;\n");
+        fprintf(output, "            }\n");
+        fprintf(output, "            __marshall_%suint32_t(&more, cursor);\n",
+                variant);
+        fprintf(output, "            __marshall_%s%s(current, cursor);\n",
+                variant, type->name);
+        fprintf(output, "            ctl->count++;\n");
+        fprintf(output,
+                "            current = ctl->next ? ctl->next(ctl->arg) : current->%s;\n",
+                liststruct->nextmember);
+        fprintf(output, "        }\n");
+        fprintf(output, "        more = 0;\n");
+        fprintf(output, "        __marshall_%suint32_t(&more, cursor);\n",
+                variant);
+    } else {
+        fprintf(output,
+                "        void *slot = xdr_%s_cursor_reserve(cursor, 4);\n",
+                kind);
+        fprintf(output, "        ctl->count = 0;\n");
+        fprintf(output, "        ctl->truncated = 0;\n");
+        fprintf(output,
+                "        while ((current = xdr_marshall_list_next(ctl, in->%s, sizeof(*in->%s), in->num_%s))) {\n",
+                name, name, name);
+        fprintf(output,
+                "            if (unlikely(xdr_%s_cursor_position(cursor) - start +\n",
+                kind);
+        fprintf(output,
+                "                         __marshall_length_%s(current) > ctl->budget)) {\n",
+                type->name);
+        fprintf(output, "                ctl->truncated = 1;\n");
+        fprintf(output, "                break;\n");
+        fprintf(output, "            }\n");
+        fprintf(output, "            __marshall_%s%s(current, cursor);\n",
+                variant, type->name);
+        fprintf(output, "            ctl->count++;\n");
+        fprintf(output, "        }\n");
+        fprintf(output, "        xdr_marshall_list_count(slot, ctl->count);\n");
+    }
+
+    fprintf(output, "    } else {\n");
+    emit_marshall(output, name, type, variant);
+    fprintf(output, "    }\n");
+} /* emit_marshall_listctl */
+
+/*
+ * Bodies of passthrough types replay the bytes they were decoded from
+ * unless they have been marked dirty since.
+ */
+static void
+emit_wire_replay(
+    FILE       *source,
+    const char *variant)
+{
+    fprintf(source, "    if (in->xdr_wire.range.length && !in->xdr_wire.dirty) {\n");
+    fprintf(source, "        __marshall_%swire(&in->xdr_wire, cursor);\n", variant);
+    fprintf(source, "        return;\n");
+    fprintf(source, "    }\n");
+} /* emit_wire_replay */
+
+static void
+emit_wire_length(FILE *source)
+{
+    fprintf(source, "    if (in->xdr_wire.range.length && !in->xdr_wire.dirty) {\n");
+    fprintf(source, "        return in->xdr_wire.range.length;\n");
+    fprintf(source, "    }\n");
+} /* emit_wire_length */
+
+static void
+emit_wire_start(FILE *source)
+{
+    fprintf(source, "    const xdr_iovec *wire_start = cursor->cur;\n");
+    fprintf(source, "    unsigned int wire_iov_offset = cursor->iov_offset;\n");
+    fprintf(source, "    unsigned int wire_offset = cursor->offset;\n");
+} /* emit_wire_start */
+
+static void
+emit_wire_finish(FILE *source)
+{
+    fprintf(source,
+            "    __unmarshall_wire(&out->xdr_wire, wire_start, wire_iov_offset, wire_offset, cursor, dbuf);\n");
+} /* emit_wire_finish */
+
+/*
+ * Bodies of cached types first try to splice in a memoized encoding, and
+ * otherwise record the fresh one on the way out if a cache is attached.
+ */
+static void
+emit_cache_lookup(
+    FILE       *source,
+    const char *variant)
+{
+    if (strcmp(variant, "flat_") == 0) {
+        fprintf(source, "    unsigned int cache_start = cursor->used;\n");
+    } else {
+        fprintf(source, "    int cache_start = cursor->scratch_used;\n");
+        fprintf(source, "    int cache_niov = cursor->niov;\n");
+        fprintf(source, "    int cache_nchunk = cursor->nchunk;\n");
+    }
+    fprintf(source, "    if (xdr_encode_cache_hit(in->xdr_cache, in->xdr_cache_key)) {\n");
+    fprintf(source, "        __marshall_%scached(in->xdr_cache, cursor);\n", variant);
+    fprintf(source, "        return;\n");
+    fprintf(source, "    }\n");
+} /* emit_cache_lookup */
+
+static void
+emit_cache_fill(
+    FILE       *source,
+    const char *variant)
+{
+    fprintf(source, "    if (in->xdr_cache) {\n");
+    if (strcmp(variant, "flat_") == 0) {
+        fprintf(source,
+                "        __marshall_flat_cache_fill(in->xdr_cache, in->xdr_cache_key, cursor, cache_start);\n");
+    } else {
+        fprintf(source,
+                "        __marshall_cache_fill(in->xdr_cache, in->xdr_cache_key, cursor, cache_start, cache_niov, cache_nchunk);\n");
+    }
+    fprintf(source, "    }\n");
+} /* emit_cache_fill */
+
+/*
+ * Marshall an opaque member named with -k, storing the CRC32C of its payload
+ * through <member>_crc32c when that pointer is set.
+ */
+static void
+emit_marshall_checksum(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type,
+    const char      *variant)
+{
+    if (type->zerocopy) {
+        fprintf(output,
+                "    __marshall_%sopaque_zerocopy_crc32c(&in->%s, in->%s_crc32c, cursor);\n",
+                variant, name, name);
+    } else {
+        fprintf(output,
+                "    __marshall_%sopaque_crc32c(&in->%s, %s, in->%s_crc32c, cursor);\n",
+                variant, name, type->vector_bound ? type->vector_bound : "0",
+                name);
+    }
+} /* emit_marshall_checksum */
+
+/*
+ * Lists named with -a are encoded from num_<member> consecutive elements
+ * when that count is set, ignoring their next pointers, and walked as a
+ * list otherwise.
+ */
+static void
+emit_marshall_listarray(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type,
+    const char      *variant)
+{
+    fprintf(output, "    if (in->num_%s) {\n", name);
+    fprintf(output, "        uint32_t more = 1;\n");
+    fprintf(output, "        for (uint32_t i = 0; i < in->num_%s; ++i) {\n", name);
+    fprintf(output, "            __marshall_%suint32_t(&more, cursor);\n", variant);
+    fprintf(output, "            __marshall_%s%s(&in->%s[i], cursor);\n",
+            variant, type->name, name);
+    fprintf(output, "        }\n");
+    fprintf(output, "        more = 0;\n");
+    fprintf(output, "        __marshall_%suint32_t(&more, cursor);\n", variant);
+    fprintf(output, "    } else {\n");
+    emit_marshall(output, name, type, variant);
+    fprintf(output, "    }\n");
+} /* emit_marshall_listarray */
+
+void
+emit_marshall_struct(
+    FILE              *source,
+    struct xdr_struct *xdr_structp,
+    const char        *variant,
+    const char        *cursor_type)
+{
+    struct xdr_struct_member *member;
+
+    fprintf(source, "static void\n");
+    fprintf(source, "__marshall_%s%s(\n", variant, xdr_structp->name);
+    fprintf(source, "    const struct %s *in,\n", xdr_structp->name);
+    fprintf(source, "    struct %s *cursor) {\n", cursor_type);
+
+    if (xdr_structp->passthrough) {
+        emit_wire_replay(source, variant);
+    }
+
+    if (xdr_structp->cached) {
+        emit_cache_lookup(source, variant);
+    }
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        if (member->listctl) {
+            emit_marshall_listctl(source, member->name, member->type,
+                                  variant);
+        } else if (member->checksum) {
+            emit_marshall_checksum(source, member->name, member->type,
+                                   variant);
+        } else if (member->listarray) {
+            emit_marshall_listarray(source, member->name, member->type,
+                                    variant);
+        } else {
+            emit_marshall(source, member->name, member->type, variant);
+        }
+    }
+
+    if (xdr_structp->cached) {
+        emit_cache_fill(source, variant);
+    }
+
+    fprintf(source, "}\n\n");
+} /* emit_marshall_struct */
+
+/*
+ * Unions with at least this many case labels, packed at least half as
+ * densely as the range of values they span, are dispatched through a
+ * table of per-arm functions indexed by the discriminant.
+ */
+#define XDR_JUMP_TABLE_MIN 8
+
+struct union_dispatch {
+    int64_t                 min;
+    int                     span;
+    struct xdr_union_case **slot;     /* label at min + i, NULL if none */
+    struct xdr_union_case **outlier;  /* labels outside the table */
+    int                     noutlier;
+};
+
+/* Numeric value of a case label given as a number, const or enum entry */
+static int
+resolve_label(
+    const char *label,
+    int64_t    *value,
+    int         depth)
+{
+    struct xdr_identifier *chk;
+    struct xdr_enum       *xdr_enump;
+    struct xdr_enum_entry *xdr_enum_entryp;
+    char                  *end;
+
+    if (depth > 16) {
+        return 0;
+    }
+
+    *value = strtoll(label, &end, 0);
+
+    if (end != label && *end == '\0') {
+        return 1;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, label, chk);
+
+    if (chk && chk->type == XDR_CONST) {
+        return resolve_label(((struct xdr_const *) chk->ptr)->value, value,
+                             depth + 1);
+    }
+
+    DL_FOREACH(xdr_enums, xdr_enump)
+    {
+        DL_FOREACH(xdr_enump->entries, xdr_enum_entryp)
+        {
+            if (strcmp(xdr_enum_entryp->name, label) == 0) {
+                return resolve_label(xdr_enum_entryp->value, value, depth + 1);
+            }
+        }
+    }
+
+    return 0;
+} /* resolve_label */
+
+/*
+ * The case whose code runs for a label, following labels without a body
+ * through to the next one as the switch does, or NULL for the default.
+ */
+static struct xdr_union_case *
+union_case_arm(struct xdr_union_case *casep)
+{
+    for (; casep; casep = casep->next) {
+        if (strcmp(casep->label, "default") != 0 &&
+            (casep->type || casep->voided)) {
+            return casep;
+        }
+    }
+
+    return NULL;
+} /* union_case_arm */
+
+static struct xdr_union_case *
+union_default_arm(struct xdr_union *xdr_unionp)
+{
+    struct xdr_union_case *casep;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") == 0 && casep->type) {
+            return casep;
+        }
+    }
+
+    return NULL;
+} /* union_default_arm */
+
+/*
+ * Choose the densest run of case values covering the most labels.  Labels
+ * outside it, such as an OP_ILLEGAL far beyond the regular operations, are
+ * left to a switch on the out of range path.  Returns 0 if the union is
+ * too small or too sparse for a table.
+ */
+static int
+union_dispatch_plan(
+    struct xdr_union      *xdr_unionp,
+    struct union_dispatch *plan)
+{
+    struct xdr_union_case  *casep, **cases, *swap_case;
+    int64_t                *values, swap_value;
+    int                     n = 0, i, j, count, best = 0, first = 0;
+    int64_t                 span, best_span = 0;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        n++;
+    }
+
+    if (n < XDR_JUMP_TABLE_MIN) {
+        return 0;
+    }
+
+    cases  = xdr_alloc(n * sizeof(*cases));
+    values = xdr_alloc(n * sizeof(*values));
+    n      = 0;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") == 0) {
+            continue;
+        }
+
+        if (!resolve_label(casep->label, &values[n], 0)) {
+            return 0;
+        }
+
+        cases[n++] = casep;
+    }
+
+    for (i = 1; i < n; ++i) {
+        for (j = i; j > 0 && values[j - 1] > values[j]; --j) {
+            swap_value    = values[j];
+            values[j]     = values[j - 1];
+            values[j - 1] = swap_value;
+            swap_case     = cases[j];
+            cases[j]      = cases[j - 1];
+            cases[j - 1]  = swap_case;
+        }
+    }
+
+    for (i = 0; i < n; ++i) {
+        for (j = i; j < n; ++j) {
+            count = j - i + 1;
+            span  = values[j] - values[i] + 1;
+
+            if (span <= 2 * count &&
+                (count > best || (count == best && span < best_span))) {
+                best      = count;
+                best_span = span;
+                first     = i;
+            }
+        }
+    }
+
+    if (best < XDR_JUMP_TABLE_MIN) {
+        return 0;
+    }
+
+    plan->min      = values[first];
+    plan->span     = best_span;
+    plan->slot     = xdr_alloc(best_span * sizeof(*plan->slot));
+    plan->outlier  = xdr_alloc(n * sizeof(*plan->outlier));
+    plan->noutlier = 0;
+
+    for (i = 0; i < n; ++i) {
+        if (i >= first && i < first + best) {
+            plan->slot[values[i] - plan->min] = cases[i];
+        } else {
+            plan->outlier[plan->noutlier++] = cases[i];
+        }
+    }
+
+    return 1;
+} /* union_dispatch_plan */
+
+/* Name of the function for an arm, where prefix is e.g. __unmarshall_U */
+static const char *
+arm_name(
+    char                  *buf,
+    int                    size,
+    const char            *prefix,
+    struct xdr_union_case *arm)
+{
+    if (!arm) {
+        xdr_format(buf, size, "%s_default", prefix);
+    } else if (arm->voided) {
+        xdr_format(buf, size, "%s_void", prefix);
+    } else {
+        xdr_format(buf, size, "%s_arm_%s", prefix, arm->name);
+    }
+
+    return buf;
+} /* arm_name */
+
+static struct xdr_union_case *
+slot_arm(
+    struct union_dispatch *plan,
+    int                    i)
+{
+    return plan->slot[i] ? union_case_arm(plan->slot[i]) : NULL;
+} /* slot_arm */
+
+/*
+ * Emit the table of arm functions for a union, "rtype (*)(params)", with
+ * values that have no label of their own running the default arm.
+ */
+static void
+emit_union_jump_table(
+    FILE                  *source,
+    struct union_dispatch *plan,
+    const char            *prefix,
+    const char            *rtype,
+    const char            *params)
+{
+    char name[256];
+    int  i;
+
+    fprintf(source, "static %s (*const %s_arms[%d])(%s) = {\n",
+            rtype, prefix, plan->span, params);
+
+    for (i = 0; i < plan->span; ++i) {
+        arm_name(name, sizeof(name), prefix, slot_arm(plan, i));
+
+        if (plan->slot[i]) {
+            fprintf(source, "    %s, /* %s */\n", name, plan->slot[i]->label);
+        } else {
+            fprintf(source, "    %s,\n", name);
+        }
+    }
+
+    fprintf(source, "};\n\n");
+} /* emit_union_jump_table */
+
+/*
+ * Emit the dispatch on the discriminant: one range check and an indirect
+ * call through the table, with any outlying labels and the default arm
+ * on the slow path.  Each call is emitted as "<call><function><args>;".
+ */
+static void
+emit_union_jump(
+    FILE                  *source,
+    struct xdr_union      *xdr_unionp,
+    struct union_dispatch *plan,
+    const char            *prefix,
+    const char            *var,
+    const char            *call,
+    const char            *args)
+{
+    char name[256];
+    int  i;
+
+    fprintf(source, "    {\n");
+    fprintf(source,
+            "        uint64_t arm = (uint64_t) ((int64_t) %s->%s - (%lldLL));\n",
+            var, xdr_unionp->pivot_name, (long long) plan->min);
+    fprintf(source, "        if (likely(arm < %d)) {\n", plan->span);
+    fprintf(source, "            %s%s_arms[arm]%s;\n", call, prefix, args);
+    fprintf(source, "        } else {\n");
+
+    if (plan->noutlier) {
+        fprintf(source, "            switch (%s->%s) {\n",
+                var, xdr_unionp->pivot_name);
+
+        for (i = 0; i < plan->noutlier; ++i) {
+            arm_name(name, sizeof(name), prefix,
+                     union_case_arm(plan->outlier[i]));
+            fprintf(source, "            case %s:\n", plan->outlier[i]->label);
+            fprintf(source, "                %s%s%s;\n", call, name, args);
+            fprintf(source, "                break;\n");
+        }
+
+        fprintf(source, "            default:\n");
+        fprintf(source, "                %s%s_default%s;\n", call, prefix,
+                args);
+        fprintf(source, "                break;\n");
+        fprintf(source, "            }\n");
+    } else {
+        fprintf(source, "            %s%s_default%s;\n", call, prefix, args);
+    }
+
+    fprintf(source, "        }\n");
+    fprintf(source, "    }\n");
+} /* emit_union_jump */
+
+/*
+ * Emit a function per arm of a dispatched union by calling emit_arm with
+ * the function name and the arm's case: one for each case with a body,
+ * one shared by all void cases and one for the default, which is passed
+ * the default case or NULL if there is none.
+ */
+static void
+emit_union_arms(
+    FILE                  *source,
+    struct xdr_union      *xdr_unionp,
+    struct union_dispatch *plan,
+    const char            *prefix,
+    const char            *variant,
+    void (                *emit_arm)(
+        FILE *,
+        struct xdr_union *,
+        struct xdr_union_case *,
+        const char *,
+        const char *))
+{
+    struct xdr_union_case *casep;
+    char                   name[256];
+    int                    i, voided = 0;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") != 0 && casep->type) {
+            emit_arm(source, xdr_unionp, casep,
+                     arm_name(name, sizeof(name), prefix, casep), variant);
+        }
+    }
+
+    for (i = 0; i < plan->span; ++i) {
+        voided |= slot_arm(plan, i) && slot_arm(plan, i)->voided;
+    }
+
+    for (i = 0; i < plan->noutlier; ++i) {
+        casep   = union_case_arm(plan->outlier[i]);
+        voided |= casep && casep->voided;
+    }
+
+    if (voided) {
+        xdr_format(name, sizeof(name), "%s_void", prefix);
+        emit_arm(source, xdr_unionp, NULL, name, variant);
+    }
+
+    emit_arm(source, xdr_unionp, union_default_arm(xdr_unionp),
+             arm_name(name, sizeof(name), prefix, NULL), variant);
+} /* emit_union_arms */
+
+static void
+emit_marshall_arm(
+    FILE                  *source,
+    struct xdr_union      *xdr_unionp,
+    struct xdr_union_case *arm,
+    const char            *name,
+    const char            *variant)
+{
+    fprintf(source, "static void\n");
+    fprintf(source, "%s(\n", name);
+    fprintf(source, "    const struct %s *in,\n", xdr_unionp->name);
+    fprintf(source, "    struct %s *cursor) {\n",
+            variant[0] ? "xdr_flat_cursor" : "xdr_write_cursor");
+
+    if (arm) {
+        emit_marshall(source, arm->name, arm->type, variant);
+    }
+
+    fprintf(source, "}\n\n");
+} /* emit_marshall_arm */
+
+static void
+emit_unmarshall_arm(
+    FILE                  *source,
+    struct xdr_union      *xdr_unionp,
+    struct xdr_union_case *arm,
+    const char            *name,
+    const char            *variant)
+{
+    fprintf(source, "static int\n");
+    fprintf(source, "%s(\n", name);
+    fprintf(source, "    struct %s *out,\n", xdr_unionp->name);
+    fprintf(source, "    struct xdr_read_cursor *cursor,\n");
+    fprintf(source, "    xdr_dbuf *dbuf) {\n");
+
+    if (arm) {
+        fprintf(source, "    int rc, len = 0;\n");
+        emit_unmarshall(source, xdr_unionp->name, arm->name, arm->type);
+        fprintf(source, "    return len;\n");
+    } else {
+        fprintf(source, "    return 0;\n");
+    }
+
+    fprintf(source, "}\n\n");
+} /* emit_unmarshall_arm */
+
+void
+emit_marshall_union(
+    FILE             *source,
+    struct xdr_union *xdr_unionp,
+    const char       *variant,
+    const char       *cursor_type)
+{
+    struct xdr_union_case *casep;
+    struct union_dispatch  plan;
+    char                   prefix[256], params[256];
+    int                    dispatch;
+
+    dispatch = union_dispatch_plan(xdr_unionp, &plan);
+
+    if (dispatch) {
+        xdr_format(prefix, sizeof(prefix), "__marshall_%s%s",
+                   variant, xdr_unionp->name);
+        xdr_format(params, sizeof(params), "const struct %s *, struct %s *",
+                   xdr_unionp->name, cursor_type);
+        emit_union_arms(source, xdr_unionp, &plan, prefix, variant,
+                        emit_marshall_arm);
+        emit_union_jump_table(source, &plan, prefix, "void", params);
+    }
+
+    fprintf(source, "static void\n");
+    fprintf(source, "__marshall_%s%s(\n", variant, xdr_unionp->name);
+    fprintf(source, "    const struct %s *in,\n", xdr_unionp->name);
+    fprintf(source, "    struct %s *cursor) {\n", cursor_type);
+
+    if (xdr_unionp->passthrough) {
+        emit_wire_replay(source, variant);
+    }
+
+    if (xdr_unionp->cached) {
+        emit_cache_lookup(source, variant);
+    }
+
+    emit_marshall(source, xdr_unionp->pivot_name, xdr_unionp->pivot_type,
+                  variant);
+
+    if (dispatch) {
+        emit_union_jump(source, xdr_unionp, &plan, prefix, "in", "",
+                        "(in, cursor)");
+
+        if (xdr_unionp->cached) {
+            emit_cache_fill(source, variant);
+        }
+
+        fprintf(source, "}\n\n");
+        return;
+    }
+
+    fprintf(source, "    switch (in->%s) {\n", xdr_unionp->pivot_name);
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") != 0) {
+            fprintf(source, "    case %s:\n", casep->label);
+            if (casep->voided) {
+                fprintf(source, "        break;\n");
+            } else if (casep->type) {
+                emit_marshall(source, casep->name, casep->type, variant);
+                fprintf(source, "        break;\n");
+            }
+        }
+    }
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") == 0) {
+            fprintf(source, "    default:\n");
+            if (casep->voided) {
+                fprintf(source, "        break;\n");
+            } else if (casep->type) {
+                emit_marshall(source, casep->name, casep->type, variant);
+                fprintf(source, "        break;\n");
+            }
+        }
+    }
+
+    fprintf(source, "    }\n");
+    fprintf(source, "    ;\n");
+
+    if (xdr_unionp->cached) {
+        emit_cache_fill(source, variant);
+    }
+
+    fprintf(source, "}\n\n");
+} /* emit_marshall_union */
+
+void
+emit_unmarshall_union(
+    FILE             *source,
+    struct xdr_union *xdr_unionp)
+{
+    struct xdr_union_case *casep;
+    struct union_dispatch  plan;
+    char                   prefix[256], params[256];
+    int                    dispatch;
+
+    dispatch = union_dispatch_plan(xdr_unionp, &plan);
+
+    if (dispatch) {
+        xdr_format(prefix, sizeof(prefix), "__unmarshall_%s", xdr_unionp->name);
+        xdr_format(params, sizeof(params),
+                   "struct %s *, struct xdr_read_cursor *, xdr_dbuf *",
+                   xdr_unionp->name);
+        emit_union_arms(source, xdr_unionp, &plan, prefix, "",
+                        emit_unmarshall_arm);
+        emit_union_jump_table(source, &plan, prefix, "int", params);
+    }
+
+    fprintf(source, "static int\n");
+    fprintf(source, "__unmarshall_%s(\n", xdr_unionp->name);
+    fprintf(source, "    struct %s *out,\n", xdr_unionp->name);
+    fprintf(source, "    struct xdr_read_cursor *cursor,\n");
+    fprintf(source, "    xdr_dbuf *dbuf) {\n");
+    fprintf(source, "    int rc, len = 0;\n");
+
+    if (xdr_unionp->cached) {
+        fprintf(source, "    out->xdr_cache = NULL;\n");
+    }
+
+    if (xdr_unionp->passthrough) {
+        emit_wire_start(source);
+    }
+
+    emit_unmarshall(source, xdr_unionp->name, xdr_unionp->pivot_name,
+                    xdr_unionp->pivot_type);
+
+    if (dispatch) {
+        emit_union_jump(source, xdr_unionp, &plan, prefix, "out", "rc = ",
+                        "(out, cursor, dbuf)");
+        fprintf(source, "    if (unlikely(rc < 0)) return rc;\n");
+        fprintf(source, "    len += rc;\n");
+        if (xdr_unionp->passthrough) {
+            emit_wire_finish(source);
+        }
+        fprintf(source, "    return len;\n");
+        fprintf(source, "}\n\n");
+        return;
+    }
+
+    fprintf(source, "    switch (out->%s) {\n", xdr_unionp->pivot_name);
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") != 0) {
+            fprintf(source, "    case %s:\n", casep->label);
+            if (casep->voided) {
+                fprintf(source, "        break;\n");
+            } else if (casep->type) {
+                emit_unmarshall(source, xdr_unionp->name, casep->name,
+                                casep->type);
+                fprintf(source, "        break;\n");
+            }
+        }
+    }
+
+    fprintf(source, "    default:\n");
+    casep = union_default_arm(xdr_unionp);
+    if (casep) {
+        emit_unmarshall(source, xdr_unionp->name, casep->name, casep->type);
+    }
+    fprintf(source, "        break;\n");
+    fprintf(source, "    }\n");
+    if (xdr_unionp->passthrough) {
+        emit_wire_finish(source);
+    }
+    fprintf(source, "    return len;\n");
+    fprintf(source, "}\n\n");
+} /* emit_unmarshall_union */
+
+static int
+builtin_wire_size(const char *name)
+{
+    if (strcmp(name, "uint64_t") == 0 ||
+        strcmp(name, "int64_t") == 0 ||
+        strcmp(name, "double") == 0) {
+        return 8;
+    }
+
+    return 4;
+} /* builtin_wire_size */
+
+static void
+emit_stream_yield(
+    FILE *output,
+    int   state)
+{
+    fprintf(output, "            frame->state = %d;\n", state);
+    fprintf(output, "            return 1;\n");
+    fprintf(output, "        }\n");
+} /* emit_stream_yield */
+
+/*
+ * Resumable marshall code is a switch over frame->state with a case label
+ * ahead of each point the encoder may yield at, so that re-entering the
+ * function jumps straight back to where the previous step left off.  Each
+ * member takes one or more consecutive states, allocated from *state.
+ */
+void
+emit_stream_marshall(
+    FILE            *output,
+    const char      *name,
+    struct xdr_type *type,
+    int             *state)
+{
+    struct xdr_identifier *chk;
+    struct xdr_struct     *liststruct;
+    char                   count[256];
+    int                    k = (*state)++;
+
+    fprintf(output, "    case %d:\n", k);
+
+    if (type->opaque) {
+        if (type->array) {
+            fprintf(output,
+                    "        if (__marshall_stream_opaque(in->%s, %s, 0, &frame->offset, cursor)) {\n",
+                    name, type->array_size);
+        } else if (type->zerocopy) {
+            fprintf(output,
+                    "        if (__marshall_stream_opaque_zerocopy(&in->%s, &frame->offset, cursor)) {\n",
+                    name);
+        } else {
+            fprintf(output,
+                    "        if (__marshall_stream_opaque(in->%s.data, in->%s.len, 1, &frame->offset, cursor)) {\n",
+                    name, name);
+        }
+        emit_stream_yield(output, k);
+        fprintf(output, "        frame->offset = 0;\n");
+    } else if (strcmp(type->name, "xdr_string") == 0) {
+        fprintf(output,
+                "        if (__marshall_stream_opaque(in->%s.str, in->%s.len, 1, &frame->offset, cursor)) {\n",
+                name, name);
+        emit_stream_yield(output, k);
+        fprintf(output, "        frame->offset = 0;\n");
+    } else if (type->linkedlist) {
+
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        if (!chk) {
+            fprintf(stderr, "Linked list '%s' not found.\n", type->name);
+            exit(1);
+        }
+
+        liststruct = (struct xdr_struct *) chk->ptr;
+
+        /* frame->index notes whether the current element's 'more' word
+         * has already gone out */
+        fprintf(output, "        frame->ptr   = in->%s;\n", name);
+        fprintf(output, "        frame->index = 0;\n");
+        fprintf(output, "    case %d:\n", (*state)++);
+        fprintf(output, "        while (frame->ptr) {\n");
+        fprintf(output, "            if (!frame->index) {\n");
+        fprintf(output, "                uint32_t more = 1;\n");
+        fprintf(output, "                if (!xdr_write_cursor_room(cursor, 4)) {\n");
+        fprintf(output, "                    frame->state = %d;\n", k + 1);
+        fprintf(output, "                    return 1;\n");
+        fprintf(output, "                }\n");
+        fprintf(output, "                __marshall_uint32_t(&more, cursor);\n");
+        fprintf(output, "                frame->index = 1;\n");
+        fprintf(output, "            }\n");
+        fprintf(output,
+                "            if (__marshall_stream_%s(frame->ptr, cursor, stream)) {\n",
+                type->name);
+        fprintf(output, "                frame->state = %d;\n", k + 1);
+        fprintf(output, "                return 1;\n");
+        fprintf(output, "            }\n");
+        fprintf(output, "            frame->index = 0;\n");
+        fprintf(output,
+                "            frame->ptr   = ((const struct %s *) frame->ptr)->%s;\n",
+                type->name, liststruct->nextmember);
+        fprintf(output, "        }\n");
+        fprintf(output, "    case %d:\n", (*state)++);
+        fprintf(output, "        if (!xdr_write_cursor_room(cursor, 4)) {\n");
+        emit_stream_yield(output, k + 2);
+        fprintf(output, "        {\n");
+        fprintf(output, "            uint32_t more = 0;\n");
+        fprintf(output, "            __marshall_uint32_t(&more, cursor);\n");
+        fprintf(output, "        }\n");
+    } else if (type->optional) {
+        fprintf(output, "        if (!xdr_write_cursor_room(cursor, 4)) {\n");
+        emit_stream_yield(output, k);
+        fprintf(output, "        {\n");
+        fprintf(output, "            uint32_t more = !!(in->%s);\n", name);
+        fprintf(output, "            __marshall_uint32_t(&more, cursor);\n");
+        fprintf(output, "        }\n");
+        fprintf(output, "    case %d:\n", (*state)++);
+        fprintf(output,
+                "        if (in->%s && __marshall_stream_%s(in->%s, cursor, stream)) {\n",
+                name, type->name, name);
+        emit_stream_yield(output, k + 1);
+    } else if (type->vector || type->array) {
+
+        if (type->vector) {
+            snprintf(count, sizeof(count), "in->num_%s", name);
+            fprintf(output, "        if (!xdr_write_cursor_room(cursor, 4)) {\n");
+            emit_stream_yield(output, k);
+            fprintf(output, "        __marshall_uint32_t(&in->num_%s, cursor);\n",
+                    name);
+        } else {
+            snprintf(count, sizeof(count), "%s", type->array_size);
+        }
+
+        fprintf(output, "        frame->index = 0;\n");
+        fprintf(output, "    case %d:\n", (*state)++);
+        fprintf(output, "        for (; frame->index < %s; frame->index++) {\n",
+                count);
+
+        if (type->builtin) {
+            fprintf(output, "            if (!xdr_write_cursor_room(cursor, %d)) {\n",
+                    builtin_wire_size(type->name));
+            fprintf(output, "                frame->state = %d;\n", k + 1);
+            fprintf(output, "                return 1;\n");
+            fprintf(output, "            }\n");
+            fprintf(output, "            __marshall_%s(&in->%s[frame->index], cursor);\n",
+                    type->name, name);
+        } else {
+            fprintf(output,
+                    "            if (__marshall_stream_%s(&in->%s[frame->index], cursor, stream)) {\n",
+                    type->name, name);
+            fprintf(output, "                frame->state = %d;\n", k + 1);
+            fprintf(output, "                return 1;\n");
+            fprintf(output, "            }\n");
+        }
+        fprintf(output, "        }\n");
+    } else if (type->outofline) {
+        fprintf(output,
+                "        if (__marshall_stream_%s(in->%s, cursor, stream)) {\n",
+                type->name, name);
+        emit_stream_yield(output, k);
+    } else if (type->narrow) {
+        fprintf(output, "        if (!xdr_write_cursor_room(cursor, 4)) {\n");
+        emit_stream_yield(output, k);
+        fprintf(output, "        {\n");
+        fprintf(output, "            uint32_t v = in->%s;\n", name);
+        fprintf(output, "            __marshall_uint32_t(&v, cursor);\n");
+        fprintf(output, "        }\n");
+    } else if (type->builtin) {
+        fprintf(output, "        if (!xdr_write_cursor_room(cursor, %d)) {\n",
+                builtin_wire_size(type->name));
+        emit_stream_yield(output, k);
+        fprintf(output, "        __marshall_%s(&in->%s, cursor);\n",
+                type->name, name);
+    } else {
+        fprintf(output,
+                "        if (__marshall_stream_%s(&in->%s, cursor, stream)) {\n",
+                type->name, name);
+        emit_stream_yield(output, k);
+    }
+} /* emit_stream_marshall */
+
+void
+emit_stream_struct(
+    FILE              *source,
+    struct xdr_struct *xdr_structp)
+{
+    struct xdr_struct_member *member;
+    int                       state = 0;
+
+    fprintf(source, "static int\n");
+    fprintf(source, "__marshall_stream_%s(\n", xdr_structp->name);
+    fprintf(source, "    const struct %s *in,\n", xdr_structp->name);
+    fprintf(source, "    struct xdr_write_cursor *cursor,\n");
+    fprintf(source, "    xdr_marshall_stream *stream) {\n");
+    fprintf(source,
+            "    struct xdr_stream_frame *frame = xdr_marshall_stream_enter(stream);\n");
+    fprintf(source, "    if (unlikely(!frame)) {\n");
+    fprintf(source, "        return 1;\n");
+    fprintf(source, "    }\n");
+    fprintf(source, "    switch (frame->state) {\n");
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        emit_stream_marshall(source, member->name, member->type, &state);
+    }
+
+    fprintf(source, "    }\n");
+    fprintf(source, "    xdr_marshall_stream_leave(stream, frame);\n");
+    fprintf(source, "    return 0;\n");
+    fprintf(source, "}\n\n");
+} /* emit_stream_struct */
+
+/*
+ * Case labels of the resume switch cannot sit inside the switch on the
+ * discriminant, so each arm is laid out after it and reached by goto.
+ */
+void
+emit_stream_union(
+    FILE             *source,
+    struct xdr_union *xdr_unionp)
+{
+    struct xdr_union_case *casep;
+    int                    state = 0, arm;
+
+    fprintf(source, "static int\n");
+    fprintf(source, "__marshall_stream_%s(\n", xdr_unionp->name);
+    fprintf(source, "    const struct %s *in,\n", xdr_unionp->name);
+    fprintf(source, "    struct xdr_write_cursor *cursor,\n");
+    fprintf(source, "    xdr_marshall_stream *stream) {\n");
+    fprintf(source,
+            "    struct xdr_stream_frame *frame = xdr_marshall_stream_enter(stream);\n");
+    fprintf(source, "    if (unlikely(!frame)) {\n");
+    fprintf(source, "        return 1;\n");
+    fprintf(source, "    }\n");
+    fprintf(source, "    switch (frame->state) {\n");
+
+    emit_stream_marshall(source, xdr_unionp->pivot_name, xdr_unionp->pivot_type,
+                         &state);
+
+    fprintf(source, "        switch (in->%s) {\n", xdr_unionp->pivot_name);
+
+    arm = 0;
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") == 0) {
+            fprintf(source, "        default:\n");
+        } else {
+            fprintf(source, "        case %s:\n", casep->label);
+        }
+
+        if (casep->voided) {
+            fprintf(source, "            goto done;\n");
+        } else if (casep->type) {
+            fprintf(source, "            goto arm_%d;\n", arm);
+        }
+        arm++;
+    }
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (strcmp(casep->label, "default") == 0) {
+            break;
+        }
+    }
+
+    if (!casep) {
+        fprintf(source, "        default:\n");
+        fprintf(source, "            goto done;\n");
+    }
+
+    fprintf(source, "        }\n");
+
+    arm = 0;
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (!casep->voided && casep->type) {
+            fprintf(source, "    arm_%d:\n", arm);
+            emit_stream_marshall(source, casep->name, casep->type, &state);
+            fprintf(source, "        goto done;\n");
+        }
+        arm++;
+    }
+
+    fprintf(source, "    }\n");
+    fprintf(source, "  done:\n");
+    fprintf(source, "    xdr_marshall_stream_leave(stream, frame);\n");
+    fprintf(source, "    return 0;\n");
+    fprintf(source, "}\n\n");
+} /* emit_stream_union */
+
+static int
+struct_is_fixed(struct xdr_struct *xdr_structp);
+
+/*
+ * Formats a C expression for the encoded size of 'type' into 'out' if
+ * every value of the type encodes to the same size, and returns 0 if not.
+ * Sizes of nested fixed structs refer to their XDR_SIZE_<type> macro.
+ */
+static int
+fixed_size_expr(
+    struct xdr_type *type,
+    char            *out,
+    size_t           outlen)
+{
+    struct xdr_identifier *chk;
+    char                   elem[256];
+
+    if (type->optional || type->vector || type->linkedlist) {
+        return 0;
+    }
+
+    if (type->opaque) {
+        if (!type->array) {
+            return 0;
+        }
+        xdr_format(out, outlen, "(%s)", type->array_size);
+        return 1;
+    }
+
+    if (type->builtin) {
+        if (strcmp(type->name, "xdr_string") == 0) {
+            return 0;
+        }
+        xdr_format(elem, sizeof(elem), "%d", builtin_wire_size(type->name));
+    } else if (type->enumeration) {
+        xdr_format(elem, sizeof(elem), "4");
+    } else {
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        if (chk && chk->type == XDR_ENUM) {
+            xdr_format(elem, sizeof(elem), "4");
+        } else if (chk && chk->type == XDR_STRUCT &&
+                   struct_is_fixed(chk->ptr)) {
+            xdr_format(elem, sizeof(elem), "XDR_SIZE_%s", type->name);
+        } else {
+            return 0;
+        }
+    }
+
+    if (type->array) {
+        xdr_format(out, outlen, "(%s * %s)", type->array_size, elem);
+    } else {
+        xdr_format(out, outlen, "%s", elem);
+    }
+
+    return 1;
+} /* fixed_size_expr */
+
+static int
+struct_is_fixed(struct xdr_struct *xdr_structp)
+{
+    struct xdr_struct_member *member;
+    char                      size[256];
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        if (!fixed_size_expr(member->type, size, sizeof(size))) {
+            return 0;
+        }
+    }
+
+    return 1;
+} /* struct_is_fixed */
+
+/* Only integer scalars get patch_<type>_<member> helpers */
+static int
+member_is_patchable(struct xdr_type *type)
+{
+    if (type->array || type->vector || type->optional || type->opaque) {
+        return 0;
+    }
+
+    return strcmp(type->name, "uint32_t") == 0 ||
+           strcmp(type->name, "int32_t") == 0 ||
+           strcmp(type->name, "uint64_t") == 0 ||
+           strcmp(type->name, "int64_t") == 0;
+} /* member_is_patchable */
+
+static void
+emit_offset(
+    FILE       *header,
+    const char *name,
+    const char *member,
+    const char *offset)
+{
+    char macro[256];
+
+    xdr_format(macro, sizeof(macro), "XDR_OFFSET_%s_%s", name, member);
+    fprintf(header, "#define %-60s %s\n", macro, offset);
+} /* emit_offset */
+
+static void
+emit_patch(
+    FILE            *output,
+    const char      *name,
+    const char      *member,
+    struct xdr_type *type,
+    int              decl)
+{
+    int wide = builtin_wire_size(type->name) == 8;
+
+    fprintf(output, "int%s", decl ? " " : "\n");
+    fprintf(output, "patch_%s_%s(\n", name, member);
+    fprintf(output, "    xdr_iovec *iov,\n");
+    fprintf(output, "    int niov,\n");
+    fprintf(output, "    uint32_t offset,\n");
+    fprintf(output, "    %s value)%s\n", type->name, decl ? ";" : " {");
+
+    if (decl) {
+        return;
+    }
+
+    fprintf(output, "    %s v = xdr_hton%d(value);\n",
+            wide ? "uint64_t" : "uint32_t", wide ? 64 : 32);
+    fprintf(output,
+            "    return xdr_iovec_patch(iov, niov, offset + XDR_OFFSET_%s_%s, &v, sizeof(v));\n",
+            name, member);
+    fprintf(output, "}\n\n");
+} /* emit_patch */
+
+/*
+ * Emits wire offsets for the members of the fixed-size prefix of a struct,
+ * up to and including the first variable-size member, XDR_SIZE_<type> if
+ * the whole struct is fixed, and patch helpers for integer prefix members.
+ * Header and source share this walk so that they agree on the prefix.
+ */
+static void
+emit_offsets_struct(
+    FILE              *output,
+    struct xdr_struct *xdr_structp,
+    int                header)
+{
+    struct xdr_struct_member *member;
+    char                      offset[512], size[256];
+    int                       fixed = 1;
+
+    if (header) {
+        fprintf(output, "/* Wire offsets within an encoded %s */\n",
+                xdr_structp->name);
+    }
+
+    snprintf(offset, sizeof(offset), "0");
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        if (header) {
+            emit_offset(output, xdr_structp->name, member->name, offset);
+        }
+
+        if (!fixed_size_expr(member->type, size, sizeof(size))) {
+            fixed = 0;
+            break;
+        }
+
+        if (member_is_patchable(member->type)) {
+            emit_patch(output, xdr_structp->name, member->name, member->type,
+                       header);
+        }
+
+        xdr_format(offset, sizeof(offset), "(XDR_OFFSET_%s_%s + %s)",
+                   xdr_structp->name, member->name, size);
+    }
+
+    if (header && fixed) {
+        xdr_format(size, sizeof(size), "XDR_SIZE_%s", xdr_structp->name);
+        fprintf(output, "#define %-60s %s\n", size, offset);
+    }
+
+    if (header) {
+        fprintf(output, "\n");
+    }
+} /* emit_offsets_struct */
+
+/* Unions have the discriminant at 0 followed by whichever arm is chosen */
+static void
+emit_offsets_union(
+    FILE             *output,
+    struct xdr_union *xdr_unionp,
+    int               header)
+{
+    struct xdr_union_case *casep;
+    char                   size[16];
+
+    if (header) {
+        fprintf(output, "/* Wire offsets within an encoded %s */\n",
+                xdr_unionp->name);
+        emit_offset(output, xdr_unionp->name, xdr_unionp->pivot_name, "0");
+        snprintf(size, sizeof(size), "%d",
+                 builtin_wire_size(xdr_unionp->pivot_type->name));
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (casep->type && !casep->voided) {
+                emit_offset(output, xdr_unionp->name, casep->name, size);
+            }
+        }
+    }
+
+    if (member_is_patchable(xdr_unionp->pivot_type)) {
+        emit_patch(output, xdr_unionp->name, xdr_unionp->pivot_name,
+                   xdr_unionp->pivot_type, header);
+    }
+
+    if (header) {
+        fprintf(output, "\n");
+    }
+} /* emit_offsets_union */
+
+/*
+ * Wire views.  A view_<type> reads members straight out of an encoded
+ * value.  Members in the fixed-size prefix of a struct are at their
+ * XDR_OFFSET_<type>_<member>, and the offsets of the members after it are
+ * found by skipping over their predecessors the first time they are asked
+ * for and remembered in the view.
+ */
+static struct xdr_type *
+view_type(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    if (chk && chk->type == XDR_TYPEDEF) {
+        return ((struct xdr_typedef *) chk->ptr)->type;
+    }
+
+    return type;
+} /* view_type */
+
+/* One element of a vector, array or optional type */
+static void
+view_elem(
+    struct xdr_type *type,
+    struct xdr_type *elem)
+{
+    *elem            = *type;
+    elem->vector     = 0;
+    elem->optional   = 0;
+    elem->linkedlist = 0;
+
+    if (!elem->opaque) {
+        elem->array = 0;
+    }
+} /* view_elem */
+
+/* Wire width of a scalar value, or 0 for strings, opaques and structs */
+static int
+view_scalar_width(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+
+    if (type->opaque) {
+        return 0;
+    }
+
+    if (type->narrow || type->enumeration) {
+        return 4;
+    }
+
+    if (type->builtin) {
+        return strcmp(type->name, "xdr_string") ? builtin_wire_size(type->name) : 0;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    return chk && chk->type == XDR_ENUM ? 4 : 0;
+} /* view_scalar_width */
+
+/* What a getter fills in for one value of 'type' */
+static const char *
+view_out_type(
+    struct xdr_type *type,
+    char            *out,
+    size_t           outlen)
+{
+    if (type->opaque) {
+        return "xdr_opaque";
+    }
+
+    if (view_scalar_width(type)) {
+        return type->builtin && !type->narrow ? type->name : "uint32_t";
+    }
+
+    if (type->builtin) {
+        return type->name;
+    }
+
+    snprintf(out, outlen, "struct view_%s", type->name);
+
+    return out;
+} /* view_out_type */
+
+/* Reads one value of 'type' at 'off' into 'out' and returns */
+static void
+emit_view_value(
+    FILE            *source,
+    struct xdr_type *type)
+{
+    int width = view_scalar_width(type);
+
+    if (type->opaque && type->array) {
+        fprintf(source, "    return xdr_view_opaque(iov, niov, off, %s, out);\n",
+                type->array_size);
+    } else if (type->opaque) {
+        fprintf(source, "    return xdr_view_opaque_var(iov, niov, off, out);\n");
+    } else if (width) {
+        fprintf(source, "    return xdr_view_read%d(iov, niov, off, out);\n",
+                width * 8);
+    } else if (type->builtin) {
+        fprintf(source, "    return xdr_view_string(iov, niov, off, out);\n");
+    } else {
+        fprintf(source, "    view_%s_init(out, iov, niov, off);\n", type->name);
+        fprintf(source, "    return 0;\n");
+    }
+} /* emit_view_value */
+
+/* Advances 'off' past a whole encoded value of 'type' */
+static void
+emit_view_skip(
+    FILE            *source,
+    struct xdr_type *type,
+    int              indent)
+{
+    struct xdr_type elem;
+    char            size[256];
+
+    view_elem(type, &elem);
+
+    if ((type->opaque && !type->array) ||
+        strcmp(type->name, "xdr_string") == 0) {
+        fprintf(source, "%*sif (xdr_view_skip_opaque(iov, niov, &off)) return -1;\n",
+                indent, "");
+    } else if (fixed_size_expr(type, size, sizeof(size))) {
+        fprintf(source, "%*sif (xdr_view_advance(&off, %s)) return -1;\n",
+                indent, "", size);
+    } else if (type->vector &&
+               fixed_size_expr(&elem, size, sizeof(size))) {
+        fprintf(source,
+                "%*sif (xdr_view_skip_vector(iov, niov, &off, %s)) return -1;\n",
+                indent, "", size);
+    } else if (type->vector || type->array) {
+        fprintf(source, "%*s{\n", indent, "");
+        if (type->vector) {
+            fprintf(source, "%*s    uint32_t num;\n", indent, "");
+            fprintf(source,
+                    "%*s    if (xdr_view_read32(iov, niov, off, &num)) return -1;\n",
+                    indent, "");
+            fprintf(source, "%*s    off += 4;\n", indent, "");
+        } else {
+            fprintf(source, "%*s    uint32_t num = %s;\n", indent, "",
+                    type->array_size);
+        }
+        fprintf(source, "%*s    while (num--) {\n", indent, "");
+        emit_view_skip(source, &elem, indent + 8);
+        fprintf(source, "%*s    }\n", indent, "");
+        fprintf(source, "%*s}\n", indent, "");
+    } else if (type->linkedlist || type->optional) {
+        fprintf(source, "%*s%s {\n", indent, "",
+                type->linkedlist ? "for (;;)" : "do");
+        fprintf(source, "%*s    uint32_t more;\n", indent, "");
+        fprintf(source,
+                "%*s    if (xdr_view_read32(iov, niov, off, &more)) return -1;\n",
+                indent, "");
+        fprintf(source, "%*s    off += 4;\n", indent, "");
+        fprintf(source, "%*s    if (!more) break;\n", indent, "");
+        emit_view_skip(source, &elem, indent + 4);
+        fprintf(source, "%*s}%s\n", indent, "",
+                type->linkedlist ? "" : " while (0);");
+    } else {
+        fprintf(source, "%*sif (__view_skip_%s(iov, niov, &off)) return -1;\n",
+                indent, "", type->name);
+    }
+} /* emit_view_skip */
+
+static void
+emit_view_head(
+    FILE       *output,
+    const char *owner,
+    const char *verb,
+    const char *name,
+    int         indexed,
+    const char *out,
+    const char *param,
+    int         header)
+{
+    fprintf(output, "int%s", header ? " " : "\n");
+    fprintf(output, "view_%s_%s_%s(\n", owner, verb, name);
+    fprintf(output, "    struct view_%s *view,\n", owner);
+    if (indexed) {
+        fprintf(output, "    uint32_t index,\n");
+    }
+    fprintf(output, "    %s *%s)%s\n", out, param, header ? ";" : " {");
+
+    if (header) {
+        return;
+    }
+
+    fprintf(output, "    const xdr_iovec *iov = view->view.iov;\n");
+    fprintf(output, "    int niov = view->view.niov;\n");
+    fprintf(output, "    uint32_t off;\n");
+} /* emit_view_head */
+
+/*
+ * Emits view_<owner>_get_<name>(), and view_<owner>_count_<name>() for a
+ * vector.  'locate' is code that sets 'off' to where the member begins.
+ */
+static void
+emit_view_getter(
+    FILE            *output,
+    const char      *owner,
+    const char      *name,
+    struct xdr_type *member_type,
+    const char      *locate,
+    int              header)
+{
+    struct xdr_type *type = view_type(member_type);
+    struct xdr_type  elem;
+    const char      *out;
+    char             outbuf[256], size[256];
+    int              indexed;
+
+    view_elem(type, &elem);
+
+    out     = view_out_type(&elem, outbuf, sizeof(outbuf));
+    indexed = !type->opaque && strcmp(type->name, "xdr_string") &&
+              (type->vector || type->array);
+
+    if (indexed && type->vector) {
+        emit_view_head(output, owner, "count", name, 0, "uint32_t", "count",
+                       header);
+
+        if (!header) {
+            fprintf(output, "%s", locate);
+            fprintf(output, "    return xdr_view_read32(iov, niov, off, count);\n");
+            fprintf(output, "}\n\n");
+        }
+    }
+
+    emit_view_head(output, owner, "get", name, indexed, out, "out", header);
+
+    if (header) {
+        return;
+    }
+
+    fprintf(output, "%s", locate);
+
+    if (indexed) {
+        if (type->vector) {
+            fprintf(output, "    uint32_t num;\n");
+            fprintf(output, "    if (xdr_view_read32(iov, niov, off, &num)) return -1;\n");
+            fprintf(output, "    off += 4;\n");
+        } else {
+            fprintf(output, "    uint32_t num = %s;\n", type->array_size);
+        }
+
+        fprintf(output, "    if (index >= num) return -1;\n");
+
+        if (fixed_size_expr(&elem, size, sizeof(size))) {
+            fprintf(output,
+                    "    if (xdr_view_advance(&off, (uint64_t) index * %s)) return -1;\n",
+                    size);
+        } else {
+            fprintf(output, "    while (index--) {\n");
+            emit_view_skip(output, &elem, 8);
+            fprintf(output, "    }\n");
+        }
+    } else if (type->optional || type->linkedlist) {
+        fprintf(output, "    uint32_t more;\n");
+        fprintf(output, "    if (xdr_view_read32(iov, niov, off, &more)) return -1;\n");
+        fprintf(output, "    if (!more) return 1;\n");
+        fprintf(output, "    off += 4;\n");
+    }
+
+    emit_view_value(output, &elem);
+    fprintf(output, "}\n\n");
+} /* emit_view_getter */
+
+static void
+emit_view_init(
+    FILE       *output,
+    const char *name,
+    int         header)
+{
+    fprintf(output, "void%s", header ? " " : "\n");
+    fprintf(output, "view_%s_init(\n", name);
+    fprintf(output, "    struct view_%s *view,\n", name);
+    fprintf(output, "    const xdr_iovec *iov,\n");
+    fprintf(output, "    int niov,\n");
+    fprintf(output, "    uint32_t offset)%s\n", header ? ";" : " {");
+
+    if (header) {
+        return;
+    }
+
+    fprintf(output, "    view->view.iov = iov;\n");
+    fprintf(output, "    view->view.niov = niov;\n");
+    fprintf(output, "    view->view.offset = offset;\n");
+} /* emit_view_init */
+
+static void
+emit_view_length(
+    FILE       *output,
+    const char *name,
+    int         header)
+{
+    fprintf(output, "int%s", header ? " " : "\n");
+    fprintf(output, "view_%s_length(\n", name);
+    fprintf(output, "    struct view_%s *view)%s\n", name, header ? ";" : " {");
+
+    if (header) {
+        return;
+    }
+
+    fprintf(output, "    uint32_t off = view->view.offset;\n");
+    fprintf(output, "    if (__view_skip_%s(view->view.iov, view->view.niov, &off) ||\n",
+            name);
+    fprintf(output, "        xdr_view_check(view->view.iov, view->view.niov, off)) return -1;\n");
+    fprintf(output, "    return off - view->view.offset;\n");
+    fprintf(output, "}\n\n");
+} /* emit_view_length */
+
+/*
+ * Header and source share this walk so that they agree on which members
+ * are found through the offset cache.  The cache holds the offset of the
+ * first variable-size member and of each member after it.
+ */
+static void
+emit_view_struct(
+    FILE              *output,
+    struct xdr_struct *xdr_structp,
+    int                header)
+{
+    struct xdr_struct_member *member, *next = NULL;
+    const char               *name = xdr_structp->name;
+    char                      locate[512], size[256];
+    int                       i, n = 0, first = -1, slot;
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            next = member;
+            continue;
+        }
+
+        if (first < 0 && !fixed_size_expr(member->type, size, sizeof(size))) {
+            first = n;
+        }
+
+        n++;
+    }
+
+    if (header) {
+        fprintf(output, "struct view_%s {\n", name);
+        fprintf(output, "    %-39s view;\n", "xdr_view");
+        if (first >= 0 && n - first > 1) {
+            fprintf(output, "    %-39s known;\n", "uint32_t");
+            fprintf(output, "    %-39s off[%d];\n", "uint32_t", n - first);
+        }
+        fprintf(output, "};\n\n");
+    } else {
+        fprintf(output, "static int\n");
+        fprintf(output, "__view_skip_%s(\n", name);
+        fprintf(output, "    const xdr_iovec *iov,\n");
+        fprintf(output, "    int niov,\n");
+        fprintf(output, "    uint32_t *offset) {\n");
+        fprintf(output, "    uint32_t off = *offset;\n");
+
+        DL_FOREACH(xdr_structp->members, member)
+        {
+            if (!struct_member_is_next(xdr_structp, member)) {
+                emit_view_skip(output, view_type(member->type), 4);
+            }
+        }
+
+        fprintf(output, "    *offset = off;\n");
+        fprintf(output, "    return 0;\n");
+        fprintf(output, "}\n\n");
+    }
+
+    if (!header && first >= 0 && n - first > 1) {
+        fprintf(output, "static int\n");
+        fprintf(output, "__view_%s_offset(\n", name);
+        fprintf(output, "    struct view_%s *view,\n", name);
+        fprintf(output, "    uint32_t slot,\n");
+        fprintf(output, "    uint32_t *offset) {\n");
+        fprintf(output, "    const xdr_iovec *iov = view->view.iov;\n");
+        fprintf(output, "    int niov = view->view.niov;\n");
+        fprintf(output, "    uint32_t off;\n");
+        fprintf(output, "    while (view->known <= slot) {\n");
+        fprintf(output, "        off = view->off[view->known - 1];\n");
+        fprintf(output, "        switch (view->known) {\n");
+
+        i = 0;
+
+        DL_FOREACH(xdr_structp->members, member)
+        {
+            if (struct_member_is_next(xdr_structp, member)) {
+                continue;
+            }
+
+            if (i >= first && i < n - 1) {
+                fprintf(output, "        case %d:\n", i - first + 1);
+                emit_view_skip(output, view_type(member->type), 12);
+                fprintf(output, "            break;\n");
+            }
+
+            i++;
+        }
+
+        fprintf(output, "        }\n");
+        fprintf(output, "        view->off[view->known++] = off;\n");
+        fprintf(output, "    }\n");
+        fprintf(output, "    *offset = view->off[slot];\n");
+        fprintf(output, "    return 0;\n");
+        fprintf(output, "}\n\n");
+    }
+
+    emit_view_init(output, name, header);
+
+    if (!header) {
+        if (first >= 0 && n - first > 1) {
+            i = 0;
+
+            DL_FOREACH(xdr_structp->members, member)
+            {
+                if (struct_member_is_next(xdr_structp, member)) {
+                    continue;
+                }
+
+                if (i++ == first) {
+                    fprintf(output, "    view->known = 1;\n");
+                    fprintf(output, "    view->off[0] = offset + XDR_OFFSET_%s_%s;\n",
+                            name, member->name);
+                }
+            }
+        }
+        fprintf(output, "}\n\n");
+    }
+
+    emit_view_length(output, name, header);
+
+    i = 0;
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        slot = first >= 0 ? i - first : 0;
+
+        if (slot <= 0) {
+            snprintf(locate, sizeof(locate),
+                     "    off = view->view.offset + XDR_OFFSET_%s_%s;\n",
+                     name, member->name);
+        } else {
+            snprintf(locate, sizeof(locate),
+                     "    if (__view_%s_offset(view, %d, &off)) return -1;\n",
+                     name, slot);
+        }
+
+        emit_view_getter(output, name, member->name, member->type, locate,
+                         header);
+        i++;
+    }
+
+    /* The next element of a list follows the whole of this one */
+    if (next) {
+        snprintf(locate, sizeof(locate),
+                 "    off = view->view.offset;\n"
+                 "    if (__view_skip_%s(iov, niov, &off)) return -1;\n", name);
+        emit_view_getter(output, name, next->name, next->type, locate, header);
+    }
+
+    if (header) {
+        fprintf(output, "\n");
+    }
+} /* emit_view_struct */
+
+/* Unions number their arms in declaration order, void arms after them */
+static void
+emit_view_union(
+    FILE             *output,
+    struct xdr_union *xdr_unionp,
+    int               header)
+{
+    struct xdr_union_case *casep, *def;
+    const char            *name = xdr_unionp->name;
+    char                   locate[512];
+    int                    arm, narms = 0;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (casep->type && !casep->voided) {
+            narms++;
+        }
+    }
+
+    if (header) {
+        fprintf(output, "struct view_%s {\n", name);
+        fprintf(output, "    %-39s view;\n", "xdr_view");
+        fprintf(output, "};\n\n");
+    } else {
+        fprintf(output, "static int\n");
+        fprintf(output, "__view_%s_arm(\n", name);
+        fprintf(output, "    const xdr_iovec *iov,\n");
+        fprintf(output, "    int niov,\n");
+        fprintf(output, "    uint32_t *offset) {\n");
+        fprintf(output, "    %s pivot;\n", xdr_unionp->pivot_type->name);
+        fprintf(output, "    if (xdr_view_read32(iov, niov, *offset, &pivot)) return -1;\n");
+        fprintf(output, "    *offset += 4;\n");
+        fprintf(output, "    switch (pivot) {\n");
+
+        arm = 0;
+        def = union_default_arm(xdr_unionp);
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (casep->type && !casep->voided) {
+                arm++;
+            }
+
+            if (strcmp(casep->label, "default") == 0) {
+                continue;
+            }
+
+            fprintf(output, "    case %s:\n", casep->label);
+
+            if (casep->voided) {
+                fprintf(output, "        return %d;\n", narms);
+            } else if (casep->type) {
+                fprintf(output, "        return %d;\n", arm - 1);
+            }
+        }
+
+        arm = 0;
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (casep == def) {
+                break;
+            }
+
+            if (casep->type && !casep->voided) {
+                arm++;
+            }
+        }
+
+        fprintf(output, "    default:\n");
+        fprintf(output, "        return %d;\n", def ? arm : narms);
+        fprintf(output, "    }\n");
+        fprintf(output, "}\n\n");
+
+        fprintf(output, "static int\n");
+        fprintf(output, "__view_skip_%s(\n", name);
+        fprintf(output, "    const xdr_iovec *iov,\n");
+        fprintf(output, "    int niov,\n");
+        fprintf(output, "    uint32_t *offset) {\n");
+        fprintf(output, "    uint32_t off = *offset;\n");
+        fprintf(output, "    switch (__view_%s_arm(iov, niov, &off)) {\n", name);
+        fprintf(output, "    case -1:\n");
+        fprintf(output, "        return -1;\n");
+
+        arm = 0;
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (casep->type && !casep->voided) {
+                fprintf(output, "    case %d:\n", arm++);
+                emit_view_skip(output, view_type(casep->type), 8);
+                fprintf(output, "        break;\n");
+            }
+        }
+
+        fprintf(output, "    }\n");
+        fprintf(output, "    *offset = off;\n");
+        fprintf(output, "    return 0;\n");
+        fprintf(output, "}\n\n");
+    }
+
+    emit_view_init(output, name, header);
+
+    if (!header) {
+        fprintf(output, "}\n\n");
+    }
+
+    emit_view_length(output, name, header);
+
+    emit_view_getter(output, name, xdr_unionp->pivot_name,
+                     xdr_unionp->pivot_type, "    off = view->view.offset;\n",
+                     header);
+
+    arm = 0;
+
+    DL_FOREACH(xdr_unionp->cases, casep)
+    {
+        if (!casep->type || casep->voided) {
+            continue;
+        }
+
+        snprintf(locate, sizeof(locate),
+                 "    off = view->view.offset;\n"
+                 "    int arm = __view_%s_arm(iov, niov, &off);\n"
+                 "    if (arm != %d) return arm < 0 ? -1 : 1;\n",
+                 name, arm++);
+
+        emit_view_getter(output, name, casep->name, casep->type, locate,
+                         header);
+    }
+
+    if (header) {
+        fprintf(output, "\n");
+    }
+} /* emit_view_union */
+
+/*
+ * Clones copy a value into one caller supplied block.  The value is copied
+ * by assignment, then whatever it points to is copied into the block
+ * behind it and the pointers are redirected, depth first so that members
+ * land next to their parents.  clone_size_<type>() walks the same members
+ * to add up the space, so the two share this emitter, which writes the
+ * size walk when 'size' is set.
+ */
+static struct xdr_struct *
+clone_list(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    return chk && chk->type == XDR_STRUCT ? chk->ptr : NULL;
+} /* clone_list */
+
+/* Structs and unions have pointers of their own to follow */
+static int
+clone_is_aggregate(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+
+    if (type->builtin || type->opaque) {
+        return 0;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    return chk && (chk->type == XDR_STRUCT || chk->type == XDR_UNION);
+} /* clone_is_aggregate */
+
+static void
+emit_clone_list(
+    FILE            *source,
+    const char      *name,
+    struct xdr_type *type,
+    int              listarray,
+    int              size)
+{
+    const char *next = clone_list(type)->nextmember;
+
+    fprintf(source, "    {\n");
+    fprintf(source, "        const struct %s *node;\n", type->name);
+    fprintf(source, "        uint32_t n = 0, i;\n");
+
+    if (size) {
+        if (listarray) {
+            fprintf(source, "        if (in->num_%s) {\n", name);
+            fprintf(source, "            for (i = 0; i < in->num_%s; ++i) {\n", name);
+            fprintf(source, "                size += __clone_size_%s(&in->%s[i]);\n",
+                    type->name, name);
+            fprintf(source, "            }\n");
+            fprintf(source, "            n = in->num_%s;\n", name);
+            fprintf(source, "        } else\n");
+        }
+        fprintf(source, "        for (node = in->%s; node; node = node->%s) {\n",
+                name, next);
+        fprintf(source, "            size += __clone_size_%s(node);\n", type->name);
+        fprintf(source, "            n++;\n");
+        fprintf(source, "        }\n");
+        fprintf(source, "        size += xdr_clone_space(n * sizeof(*node));\n");
+        fprintf(source, "    }\n");
+        return;
+    }
+
+    /* Elements are laid out as an array, so -a can index the clone too */
+    fprintf(source, "        struct %s *copy;\n", type->name);
+    if (listarray) {
+        fprintf(source, "        if (in->num_%s) {\n", name);
+        fprintf(source, "            n = in->num_%s;\n", name);
+        fprintf(source, "        } else\n");
+    }
+    fprintf(source, "        for (node = in->%s; node; node = node->%s) n++;\n",
+            name, next);
+    fprintf(source, "        copy = n ? xdr_clone_alloc(cursor, n * sizeof(*copy)) : NULL;\n");
+    fprintf(source, "        out->%s = copy;\n", name);
+    fprintf(source, "        for (i = 0, node = in->%s; copy && i < n; ++i) {\n", name);
+    fprintf(source, "            copy[i] = *node;\n");
+    fprintf(source, "            __clone_%s(&copy[i], node, cursor);\n", type->name);
+    fprintf(source, "            copy[i].%s = i + 1 < n ? &copy[i + 1] : NULL;\n", next);
+    if (listarray) {
+        fprintf(source, "            node = in->num_%s ? &in->%s[i + 1] : node->%s;\n",
+                name, name, next);
+    } else {
+        fprintf(source, "            node = node->%s;\n", next);
+    }
+    fprintf(source, "        }\n");
+    fprintf(source, "    }\n");
+} /* emit_clone_list */
+
+static void
+emit_clone_member(
+    FILE            *source,
+    const char      *name,
+    struct xdr_type *member_type,
+    int              listarray,
+    int              size)
+{
+    struct xdr_type *type = view_type(member_type);
+    int              aggregate = clone_is_aggregate(type);
+
+    if (type->opaque && type->array) {
+        return;
+    } else if (type->opaque && type->zerocopy) {
+        if (size) {
+            fprintf(source,
+                    "    size += xdr_clone_space(sizeof(xdr_iovec)) + xdr_clone_space(in->%s.length);\n",
+                    name);
+        } else {
+            fprintf(source, "    xdr_clone_iovecr(cursor, &out->%s, &in->%s);\n",
+                    name, name);
+        }
+    } else if (type->opaque) {
+        if (type->inlinecap) {
+            fprintf(source, "    if (in->%s.data == in->%s_inline) {\n", name, name);
+            if (!size) {
+                fprintf(source, "        out->%s.data = out->%s_inline;\n", name, name);
+            }
+            fprintf(source, "    } else\n");
+        }
+        if (size) {
+            fprintf(source, "    size += xdr_clone_space(in->%s.len);\n", name);
+        } else {
+            fprintf(source,
+                    "    out->%s.data = xdr_clone_copy(cursor, in->%s.data, in->%s.len);\n",
+                    name, name, name);
+        }
+    } else if (strcmp(type->name, "xdr_string") == 0) {
+        if (size) {
+            fprintf(source, "    size += xdr_clone_space(in->%s.len);\n", name);
+        } else {
+            fprintf(source,
+                    "    out->%s.str = xdr_clone_copy(cursor, in->%s.str, in->%s.len);\n",
+                    name, name, name);
+        }
+    } else if (type->vector) {
+        if (type->inlinecap) {
+            fprintf(source, "    if (in->%s == in->%s_inline) {\n", name, name);
+            if (!size) {
+                fprintf(source, "        out->%s = out->%s_inline;\n", name, name);
+            }
+            fprintf(source, "    } else\n");
+        }
+        if (size) {
+            fprintf(source, "    size += xdr_clone_space(in->num_%s * sizeof(*in->%s));\n",
+                    name, name);
+        } else {
+            fprintf(source,
+                    "    out->%s = xdr_clone_copy(cursor, in->%s, in->num_%s * sizeof(*in->%s));\n",
+                    name, name, name, name);
+        }
+        if (aggregate) {
+            if (size) {
+                fprintf(source, "    for (uint32_t i = 0; i < in->num_%s; ++i) {\n",
+                        name);
+            } else {
+                fprintf(source,
+                        "    for (uint32_t i = 0; out->%s && i < in->num_%s; ++i) {\n",
+                        name, name);
+            }
+            if (size) {
+                fprintf(source, "        size += __clone_size_%s(&in->%s[i]);\n",
+                        type->name, name);
+            } else {
+                fprintf(source, "        __clone_%s(&out->%s[i], &in->%s[i], cursor);\n",
+                        type->name, name, name);
+            }
+            fprintf(source, "    }\n");
+        }
+    } else if (type->linkedlist) {
+        emit_clone_list(source, name, type, listarray, size);
+    } else if (type->optional || type->outofline) {
+        fprintf(source, "    if (in->%s) {\n", name);
+        if (size) {
+            fprintf(source, "        size += xdr_clone_space(sizeof(*in->%s));\n", name);
+            if (aggregate) {
+                fprintf(source, "        size += __clone_size_%s(in->%s);\n",
+                        type->name, name);
+            }
+        } else {
+            fprintf(source,
+                    "        out->%s = xdr_clone_copy(cursor, in->%s, sizeof(*in->%s));\n",
+                    name, name, name);
+            if (aggregate) {
+                fprintf(source, "        if (out->%s) {\n", name);
+                fprintf(source, "            __clone_%s(out->%s, in->%s, cursor);\n",
+                        type->name, name, name);
+                fprintf(source, "        }\n");
+            }
+        }
+        fprintf(source, "    }\n");
+    } else if (type->array && aggregate) {
+        fprintf(source, "    for (int i = 0; i < %s; ++i) {\n", type->array_size);
+        if (size) {
+            fprintf(source, "        size += __clone_size_%s(&in->%s[i]);\n",
+                    type->name, name);
+        } else {
+            fprintf(source, "        __clone_%s(&out->%s[i], &in->%s[i], cursor);\n",
+                    type->name, name, name);
+        }
+        fprintf(source, "    }\n");
+    } else if (aggregate) {
+        if (size) {
+            fprintf(source, "    size += __clone_size_%s(&in->%s);\n", type->name, name);
+        } else {
+            fprintf(source, "    __clone_%s(&out->%s, &in->%s, cursor);\n",
+                    type->name, name, name);
+        }
+    }
+} /* emit_clone_member */
+
+static void
+emit_clone_head(
+    FILE       *source,
+    const char *name,
+    int         size)
+{
+    if (size) {
+        fprintf(source, "static uint32_t\n");
+        fprintf(source, "__clone_size_%s(\n", name);
+        fprintf(source, "    const struct %s *in) {\n", name);
+        fprintf(source, "    uint32_t size = 0;\n");
+    } else {
+        fprintf(source, "static void\n");
+        fprintf(source, "__clone_%s(\n", name);
+        fprintf(source, "    struct %s *out,\n", name);
+        fprintf(source, "    const struct %s *in,\n", name);
+        fprintf(source, "    struct xdr_clone_cursor *cursor) {\n");
+    }
+} /* emit_clone_head */
+
+/* Detaches what the clone must not share with the original */
+static void
+emit_clone_detach(
+    FILE *source,
+    int   cached,
+    int   passthrough)
+{
+    if (cached) {
+        fprintf(source, "    out->xdr_cache = NULL;\n");
+    }
+
+    if (passthrough) {
+        fprintf(source, "    memset(&out->xdr_wire, 0, sizeof(out->xdr_wire));\n");
+    }
+} /* emit_clone_detach */
+
+static void
+emit_clone_wrappers(
+    FILE       *source,
+    const char *name)
+{
+    fprintf(source, "uint32_t\n");
+    fprintf(source, "clone_size_%s(\n", name);
+    fprintf(source, "    const struct %s *in) {\n", name);
+    fprintf(source, "    return xdr_clone_space(sizeof(*in)) + __clone_size_%s(in);\n",
+            name);
+    fprintf(source, "}\n\n");
+
+    fprintf(source, "struct %s *\n", name);
+    fprintf(source, "clone_%s(\n", name);
+    fprintf(source, "    const struct %s *in,\n", name);
+    fprintf(source, "    void *buf,\n");
+    fprintf(source, "    uint32_t size) {\n");
+    fprintf(source, "    struct xdr_clone_cursor cursor = { buf, 0, size, 0 };\n");
+    fprintf(source, "    struct %s *out = xdr_clone_copy(&cursor, in, sizeof(*in));\n",
+            name);
+    fprintf(source, "    if (unlikely(!out)) {\n");
+    fprintf(source, "        return NULL;\n");
+    fprintf(source, "    }\n");
+    fprintf(source, "    __clone_%s(out, in, &cursor);\n", name);
+    fprintf(source, "    return cursor.error ? NULL : out;\n");
+    fprintf(source, "}\n\n");
+} /* emit_clone_wrappers */
+
+static void
+emit_clone_struct(
+    FILE              *source,
+    struct xdr_struct *xdr_structp)
+{
+    struct xdr_struct_member *member;
+    int                       size;
+
+    for (size = 1; size >= 0; --size) {
+        emit_clone_head(source, xdr_structp->name, size);
+
+        if (!size) {
+            emit_clone_detach(source, xdr_structp->cached,
+                              xdr_structp->passthrough);
+        }
+
+        DL_FOREACH(xdr_structp->members, member)
+        {
+            if (struct_member_is_next(xdr_structp, member)) {
+                continue;
+            }
 
-        if (!chk) {
-            fprintf(stderr, "Linked list '%s' not found.\n", type->name);
-            exit(1);
+            if (!size && member->listctl) {
+                fprintf(source, "    out->%s_ctl = NULL;\n", member->name);
+            }
+
+            if (!size && member->checksum) {
+                fprintf(source, "    out->%s_crc32c = NULL;\n", member->name);
+            }
+
+            emit_clone_member(source, member->name, member->type,
+                              member->listarray, size);
         }
 
-        liststruct = (struct xdr_struct *) chk->ptr;
+        if (size) {
+            fprintf(source, "    return size;\n");
+        }
 
-        fprintf(output, "    {\n");
-        fprintf(output, "            uint32_t more;\n");
-        fprintf(output, "        const struct %s *current = in->%s;\n", type->
-                name, name);
-        fprintf(output, "        while (current != NULL) {\n");
-        fprintf(output, "            more = 1;\n");
-        fprintf(output,
-                "            __marshall_uint32_t(&more, cursor);\n");
-        fprintf(output,
-                "            __marshall_%s(current, cursor);\n",
-                type->name);
-        fprintf(output, "            current = current->%s;\n", liststruct->
-                nextmember);
-        fprintf(output, "        }\n");
-        fprintf(output, "        more = 0;\n");
-        fprintf(output, "        __marshall_uint32_t(&more, cursor);\n");
-        fprintf(output, "    }\n");
-    } else if (type->optional) {
-        fprintf(output, "    {\n");
-        fprintf(output, "        uint32_t more = !!(in->%s);\n", name);
-        fprintf(output,
-                "        __marshall_uint32_t(&more, cursor);\n");
-        fprintf(output, "        if (more) {\n");
-        fprintf(output,
-                "        __marshall_%s(in->%s, cursor);\n",
-                type->name, name);
-        fprintf(output, "        }\n");
-        fprintf(output, "    }\n");
-    } else if (type->vector) {
-        fprintf(output,
-                "    __marshall_uint32_t(&in->num_%s, cursor);\n",
-                name);
-        fprintf(output, "    for (int i = 0; i < in->num_%s; i++) {\n", name);
-        fprintf(output, "        __marshall_%s(&in->%s[i], cursor);\n",
-                type->name, name);
-        fprintf(output, "    }\n");
-    } else if (type->array) {
-        fprintf(output, "    for (int i = 0; i < %s; ++i) {\n",
-                type->array_size);
-        fprintf(output, "        __marshall_%s(&in->%s[i], cursor);\n",
-                type->name, name);
-        fprintf(output, "    }\n");
-    } else {
-        fprintf(output, "    __marshall_%s(&in->%s, cursor);\n",
-                type->name, name);
+        fprintf(source, "}\n\n");
     }
-} /* emit_marshall */
 
-void
-emit_unmarshall(
-    FILE            *output,
-    const char      *name,
-    struct xdr_type *type)
+    emit_clone_wrappers(source, xdr_structp->name);
+} /* emit_clone_struct */
+
+static void
+emit_clone_union(
+    FILE             *source,
+    struct xdr_union *xdr_unionp)
 {
-    struct xdr_identifier *chk;
-    struct xdr_struct     *liststruct;
+    struct xdr_union_case *casep;
+    int                    size;
 
-    if (type->opaque) {
-        if (type->array) {
-            fprintf(output,
-                    "    rc = xdr_read_cursor_extract(cursor, out->%s, %s);\n",
-                    name, type->array_size);
-        } else if (type->zerocopy) {
-            fprintf(output,
-                    "    rc = __unmarshall_opaque_zerocopy(&out->%s, cursor, dbuf);\n",
-                    name);
-        } else {
-            fprintf(output,
-                    "    rc = __unmarshall_opaque(&out->%s, %s, cursor, dbuf);\n",
-                    name, type->vector_bound ? type->vector_bound : "0");
+    for (size = 1; size >= 0; --size) {
+        emit_clone_head(source, xdr_unionp->name, size);
+
+        if (!size) {
+            emit_clone_detach(source, xdr_unionp->cached,
+                              xdr_unionp->passthrough);
         }
-    } else if (strcmp(type->name, "xdr_string") == 0) {
-        fprintf(output,
-                "    rc = __unmarshall_%s(&out->%s, cursor, dbuf);\n",
-                type->name, name);
-    } else if (type->linkedlist) {
 
-        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+        fprintf(source, "    switch (in->%s) {\n", xdr_unionp->pivot_name);
 
-        if (!chk) {
-            fprintf(stderr, "Linked list '%s' not found.\n", type->name);
-            exit(1);
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (strcmp(casep->label, "default") == 0) {
+                continue;
+            }
+
+            fprintf(source, "    case %s:\n", casep->label);
+
+            if (casep->type && !casep->voided) {
+                emit_clone_member(source, casep->name, casep->type, 0, size);
+            }
+
+            if (casep->type || casep->voided) {
+                fprintf(source, "        break;\n");
+            }
         }
 
-        liststruct = (struct xdr_struct *) chk->ptr;
+        fprintf(source, "    default:\n");
 
-        fprintf(output, "    {\n");
-        fprintf(output, "            uint32_t more;\n");
-        fprintf(output,
-                "        rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n")
-        ;
-        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "        len += rc;\n");
+        casep = union_default_arm(xdr_unionp);
 
-        fprintf(output, "        out->%s = NULL;\n", name);
-        fprintf(output, "        struct %s *current = NULL, *last = NULL;\n", type->name);
-        fprintf(output, "        while (more) {\n");
-        fprintf(output, "          xdr_dbuf_alloc_space(current, sizeof(*current), dbuf);\n");
-        fprintf(output,
-                "        rc = __unmarshall_%s(current, cursor, dbuf);\n",
-                type->name);
-        fprintf(output, "         if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "         len += rc;\n");
-        fprintf(output, "         if (last) {\n");
-        fprintf(output, "             last->%s = current;\n", liststruct->nextmember);
-        fprintf(output, "         } else {\n");
-        fprintf(output, "             out->%s = current;\n", name);
-        fprintf(output, "        }\n");
-        fprintf(output, "         last = current;\n");
-        fprintf(output, "        last->%s = NULL;\n", liststruct->nextmember);
-        fprintf(output, "         rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n");
-        fprintf(output, "         if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "         len += rc;\n");
-        fprintf(output, "        }\n");
-        fprintf(output, "        rc = 0;\n");
-        fprintf(output, "    }\n");
-    } else if (type->optional) {
-        fprintf(output, "    {\n");
-        fprintf(output, "        uint32_t more;\n");
-        fprintf(output,
-                "        rc = __unmarshall_uint32_t(&more, cursor, dbuf);\n")
-        ;
-        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "        len += rc;\n");
-        fprintf(output, "        rc = 0;\n");
-        fprintf(output, "        if (more) {\n");
-        fprintf(output, "         xdr_dbuf_alloc_space(out->%s, sizeof(*out->%s), dbuf);\n", name, name);
-        fprintf(output,
-                "        rc = __unmarshall_%s(out->%s, cursor, dbuf);\n",
-                type->name, name);
-        fprintf(output, "        } else {\n");
-        fprintf(output, "            out->%s = NULL;\n", name);
-        fprintf(output, "        };\n");
-        fprintf(output, "    }\n");
-    } else if (type->vector) {
-        fprintf(output,
-                "    rc = __unmarshall_uint32_t(&out->num_%s, cursor, dbuf);\n",
-                name);
-        fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "    len += rc;\n");
-        fprintf(output, "     xdr_dbuf_reserve(out, %s, out->num_%s, dbuf);\n",
-                name, name);
-        fprintf(output, "    for (int i = 0; i < out->num_%s; i++) {\n", name);
-        fprintf(output,
-                "    rc = __unmarshall_%s(&out->%s[i], cursor, dbuf);\n",
-                type->name, name);
-        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "        len += rc;\n");
-        fprintf(output, "    }\n");
-        fprintf(output, "    rc = 0;\n");
-    } else if (type->array) {
-        fprintf(output, "    for (int i = 0; i < %s; i++) {\n",
-                type->array_size);
-        fprintf(output,
-                "    rc = __unmarshall_%s(&out->%s[i], cursor, dbuf);\n",
-                type->name, name);
-        fprintf(output, "        if (unlikely(rc < 0)) return rc;\n");
-        fprintf(output, "        len += rc;\n");
-        fprintf(output, "    }\n");
-        fprintf(output, "    rc = 0;\n");
-    } else {
-        fprintf(output,
-                "    rc = __unmarshall_%s(&out->%s, cursor, dbuf);\n",
-                type->name, name);
+        if (casep && !casep->voided) {
+            emit_clone_member(source, casep->name, casep->type, 0, size);
+        }
+
+        fprintf(source, "        break;\n");
+        fprintf(source, "    }\n");
+
+        if (size) {
+            fprintf(source, "    return size;\n");
+        }
+
+        fprintf(source, "}\n\n");
     }
 
-    fprintf(output, "    if (unlikely(rc < 0)) return rc;\n");
-    fprintf(output, "    len += rc;\n");
-} /* emit_unmarshall */
+    emit_clone_wrappers(source, xdr_unionp->name);
+} /* emit_clone_union */
 
 void
 emit_internal_headers(
@@ -331,8 +3023,130 @@ emit_internal_headers(
     fprintf(source, "static int\n");
     fprintf(source, "__marshall_length_%s(\n", name);
     fprintf(source, "    const struct %s *in);\n", name);
+
+    fprintf(source, "static void\n");
+    fprintf(source, "__marshall_flat_%s(\n", name);
+    fprintf(source, "    const struct %s *in,\n", name);
+    fprintf(source, "    struct xdr_flat_cursor *cursor);\n\n");
+
+    if (emit_stream) {
+        fprintf(source, "static int\n");
+        fprintf(source, "__marshall_stream_%s(\n", name);
+        fprintf(source, "    const struct %s *in,\n", name);
+        fprintf(source, "    struct xdr_write_cursor *cursor,\n");
+        fprintf(source, "    xdr_marshall_stream *stream);\n\n");
+    }
+
+    fprintf(source, "static uint32_t\n");
+    fprintf(source, "__clone_size_%s(\n", name);
+    fprintf(source, "    const struct %s *in);\n\n", name);
+
+    fprintf(source, "static void\n");
+    fprintf(source, "__clone_%s(\n", name);
+    fprintf(source, "    struct %s *out,\n", name);
+    fprintf(source, "    const struct %s *in,\n", name);
+    fprintf(source, "    struct xdr_clone_cursor *cursor);\n\n");
+
+    if (emit_views) {
+        fprintf(source, "static int\n");
+        fprintf(source, "__view_skip_%s(\n", name);
+        fprintf(source, "    const xdr_iovec *iov,\n");
+        fprintf(source, "    int niov,\n");
+        fprintf(source, "    uint32_t *offset);\n\n");
+    }
 } /* emit_internal_headers */
 
+/*
+ * Bulk array converters for structs laid out like their wire form.  The
+ * sizeof check folds away at compile time, and keeps the per-element path
+ * on any ABI that pads the struct after all.
+ */
+static void
+emit_wire_struct_arrays(
+    FILE              *source,
+    struct xdr_struct *xdr_structp)
+{
+    static const char *variants[][2] = {
+        { "",      "write" },
+        { "flat_", "flat"  },
+    };
+    struct xdr_struct_member *member;
+    const char               *name = xdr_structp->name;
+    int                       i, size, width;
+
+    size = struct_wire_size(xdr_structp, &width);
+
+    if (!size) {
+        return;
+    }
+
+    for (i = 0; i < 2; ++i) {
+        fprintf(source, "static void\n");
+        fprintf(source, "__marshall_%s%s_array(\n", variants[i][0], name);
+        fprintf(source, "    const struct %s *v,\n", name);
+        fprintf(source, "    uint32_t n,\n");
+        fprintf(source, "    struct xdr_%s_cursor *cursor) {\n", variants[i][1]);
+        fprintf(source, "    if (sizeof(*v) != %d) {\n", size);
+        fprintf(source, "        for (uint32_t i = 0; i < n; ++i) {\n");
+        fprintf(source, "            __marshall_%s%s(&v[i], cursor);\n",
+                variants[i][0], name);
+        fprintf(source, "        }\n");
+        fprintf(source, "        return;\n");
+        fprintf(source, "    }\n");
+
+        if (width) {
+            fprintf(source, "    __marshall_%sbswap%d_array(v, n * %d, cursor);\n",
+                    variants[i][0], width * 8, size / width);
+        } else {
+            fprintf(source, "    struct %s *out = xdr_%s_cursor_reserve(cursor, n * %d);\n",
+                    name, variants[i][1], size);
+            fprintf(source, "    for (uint32_t i = 0; out && i < n; ++i) {\n");
+            DL_FOREACH(xdr_structp->members, member)
+            {
+                fprintf(source, "        xdr_bswap%d_array(&out[i].%s, &v[i].%s, 1);\n",
+                        wire_scalar_width(member->type) * 8,
+                        member->name, member->name);
+            }
+            fprintf(source, "    }\n");
+        }
+        fprintf(source, "}\n\n");
+    }
+
+    fprintf(source, "static int\n");
+    fprintf(source, "__unmarshall_%s_array(\n", name);
+    fprintf(source, "    struct %s *v,\n", name);
+    fprintf(source, "    uint32_t n,\n");
+    fprintf(source, "    struct xdr_read_cursor *cursor,\n");
+    fprintf(source, "    xdr_dbuf *dbuf) {\n");
+    fprintf(source, "    int rc, len = 0;\n");
+    fprintf(source, "    if (sizeof(*v) != %d) {\n", size);
+    fprintf(source, "        for (uint32_t i = 0; i < n; ++i) {\n");
+    fprintf(source, "            rc = __unmarshall_%s(&v[i], cursor, dbuf);\n", name);
+    fprintf(source, "            if (unlikely(rc < 0)) return rc;\n");
+    fprintf(source, "            len += rc;\n");
+    fprintf(source, "        }\n");
+    fprintf(source, "        return len;\n");
+    fprintf(source, "    }\n");
+
+    if (width) {
+        fprintf(source, "    return __unmarshall_bswap%d_array(v, n * %d, cursor, dbuf);\n",
+                width * 8, size / width);
+    } else {
+        fprintf(source, "    rc = xdr_read_cursor_extract(cursor, v, n * %d);\n", size);
+        fprintf(source, "    if (unlikely(rc < 0)) return rc;\n");
+        fprintf(source, "    for (uint32_t i = 0; i < n; ++i) {\n");
+        DL_FOREACH(xdr_structp->members, member)
+        {
+            fprintf(source, "        xdr_bswap%d_array(&v[i].%s, &v[i].%s, 1);\n",
+                    wire_scalar_width(member->type) * 8,
+                    member->name, member->name);
+        }
+        fprintf(source, "    }\n");
+        fprintf(source, "    return rc;\n");
+    }
+    fprintf(source, "}\n\n");
+} /* emit_wire_struct_arrays */
+
 void
 emit_wrapper_headers(
     FILE       *header,
@@ -346,6 +3160,14 @@ emit_wrapper_headers(
     fprintf(header, "    struct evpl_rpc2_rdma_chunk *write_chunk,\n");
     fprintf(header, "    int out_offset);\n\n");
 
+    fprintf(header, "int marshall_aligned_%s(\n", name);
+    fprintf(header, "    const struct %s *out,\n", name);
+    fprintf(header, "    xdr_iovec *iov_in,\n");
+    fprintf(header, "    xdr_iovec *iov_out,\n");
+    fprintf(header, "    int *niov_out,\n");
+    fprintf(header, "    int out_offset,\n");
+    fprintf(header, "    xdr_marshall_layout *layout);\n\n");
+
     fprintf(header, "int unmarshall_%s(\n", name);
     fprintf(header, "    struct %s *out,\n", name);
     fprintf(header, "    const xdr_iovec *iov,\n");
@@ -354,6 +3176,28 @@ emit_wrapper_headers(
     fprintf(header, "    xdr_dbuf *dbuf);\n\n");
 
     fprintf(header, "int marshall_length_%s(const struct %s *in);\n\n", name, name);
+
+    fprintf(header, "int marshall_flat_%s(\n", name);
+    fprintf(header, "    const struct %s *in,\n", name);
+    fprintf(header, "    void *buf,\n");
+    fprintf(header, "    size_t cap);\n\n");
+
+    fprintf(header, "uint32_t clone_size_%s(const struct %s *in);\n\n", name, name);
+
+    fprintf(header, "struct %s *clone_%s(\n", name, name);
+    fprintf(header, "    const struct %s *in,\n", name);
+    fprintf(header, "    void *buf,\n");
+    fprintf(header, "    uint32_t size);\n\n");
+
+    if (emit_stream) {
+        fprintf(header, "int marshall_stream_%s(\n", name);
+        fprintf(header, "    const struct %s *in,\n", name);
+        fprintf(header, "    xdr_marshall_stream *stream,\n");
+        fprintf(header, "    xdr_iovec *iov_in,\n");
+        fprintf(header, "    xdr_iovec *iov_out,\n");
+        fprintf(header, "    int *niov_out,\n");
+        fprintf(header, "    int out_offset);\n\n");
+    }
 } /* emit_wrapper_headers */
 
 void
@@ -449,6 +3293,10 @@ emit_dump_member(
                     "       _dump_%s(subsubprefix, \"%s\", &in->%s[i]);\n",
                     type->name, name, name);
             fprintf(source, "   }\n");
+        } else if (type->outofline) {
+            fprintf(source,
+                    "    _dump_%s(subprefix, \"%s\", in->%s);\n",
+                    type->name, name, name);
         } else if (type->optional) {
             fprintf(source,
                     "    dump_output(\"%%s.%s = optional\", subprefix);\n",
@@ -480,19 +3328,38 @@ emit_length_member(
 
     if (emit_type->opaque) {
         if (emit_type->array) {
-            fprintf(source, "    length += xdr_pad(%s);\n", emit_type->array_size);
+            fprintf(source, "    length += %s + xdr_pad(%s);\n",
+                    emit_type->array_size, emit_type->array_size);
         } else if (emit_type->zerocopy) {
-            fprintf(source, "    length += 4 + xdr_pad(in->%s.length);\n", name);
+            fprintf(source, "    length += 4 + in->%s.length + xdr_pad(in->%s.length);\n",
+                    name, name);
         } else {
-            fprintf(source, "    length += 4 + xdr_pad(in->%s.len);\n", name);
+            fprintf(source, "    length += 4 + in->%s.len + xdr_pad(in->%s.len);\n",
+                    name, name);
         }
     } else if (strcmp(emit_type->name, "xdr_string") == 0) {
-        fprintf(source, "    length += 4 + xdr_pad(in->%s.len);\n", name);
+        fprintf(source, "    length += 4 + in->%s.len + xdr_pad(in->%s.len);\n",
+                name, name);
     } else if (emit_type->vector) {
         fprintf(source, "    length += 4;\n");
         fprintf(source, "    for (int i = 0; i < in->num_%s; i++) {\n", name);
         fprintf(source, "        length += __marshall_length_%s(&in->%s[i]);\n", type->name, name);
         fprintf(source, "    }\n");
+    } else if (emit_type->linkedlist) {
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        fprintf(source, "    length += 4;\n");
+        fprintf(source, "    for (const struct %s *current = in->%s; current;\n",
+                type->name, name);
+        fprintf(source, "         current = current->%s) {\n",
+                ((struct xdr_struct *) chk->ptr)->nextmember);
+        fprintf(source, "        length += 4 + __marshall_length_%s(current);\n",
+                type->name);
+        fprintf(source, "    }\n");
+    } else if (emit_type->narrow) {
+        fprintf(source, "    length += 4;\n");
+    } else if (emit_type->outofline) {
+        fprintf(source, "    length += __marshall_length_%s(in->%s);\n", type->name, name);
     } else if (emit_type->optional) {
         fprintf(source, "    length += 4;\n");
         fprintf(source, "    if (in->%s) {\n", name);
@@ -549,6 +3416,24 @@ emit_dump_struct(
     fprintf(source, "}\n\n");
 } /* emit_dump_struct */
 
+/* Elements of an array decoded from a -a list are measured in place */
+static void
+emit_length_listarray(
+    FILE            *source,
+    const char      *name,
+    struct xdr_type *type)
+{
+    fprintf(source, "    if (in->num_%s) {\n", name);
+    fprintf(source, "        length += 4;\n");
+    fprintf(source, "        for (uint32_t i = 0; i < in->num_%s; ++i) {\n", name);
+    fprintf(source, "            length += 4 + __marshall_length_%s(&in->%s[i]);\n",
+            type->name, name);
+    fprintf(source, "        }\n");
+    fprintf(source, "    } else {\n");
+    emit_length_member(source, name, type);
+    fprintf(source, "    }\n");
+} /* emit_length_listarray */
+
 void
 emit_length_struct(
     FILE              *source,
@@ -564,9 +3449,21 @@ emit_length_struct(
     fprintf(source, "{\n");
     fprintf(source, "    uint32_t length = 0;\n");
 
+    if (xdr_structp->passthrough) {
+        emit_wire_length(source);
+    }
+
     DL_FOREACH(xdr_structp->members, member)
     {
-        emit_length_member(source, member->name, member->type);
+        if (struct_member_is_next(xdr_structp, member)) {
+            continue;
+        }
+
+        if (member->listarray) {
+            emit_length_listarray(source, member->name, member->type);
+        } else {
+            emit_length_member(source, member->name, member->type);
+        }
     }
     fprintf(source, "    return length;\n");
     fprintf(source, "}\n\n");
@@ -604,7 +3501,9 @@ emit_dump_union(
             if (casep->type) {
                 emit_dump_member(source, casep->name, casep->type);
             }
-            fprintf(source, "        break;\n");
+            if (casep->type || casep->voided) {
+                fprintf(source, "        break;\n");
+            }
         }
     }
 
@@ -626,6 +3525,29 @@ emit_dump_union(
     fprintf(source, "}\n\n");
 } /* emit_dump_union */
 
+static void
+emit_length_arm(
+    FILE                  *source,
+    struct xdr_union      *xdr_unionp,
+    struct xdr_union_case *arm,
+    const char            *name,
+    const char            *variant)
+{
+    fprintf(source, "static uint32_t %s(const struct %s *in)\n",
+            name, xdr_unionp->name);
+    fprintf(source, "{\n");
+
+    if (arm) {
+        fprintf(source, "    uint32_t length = 0;\n");
+        emit_length_member(source, arm->name, arm->type);
+        fprintf(source, "    return length;\n");
+    } else {
+        fprintf(source, "    return 0;\n");
+    }
+
+    fprintf(source, "}\n\n");
+} /* emit_length_arm */
+
 void
 emit_length_union(
     FILE             *source,
@@ -633,35 +3555,60 @@ emit_length_union(
     struct xdr_union *xdr_unionp)
 {
     struct xdr_union_case *casep;
+    struct union_dispatch  plan;
+    char                   prefix[256], params[256];
+    int                    dispatch;
+
+    dispatch = union_dispatch_plan(xdr_unionp, &plan);
+
+    if (dispatch) {
+        xdr_format(prefix, sizeof(prefix), "__marshall_length_%s", name);
+        xdr_format(params, sizeof(params), "const struct %s *", name);
+        emit_union_arms(source, xdr_unionp, &plan, prefix, "",
+                        emit_length_arm);
+        emit_union_jump_table(source, &plan, prefix, "uint32_t", params);
+    }
 
     fprintf(source,
             "static int __marshall_length_%s(const struct %s *in)\n",
             name, name);
     fprintf(source, "{\n");
     fprintf(source, "    uint32_t length = 0;\n");
+
+    if (xdr_unionp->passthrough) {
+        emit_wire_length(source);
+    }
+
     emit_length_member(source, xdr_unionp->pivot_name, xdr_unionp->pivot_type);
-    fprintf(source, "    switch (in->%s) {\n", xdr_unionp->pivot_name);
 
-    DL_FOREACH(xdr_unionp->cases, casep)
-    {
-        if (strcmp(casep->label, "default") != 0) {
-            fprintf(source, "    case %s:\n", casep->label);
-            if (casep->type) {
-                emit_length_member(source, casep->name, casep->type);
+    if (dispatch) {
+        emit_union_jump(source, xdr_unionp, &plan, prefix, "in",
+                        "length += ", "(in)");
+    } else {
+        fprintf(source, "    switch (in->%s) {\n", xdr_unionp->pivot_name);
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (strcmp(casep->label, "default") != 0) {
+                fprintf(source, "    case %s:\n", casep->label);
+                if (casep->type) {
+                    emit_length_member(source, casep->name, casep->type);
+                }
+                if (casep->type || casep->voided) {
+                    fprintf(source, "        break;\n");
+                }
             }
-            fprintf(source, "        break;\n");
         }
-    }
 
-    DL_FOREACH(xdr_unionp->cases, casep)
-    {
-        if (strcmp(casep->label, "default") == 0) {
-            fprintf(source, "    default:\n");
-            fprintf(source, "        break;\n");
+        fprintf(source, "    default:\n");
+        casep = union_default_arm(xdr_unionp);
+        if (casep) {
+            emit_length_member(source, casep->name, casep->type);
         }
+        fprintf(source, "        break;\n");
+        fprintf(source, "    }\n");
     }
 
-    fprintf(source, "    }\n");
     fprintf(source, "    return length;\n");
     fprintf(source, "}\n\n");
 
@@ -879,6 +3826,13 @@ emit_program(
     fprintf(source, "}\n\n");
 } /* emit_program */
 
+static void
+emit_cache_members(FILE *header)
+{
+    fprintf(header, "    %-39s *xdr_cache;\n", "xdr_encode_cache");
+    fprintf(header, "    %-39s xdr_cache_key;\n", "uint64_t");
+} /* emit_cache_members */
+
 static void
 emit_member(
     FILE            *header,
@@ -903,7 +3857,11 @@ emit_member(
         structstr = "struct";
     }
 
-    if (emit_type->opaque) {
+    if (emit_type->narrow) {
+        fprintf(header, "    %s  %s;\n",
+                emit_type->narrow,
+                name);
+    } else if (emit_type->opaque) {
         if (emit_type->array) {
             fprintf(header, "    uint8_t %s[%s];\n",
                     name,
@@ -916,6 +3874,10 @@ emit_member(
             fprintf(header, "    %s  %s;\n",
                     "xdr_opaque",
                     name);
+            if (emit_type->inlinecap) {
+                fprintf(header, "    uint8_t  %s_inline[%s];\n",
+                        name, emit_type->inlinecap);
+            }
         }
     } else if (strcmp(emit_type->name, "xdr_string") == 0) {
         fprintf(header, "    %s  %s;\n",
@@ -928,7 +3890,14 @@ emit_member(
                 structstr,
                 emit_type->name,
                 name);
-    } else if (emit_type->optional) {
+        if (emit_type->inlinecap) {
+            fprintf(header, "    %s %s  %s_inline[%s];\n",
+                    structstr,
+                    emit_type->name,
+                    name,
+                    emit_type->inlinecap);
+        }
+    } else if (emit_type->optional || emit_type->outofline) {
         fprintf(header, "    %s %s *%s;\n",
                 structstr,
                 emit_type->name,
@@ -975,29 +3944,523 @@ emit_wrappers(
     fprintf(source, "    __marshall_%s(out, &cursor);\n", name);
     fprintf(source, "    xdr_write_cursor_flush(&cursor);\n");
     fprintf(source, "    *niov_out = cursor.niov;\n");
+    fprintf(source, "    if (unlikely(cursor.error)) {\n");
+    fprintf(source, "        return -1;\n");
+    fprintf(source, "    }\n");
+    fprintf(source, "    return cursor.total;\n");
+    fprintf(source, "}\n\n");
+
+    /* As marshall_<type>, applying and reporting the layout policy */
+    fprintf(source, "int\n");
+    fprintf(source, "marshall_aligned_%s(\n", name);
+    fprintf(source, "    const struct %s *out,\n", name);
+    fprintf(source, "    xdr_iovec *iov_in,\n");
+    fprintf(source, "    xdr_iovec *iov_out,\n");
+    fprintf(source, "    int *niov_out,\n");
+    fprintf(source, "    int out_offset,\n");
+    fprintf(source, "    xdr_marshall_layout *layout) {\n");
+    fprintf(source, "    struct xdr_write_cursor cursor;\n");
+    fprintf(source,
+            "    xdr_write_cursor_init(&cursor, iov_in, iov_out, *niov_out, NULL, out_offset);\n");
+    fprintf(source, "    cursor.layout = layout;\n");
+    fprintf(source, "    __marshall_%s(out, &cursor);\n", name);
+    fprintf(source, "    xdr_write_cursor_flush(&cursor);\n");
+    fprintf(source, "    *niov_out = cursor.niov;\n");
+    fprintf(source, "    layout->npayload = cursor.npayload;\n");
+    fprintf(source, "    if (unlikely(cursor.error)) {\n");
+    fprintf(source, "        return -1;\n");
+    fprintf(source, "    }\n");
     fprintf(source, "    return cursor.total;\n");
     fprintf(source, "}\n\n");
 
-    fprintf(source, "int\n");
-    fprintf(source, "unmarshall_%s(\n", name);
-    fprintf(source, "    struct %s *out,\n", name);
-    fprintf(source, "    const xdr_iovec *iov,\n");
-    fprintf(source, "    int niov,\n");
-    fprintf(source, "    struct evpl_rpc2_rdma_chunk *read_chunk,\n");
-    fprintf(source, "    xdr_dbuf *dbuf) {\n");
-    fprintf(source, "    struct xdr_read_cursor cursor;\n");
-    fprintf(source, "    xdr_read_cursor_init(&cursor, iov, niov, read_chunk);\n");
-    fprintf(source, "    return __unmarshall_%s(out, &cursor, dbuf);\n", name
-            );
-    fprintf(source, "}\n\n");
-} /* emit_wrappers */
+    fprintf(source, "int\n");
+    fprintf(source, "unmarshall_%s(\n", name);
+    fprintf(source, "    struct %s *out,\n", name);
+    fprintf(source, "    const xdr_iovec *iov,\n");
+    fprintf(source, "    int niov,\n");
+    fprintf(source, "    struct evpl_rpc2_rdma_chunk *read_chunk,\n");
+    fprintf(source, "    xdr_dbuf *dbuf) {\n");
+    fprintf(source, "    struct xdr_read_cursor cursor;\n");
+    fprintf(source, "    xdr_read_cursor_init(&cursor, iov, niov, read_chunk);\n");
+    fprintf(source, "    return __unmarshall_%s(out, &cursor, dbuf);\n", name
+            );
+    fprintf(source, "}\n\n");
+
+    /* Returns the encoded size, or -1 if it did not fit within cap */
+    fprintf(source, "int\n");
+    fprintf(source, "marshall_flat_%s(\n", name);
+    fprintf(source, "    const struct %s *in,\n", name);
+    fprintf(source, "    void *buf,\n");
+    fprintf(source, "    size_t cap) {\n");
+    fprintf(source, "    struct xdr_flat_cursor cursor;\n");
+    fprintf(source, "    xdr_flat_cursor_init(&cursor, buf, cap);\n");
+    fprintf(source, "    __marshall_flat_%s(in, &cursor);\n", name);
+    fprintf(source, "    if (unlikely(cursor.overflow)) {\n");
+    fprintf(source, "        return -1;\n");
+    fprintf(source, "    }\n");
+    fprintf(source, "    return cursor.used;\n");
+    fprintf(source, "}\n\n");
+
+    if (emit_stream) {
+        /* Each call encodes as much as fits in iov_in and the output iovecs
+         * and returns the bytes produced, picking up from where the previous
+         * call on the same stream stopped.  A step that can make no progress
+         * at all is an error, otherwise the caller would spin forever, and
+         * so is a value nested deeper than XDR_MAX_STREAM_DEPTH.
+         */
+        fprintf(source, "int\n");
+        fprintf(source, "marshall_stream_%s(\n", name);
+        fprintf(source, "    const struct %s *in,\n", name);
+        fprintf(source, "    xdr_marshall_stream *stream,\n");
+        fprintf(source, "    xdr_iovec *iov_in,\n");
+        fprintf(source, "    xdr_iovec *iov_out,\n");
+        fprintf(source, "    int *niov_out,\n");
+        fprintf(source, "    int out_offset) {\n");
+        fprintf(source, "    struct xdr_write_cursor cursor;\n");
+        fprintf(source, "    if (stream->complete) {\n");
+        fprintf(source, "        *niov_out = 0;\n");
+        fprintf(source, "        return 0;\n");
+        fprintf(source, "    }\n");
+        fprintf(source,
+                "    xdr_write_cursor_init(&cursor, iov_in, iov_out, *niov_out, NULL, out_offset);\n");
+        fprintf(source, "    stream->depth = 0;\n");
+        fprintf(source, "    if (__marshall_stream_%s(in, &cursor, stream) == 0) {\n", name);
+        fprintf(source, "        stream->complete = 1;\n");
+        fprintf(source, "    }\n");
+        fprintf(source, "    xdr_write_cursor_flush(&cursor);\n");
+        fprintf(source, "    *niov_out = cursor.niov;\n");
+        fprintf(source, "    if (unlikely(stream->error ||\n");
+        fprintf(source, "                 (!stream->complete && cursor.total == out_offset))) {\n");
+        fprintf(source, "        return -1;\n");
+        fprintf(source, "    }\n");
+        fprintf(source, "    return cursor.total;\n");
+        fprintf(source, "}\n\n");
+    }
+} /* emit_wrappers */
+
+/* Resolves a <type>.<member> option argument to the struct member */
+static struct xdr_struct_member *
+find_option_member(struct xdr_option *xdr_optionp)
+{
+    struct xdr_identifier    *chk;
+    struct xdr_struct_member *member;
+    char                      type[256];
+    const char               *dot = strchr(xdr_optionp->value, '.');
+
+    if (dot && dot - xdr_optionp->value < (int) sizeof(type)) {
+        snprintf(type, sizeof(type), "%.*s",
+                 (int) (dot - xdr_optionp->value), xdr_optionp->value);
+
+        HASH_FIND_STR(xdr_identifiers, type, chk);
+
+        if (chk && chk->type == XDR_STRUCT) {
+            DL_FOREACH(((struct xdr_struct *) chk->ptr)->members, member)
+            {
+                if (strcmp(member->name, dot + 1) == 0) {
+                    return member;
+                }
+            }
+        }
+    }
+
+    fprintf(stderr, "-%c %s does not name a struct member\n",
+            xdr_optionp->opt, xdr_optionp->value);
+    exit(1);
+} /* find_option_member */
+
+/*
+ * Returns the argument of the -<opt> option that names 'value', if any,
+ * ignoring a trailing ":<parameter>" such as the capacity given to -i
+ */
+static const char *
+find_option(
+    int         opt,
+    const char *value)
+{
+    struct xdr_option *xdr_optionp;
+    size_t             len;
+
+    DL_FOREACH(xdr_options, xdr_optionp)
+    {
+        len = strcspn(xdr_optionp->value, ":");
+
+        if (xdr_optionp->opt == opt && strlen(value) == len &&
+            strncmp(xdr_optionp->value, value, len) == 0) {
+            return xdr_optionp->value;
+        }
+    }
+
+    return NULL;
+} /* find_option */
+
+/*
+ * Approximate size of the C representation of a type as laid out in the
+ * generated header, used only to pick the union arms to store out of line.
+ */
+static int
+type_c_size(
+    struct xdr_type *type,
+    int             *align)
+{
+    struct xdr_identifier    *chk;
+    struct xdr_struct        *xdr_structp;
+    struct xdr_struct_member *member;
+    struct xdr_union         *xdr_unionp;
+    struct xdr_union_case    *casep;
+    struct xdr_type           scalar;
+    int                       size, elem, a, count = 1;
+    int64_t                   value;
+
+    if (type->narrow) {
+        *align = strstr(type->narrow, "16") ? 2 : 1;
+        return *align;
+    }
+
+    if (type->optional || type->linkedlist || type->outofline) {
+        *align = 8;
+        return 8;
+    }
+
+    if (type->vector || (type->opaque && !type->array) ||
+        strcmp(type->name, "xdr_string") == 0) {
+        *align = 8;
+        size   = 16;
+
+        if (type->inlinecap && resolve_label(type->inlinecap, &value, 0)) {
+            elem = 1;
+
+            if (!type->opaque) {
+                scalar        = *type;
+                scalar.vector = 0;
+                elem          = type_c_size(&scalar, &a);
+            }
+
+            size = (size + value * elem + 7) / 8 * 8;
+        }
+
+        return size;
+    }
+
+    if (type->array) {
+        if (!resolve_label(type->array_size, &value, 0)) {
+            value = 1;
+        }
+        count = value;
+    }
+
+    if (type->opaque) {
+        *align = 1;
+        return count;
+    }
+
+    if (type->enumeration) {
+        *align = 4;
+        return 4 * count;
+    }
+
+    if (type->builtin) {
+        *align = builtin_wire_size(type->name);
+        return *align * count;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    if (!chk) {
+        *align = 1;
+        return 0;
+    }
+
+    size   = 0;
+    *align = 1;
+
+    if (chk->type == XDR_TYPEDEF) {
+        size = type_c_size(((struct xdr_typedef *) chk->ptr)->type, align);
+    } else if (chk->type == XDR_ENUM) {
+        size   = 4;
+        *align = 4;
+    } else if (chk->type == XDR_STRUCT) {
+        xdr_structp = chk->ptr;
+
+        DL_FOREACH(xdr_structp->members, member)
+        {
+            elem   = type_c_size(member->type, &a);
+            size   = (size + a - 1) / a * a + elem;
+            *align = a > *align ? a : *align;
+        }
+    } else if (chk->type == XDR_UNION) {
+        xdr_unionp = chk->ptr;
+        *align     = 4;
+
+        DL_FOREACH(xdr_unionp->cases, casep)
+        {
+            if (casep->type) {
+                elem   = type_c_size(casep->type, &a);
+                size   = elem > size ? elem : size;
+                *align = a > *align ? a : *align;
+            }
+        }
+
+        size = (4 + *align - 1) / *align * *align + size;
+    }
+
+    size = (size + *align - 1) / *align * *align;
+
+    return size * count;
+} /* type_c_size */
+
+/*
+ * Whether a value of the type, including structs and unions it holds by
+ * value, has members with -i inline storage pointing into itself.
+ */
+static int
+type_has_inline(struct xdr_type *type)
+{
+    struct xdr_identifier    *chk;
+    struct xdr_struct_member *member;
+    struct xdr_union_case    *casep;
+
+    if (type->inlinecap) {
+        return 1;
+    }
+
+    if (type->optional || type->linkedlist || type->outofline ||
+        type->vector || type->opaque || type->builtin ||
+        type->enumeration) {
+        return 0;
+    }
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    if (!chk) {
+        return 0;
+    }
+
+    if (chk->type == XDR_TYPEDEF) {
+        return type_has_inline(((struct xdr_typedef *) chk->ptr)->type);
+    }
+
+    if (chk->type == XDR_STRUCT) {
+        DL_FOREACH(((struct xdr_struct *) chk->ptr)->members, member)
+        {
+            if (type_has_inline(member->type)) {
+                return 1;
+            }
+        }
+    } else if (chk->type == XDR_UNION) {
+        DL_FOREACH(((struct xdr_union *) chk->ptr)->cases, casep)
+        {
+            if (casep->type && type_has_inline(casep->type)) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+} /* type_has_inline */
+
+/* Whether values of the type can reach a -k member, once marked */
+static int
+type_checksummed(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+
+    HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+    if (!chk) {
+        return 0;
+    }
+
+    if (chk->type == XDR_TYPEDEF) {
+        return type_checksummed(((struct xdr_typedef *) chk->ptr)->type);
+    }
+
+    if (chk->type == XDR_STRUCT) {
+        return ((struct xdr_struct *) chk->ptr)->checksummed;
+    }
+
+    if (chk->type == XDR_UNION) {
+        return ((struct xdr_union *) chk->ptr)->checksummed;
+    }
+
+    return 0;
+} /* type_checksummed */
+
+/* Smallest integer type that holds every value of a scalar enum or bool */
+static char *
+narrow_type(struct xdr_type *type)
+{
+    struct xdr_identifier *chk;
+    struct xdr_enum       *xdr_enump;
+    struct xdr_enum_entry *xdr_enum_entryp;
+    int64_t                value, min = 0, max = 1;
+
+    if (type->optional || type->vector || type->array || type->linkedlist) {
+        return NULL;
+    }
+
+    if (!type->boolean) {
+        HASH_FIND_STR(xdr_identifiers, type->name, chk);
+
+        if (!type->enumeration || !chk || chk->type != XDR_ENUM) {
+            return NULL;
+        }
+
+        xdr_enump = chk->ptr;
+        min       = INT64_MAX;
+        max       = INT64_MIN;
+
+        DL_FOREACH(xdr_enump->entries, xdr_enum_entryp)
+        {
+            if (!resolve_label(xdr_enum_entryp->value, &value, 0)) {
+                return NULL;
+            }
+
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+        }
+    }
+
+    if (min >= 0) {
+        if (max <= UINT8_MAX) {
+            return "uint8_t";
+        } else if (max <= UINT16_MAX) {
+            return "uint16_t";
+        }
+    } else if (min >= INT8_MIN && max <= INT8_MAX) {
+        return "int8_t";
+    } else if (min >= INT16_MIN && max <= INT16_MAX) {
+        return "int16_t";
+    }
+
+    return NULL;
+} /* narrow_type */
+
+/* Size and alignment of a member together with the fields emitted after it */
+static int
+member_c_size(
+    struct xdr_struct_member *member,
+    int                      *align)
+{
+    int size;
+
+    size = type_c_size(member->type, align);
+
+    if (member->listctl || member->checksum || member->hashtype) {
+        size   = (size + 7) / 8 * 8 + 8 * (!!member->listctl +
+                                           !!member->checksum +
+                                           !!member->hashtype);
+        *align = 8;
+    }
+
+    if (member->listarray) {
+        size  += 4;
+        *align = *align > 4 ? *align : 4;
+    }
+
+    return size;
+} /* member_c_size */
+
+static int
+members_c_size(
+    struct xdr_struct_member **members,
+    int                        n)
+{
+    int i, size = 0, elem, a, align = 1;
+
+    for (i = 0; i < n; ++i) {
+        elem  = member_c_size(members[i], &a);
+        size  = (size + a - 1) / a * a + elem;
+        align = a > align ? a : align;
+    }
+
+    return (size + align - 1) / align * align;
+} /* members_c_size */
+
+/*
+ * Order in which the members of a struct are laid out in C.  With -C they
+ * are sorted by decreasing alignment if that makes the struct smaller, so
+ * structs without padding keep their declaration order.  The wire order
+ * is always the declaration order.
+ */
+static struct xdr_struct_member **
+struct_member_order(
+    struct xdr_struct *xdr_structp,
+    int               *n)
+{
+    struct xdr_struct_member **order, **sorted, *member;
+    int                        i, j, a, b;
+
+    *n = 0;
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        (*n)++;
+    }
+
+    order  = xdr_alloc((*n + 1) * sizeof(*order));
+    sorted = xdr_alloc((*n + 1) * sizeof(*sorted));
+    i      = 0;
+
+    DL_FOREACH(xdr_structp->members, member)
+    {
+        order[i]  = member;
+        sorted[i] = member;
+        i++;
+    }
+
+    if (!compact_layout) {
+        return order;
+    }
+
+    for (i = 1; i < *n; ++i) {
+        for (j = i; j > 0; --j) {
+            member_c_size(sorted[j - 1], &a);
+            member_c_size(sorted[j], &b);
+
+            if (a >= b) {
+                break;
+            }
+
+            member        = sorted[j];
+            sorted[j]     = sorted[j - 1];
+            sorted[j - 1] = member;
+        }
+    }
+
+    return members_c_size(sorted, *n) < members_c_size(order, *n) ?
+           sorted : order;
+} /* struct_member_order */
 
 void
 print_usage(const char *prog_name)
 {
     fprintf(stderr, "Usage: %s <input.x> <output.c> <output.h>\n", prog_name);
     fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -a <type.member>  Decode linked list <member> of <type> into an\n"
+                    "                array of num_<member> elements\n");
+    fprintf(stderr, "  -c <type>     Memoize encodings of <type> via an attached xdr_encode_cache\n");
+    fprintf(stderr, "  -C            Lay out structs compactly: members ordered by alignment\n"
+                    "                and enums and bools narrowed to fit their values\n");
     fprintf(stderr, "  -h            Display this help message and exit\n");
+    fprintf(stderr, "  -i <typedef>[:<n>]  Decode vector and opaque members declared as\n"
+                    "                <typedef> into room for <n> elements, or the bound,\n"
+                    "                inside the struct, spilling larger values to the dbuf\n");
+    fprintf(stderr, "  -H <typedef>  Hash string and opaque members declared as <typedef>\n"
+                    "                while decoding them, and offer them for interning\n");
+    fprintf(stderr, "  -k <type.member>  Compute the CRC32C of opaque <member> of <type>\n"
+                    "                while encoding and decoding it\n");
+    fprintf(stderr, "  -l <type.member>  Allow list or vector <member> of <type> to be\n"
+                    "                encoded from an attached xdr_marshall_list\n");
+    fprintf(stderr, "  -O <bytes>    Store union arms of struct or union type larger than\n"
+                    "                <bytes> behind a pointer, allocated only when decoded\n");
+    fprintf(stderr, "  -p <type>     Remember where values of <type> were decoded from and\n"
+                    "                re-marshall them from those bytes until marked dirty\n");
+    fprintf(stderr, "  -r            Emit evpl rpc2 program bindings\n");
+    fprintf(stderr, "  -s            Emit resumable marshall_stream_<type> functions\n");
+    fprintf(stderr, "  -u <typedef>  Reject string and opaque members declared as <typedef>\n"
+                    "                that are not valid UTF-8 while decoding them\n");
+    fprintf(stderr, "  -v            Emit view_<type> accessors that read members in place\n"
+                    "                from encoded data without decoding it\n");
 } /* print_usage */
 
 int
@@ -1017,21 +4480,54 @@ main(
     struct xdr_const         *xdr_constp;
     struct xdr_buffer        *xdr_buffer;
     struct xdr_identifier    *xdr_identp, *xdr_identp_tmp, *chk, *chkm;
-    int                       unemitted, ready, emit_rpc2 = 0;
+    int                       unemitted, ready, changed, emit_rpc2 = 0;
     FILE                     *header, *source;
     const char               *input_file;
     const char               *output_c;
     const char               *output_h;
-    int                       opt;
+    struct xdr_option        *xdr_optionp;
+    struct xdr_type          *xdr_typep, scalar;
+    struct xdr_struct_member **members;
+    int                       opt, align, i, nmembers;
+    char                      inlined[256];
 
-    while ((opt = getopt(argc, argv, "hr")) != -1) {
+    while ((opt = getopt(argc, argv, "a:c:ChH:i:k:l:O:p:rsu:v")) != -1) {
         switch (opt) {
+            case 'a':
+            case 'c':
+            case 'H':
+            case 'i':
+            case 'k':
+            case 'l':
+            case 'p':
+            case 'u':
+                xdr_optionp        = xdr_alloc(sizeof(*xdr_optionp));
+                xdr_optionp->opt   = opt;
+                xdr_optionp->value = optarg;
+                DL_APPEND(xdr_options, xdr_optionp);
+                break;
+            case 'C':
+                compact_layout = 1;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
             case 'r':
                 emit_rpc2 = 1;
                 break;
+            case 's':
+                emit_stream = 1;
+                break;
+            case 'v':
+                emit_views = 1;
+                break;
+            case 'O':
+                union_arm_limit = atoi(optarg);
+                if (union_arm_limit <= 0) {
+                    fprintf(stderr, "Error: -O needs a size in bytes.\n");
+                    return 1;
+                }
+                break;
             default:
                 print_usage(argv[0]);
                 return 1;
@@ -1128,9 +4624,16 @@ main(
                     if (chk && chk->type == XDR_ENUM) {
                         xdr_struct_memberp->type->enumeration = 1;
                     } else if (chk && chk->type == XDR_TYPEDEF) {
+                        xdr_struct_memberp->hashtype = find_option('H',
+                                                                   xdr_struct_memberp->type->name);
+                        xdr_struct_memberp->utf8 = !!find_option('u',
+                                                                 xdr_struct_memberp->type->name);
+                        xdr_struct_memberp->inlined = find_option('i',
+                                                                  xdr_struct_memberp->type->name);
                         xdr_struct_memberp->type = ((struct xdr_typedef *) chk->
                                                     ptr)->type;
                     } else if (chk && chk->type == XDR_STRUCT &&
+                               xdr_struct_memberp->type->optional &&
                                ((struct xdr_struct *) chk->ptr)->linkedlist) {
                         xdr_struct_memberp->type->linkedlist = 1;
                     }
@@ -1193,6 +4696,287 @@ main(
         } /* switch */
     }
 
+    DL_FOREACH(xdr_structs, xdr_structp)
+    {
+        DL_FOREACH(xdr_structp->members, xdr_struct_memberp)
+        {
+            xdr_typep = xdr_struct_memberp->type;
+
+            if (xdr_struct_memberp->inlined) {
+                if (!((xdr_typep->vector && !xdr_typep->opaque) ||
+                      (xdr_typep->opaque && !xdr_typep->array &&
+                       !xdr_typep->zerocopy))) {
+                    fprintf(stderr, "-i %s is not a vector or variable length opaque\n",
+                            xdr_struct_memberp->inlined);
+                    exit(1);
+                }
+
+                if (xdr_struct_memberp->hashtype || xdr_struct_memberp->utf8) {
+                    fprintf(stderr, "-i %s cannot be combined with -H or -u\n",
+                            xdr_struct_memberp->inlined);
+                    exit(1);
+                }
+
+                xdr_struct_memberp->type = xdr_alloc(sizeof(*xdr_typep));
+                *xdr_struct_memberp->type = *xdr_typep;
+
+                if (strchr(xdr_struct_memberp->inlined, ':')) {
+                    xdr_struct_memberp->type->inlinecap =
+                        strchr(xdr_struct_memberp->inlined, ':') + 1;
+                } else {
+                    xdr_struct_memberp->type->inlinecap = xdr_typep->vector_bound;
+                }
+
+                if (!xdr_struct_memberp->type->inlinecap ||
+                    !xdr_struct_memberp->type->inlinecap[0]) {
+                    fprintf(stderr, "-i %s needs a capacity for an unbounded type\n",
+                            xdr_struct_memberp->inlined);
+                    exit(1);
+                }
+
+                xdr_typep = xdr_struct_memberp->type;
+            }
+
+            if (!compact_layout || !narrow_type(xdr_typep)) {
+                continue;
+            }
+
+            /* The type may be shared with other members through a typedef */
+            xdr_struct_memberp->type         = xdr_alloc(sizeof(*xdr_typep));
+            *xdr_struct_memberp->type        = *xdr_typep;
+            xdr_struct_memberp->type->narrow = narrow_type(xdr_typep);
+        }
+    }
+
+    /*
+     * Unions are visited in declaration order, so the size of a union used
+     * as an arm of a later one already reflects its own out of line arms.
+     */
+    DL_FOREACH(xdr_unions, xdr_unionp)
+    {
+        DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
+        {
+            xdr_typep = xdr_union_casep->type;
+
+            if (!union_arm_limit || !xdr_typep || xdr_typep->builtin ||
+                xdr_typep->enumeration || xdr_typep->optional ||
+                xdr_typep->vector || xdr_typep->array || xdr_typep->opaque) {
+                continue;
+            }
+
+            HASH_FIND_STR(xdr_identifiers, xdr_typep->name, chk);
+
+            if (!chk || (chk->type != XDR_STRUCT && chk->type != XDR_UNION) ||
+                type_c_size(xdr_typep, &align) <= union_arm_limit) {
+                continue;
+            }
+
+            /* The type may be shared with other members through a typedef */
+            xdr_union_casep->type            = xdr_alloc(sizeof(*xdr_typep));
+            *xdr_union_casep->type           = *xdr_typep;
+            xdr_union_casep->type->outofline = 1;
+        }
+    }
+
+    DL_FOREACH(xdr_options, xdr_optionp)
+    {
+        if (xdr_optionp->opt == 'l') {
+            xdr_struct_memberp = find_option_member(xdr_optionp);
+
+            if (!(xdr_struct_memberp->type->linkedlist ||
+                  (xdr_struct_memberp->type->vector &&
+                   !xdr_struct_memberp->type->opaque))) {
+                fprintf(stderr, "-l %s is not a list or vector\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            if (xdr_struct_memberp->listarray) {
+                fprintf(stderr, "-l %s cannot be combined with -a\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            if (emit_stream) {
+                fprintf(stderr, "-l %s cannot be combined with -s\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            xdr_struct_memberp->listctl = 1;
+            continue;
+        }
+
+        if (xdr_optionp->opt == 'a') {
+            xdr_struct_memberp = find_option_member(xdr_optionp);
+
+            if (!xdr_struct_memberp->type->linkedlist) {
+                fprintf(stderr, "-a %s is not a linked list\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            if (xdr_struct_memberp->listctl) {
+                fprintf(stderr, "-a %s cannot be combined with -l\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            /*
+             * Growing the array moves the elements, which would leave their
+             * inline storage pointers behind in the old copy.
+             */
+            scalar            = *xdr_struct_memberp->type;
+            scalar.optional   = 0;
+            scalar.linkedlist = 0;
+
+            if (type_has_inline(&scalar)) {
+                fprintf(stderr, "-a %s cannot be combined with -i members\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            xdr_struct_memberp->listarray = 1;
+            continue;
+        }
+
+        if (xdr_optionp->opt == 'k') {
+            xdr_struct_memberp = find_option_member(xdr_optionp);
+
+            if (!xdr_struct_memberp->type->opaque ||
+                xdr_struct_memberp->type->array) {
+                fprintf(stderr, "-k %s is not a variable length opaque\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            if (emit_stream) {
+                fprintf(stderr, "-k %s cannot be combined with -s\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            if (xdr_struct_memberp->hashtype || xdr_struct_memberp->utf8 ||
+                xdr_struct_memberp->inlined) {
+                fprintf(stderr, "-k %s cannot be combined with -H, -i or -u\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            xdr_struct_memberp->checksum = 1;
+            continue;
+        }
+
+        if (xdr_optionp->opt == 'H' || xdr_optionp->opt == 'u') {
+            struct xdr_type *named;
+
+            HASH_FIND_STR(xdr_identifiers, xdr_optionp->value, chk);
+
+            if (!chk || chk->type != XDR_TYPEDEF) {
+                fprintf(stderr, "-%c %s does not name a typedef\n",
+                        xdr_optionp->opt, xdr_optionp->value);
+                exit(1);
+            }
+
+            named = ((struct xdr_typedef *) chk->ptr)->type;
+
+            if (!((named->opaque && !named->array && !named->zerocopy) ||
+                  strcmp(named->name, "xdr_string") == 0)) {
+                fprintf(stderr, "-%c %s is not a string or variable length opaque\n",
+                        xdr_optionp->opt, xdr_optionp->value);
+                exit(1);
+            }
+
+            continue;
+        }
+
+        if (xdr_optionp->opt == 'i') {
+            snprintf(inlined, sizeof(inlined), "%.*s",
+                     (int) strcspn(xdr_optionp->value, ":"), xdr_optionp->value);
+
+            HASH_FIND_STR(xdr_identifiers, inlined, chk);
+
+            if (!chk || chk->type != XDR_TYPEDEF) {
+                fprintf(stderr, "-i %s does not name a typedef\n",
+                        xdr_optionp->value);
+                exit(1);
+            }
+
+            continue;
+        }
+
+        HASH_FIND_STR(xdr_identifiers, xdr_optionp->value, chk);
+
+        if (chk && chk->type == XDR_STRUCT && xdr_optionp->opt == 'p') {
+            ((struct xdr_struct *) chk->ptr)->passthrough = 1;
+        } else if (chk && chk->type == XDR_UNION && xdr_optionp->opt == 'p') {
+            ((struct xdr_union *) chk->ptr)->passthrough = 1;
+        } else if (chk && chk->type == XDR_STRUCT) {
+            ((struct xdr_struct *) chk->ptr)->cached = 1;
+        } else if (chk && chk->type == XDR_UNION) {
+            ((struct xdr_union *) chk->ptr)->cached = 1;
+        } else {
+            fprintf(stderr, "-%c %s does not name a struct or union\n",
+                    xdr_optionp->opt, xdr_optionp->value);
+            exit(1);
+        }
+    }
+
+    /*
+     * Cache hits and passthrough replays emit bytes without encoding the
+     * members, so a -k member anywhere beneath them would never have its
+     * checksum stored.  Mark every type that can reach one, through
+     * pointers as well, until nothing changes.
+     */
+    do {
+        changed = 0;
+
+        DL_FOREACH(xdr_structs, xdr_structp)
+        {
+            DL_FOREACH(xdr_structp->members, xdr_struct_memberp)
+            {
+                if (!xdr_structp->checksummed &&
+                    (xdr_struct_memberp->checksum ||
+                     type_checksummed(xdr_struct_memberp->type))) {
+                    xdr_structp->checksummed = 1;
+                    changed                  = 1;
+                }
+            }
+        }
+
+        DL_FOREACH(xdr_unions, xdr_unionp)
+        {
+            DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
+            {
+                if (!xdr_unionp->checksummed && xdr_union_casep->type &&
+                    type_checksummed(xdr_union_casep->type)) {
+                    xdr_unionp->checksummed = 1;
+                    changed                 = 1;
+                }
+            }
+        }
+    } while (changed);
+
+    DL_FOREACH(xdr_structs, xdr_structp)
+    {
+        if ((xdr_structp->cached || xdr_structp->passthrough) &&
+            xdr_structp->checksummed) {
+            fprintf(stderr, "-%c %s cannot contain -k members\n",
+                    xdr_structp->cached ? 'c' : 'p', xdr_structp->name);
+            exit(1);
+        }
+    }
+
+    DL_FOREACH(xdr_unions, xdr_unionp)
+    {
+        if ((xdr_unionp->cached || xdr_unionp->passthrough) &&
+            xdr_unionp->checksummed) {
+            fprintf(stderr, "-%c %s cannot contain -k members\n",
+                    xdr_unionp->cached ? 'c' : 'p', xdr_unionp->name);
+            exit(1);
+        }
+    }
+
     header = fopen(output_h, "w");
 
     if (!header) {
@@ -1266,10 +5050,41 @@ main(
 
             fprintf(header, "struct %s {\n", xdr_structp->name);
 
-            DL_FOREACH(xdr_structp->members, xdr_struct_memberp)
-            {
+            members = struct_member_order(xdr_structp, &nmembers);
+
+            for (i = 0; i < nmembers; ++i) {
+                xdr_struct_memberp = members[i];
+
                 emit_member(header, xdr_struct_memberp->name,
                             xdr_struct_memberp->type);
+
+                if (xdr_struct_memberp->listctl) {
+                    fprintf(header, "    %-39s *%s_ctl;\n",
+                            "xdr_marshall_list", xdr_struct_memberp->name);
+                }
+
+                if (xdr_struct_memberp->checksum) {
+                    fprintf(header, "    %-39s *%s_crc32c;\n",
+                            "uint32_t", xdr_struct_memberp->name);
+                }
+
+                if (xdr_struct_memberp->listarray) {
+                    fprintf(header, "    %-39s num_%s;\n",
+                            "uint32_t", xdr_struct_memberp->name);
+                }
+
+                if (xdr_struct_memberp->hashtype) {
+                    fprintf(header, "    %-39s %s_hash;\n",
+                            "uint64_t", xdr_struct_memberp->name);
+                }
+            }
+
+            if (xdr_structp->cached) {
+                emit_cache_members(header);
+            }
+
+            if (xdr_structp->passthrough) {
+                fprintf(header, "    %-39s xdr_wire;\n", "xdr_wire_range");
             }
             fprintf(header, "};\n\n");
 
@@ -1339,6 +5154,14 @@ main(
             }
 
             fprintf(header, "    };\n");
+
+            if (xdr_unionp->cached) {
+                emit_cache_members(header);
+            }
+
+            if (xdr_unionp->passthrough) {
+                fprintf(header, "    %-39s xdr_wire;\n", "xdr_wire_range");
+            }
             fprintf(header, "};\n\n");
 
             HASH_FIND_STR(xdr_identifiers, xdr_unionp->name, chk);
@@ -1352,14 +5175,39 @@ main(
     {
         emit_wrapper_headers(header, xdr_structp->name);
         emit_dump_headers(header, xdr_structp->name);
+        emit_offsets_struct(header, xdr_structp, 1);
     }
 
     DL_FOREACH(xdr_unions, xdr_unionp)
     {
         emit_wrapper_headers(header, xdr_unionp->name);
         emit_dump_headers(header, xdr_unionp->name);
+        emit_offsets_union(header, xdr_unionp, 1);
     }
 
+    if (emit_views) {
+        DL_FOREACH(xdr_structs, xdr_structp)
+        {
+            fprintf(header, "struct view_%s;\n", xdr_structp->name);
+        }
+
+        DL_FOREACH(xdr_unions, xdr_unionp)
+        {
+            fprintf(header, "struct view_%s;\n", xdr_unionp->name);
+        }
+
+        fprintf(header, "\n");
+
+        DL_FOREACH(xdr_structs, xdr_structp)
+        {
+            emit_view_struct(header, xdr_structp, 1);
+        }
+
+        DL_FOREACH(xdr_unions, xdr_unionp)
+        {
+            emit_view_union(header, xdr_unionp, 1);
+        }
+    }
 
     if (emit_rpc2) {
         DL_FOREACH(xdr_programs, xdr_programp)
@@ -1404,24 +5252,14 @@ main(
 
     DL_FOREACH(xdr_structs, xdr_structp)
     {
+        emit_wire_struct_arrays(source, xdr_structp);
+    }
 
-        fprintf(source, "static void\n");
-        fprintf(source, "__marshall_%s(\n", xdr_structp->name);
-        fprintf(source, "    const struct %s *in,\n", xdr_structp->name);
-        fprintf(source, "    struct xdr_write_cursor *cursor) {\n");
-
-        DL_FOREACH(xdr_structp->members, xdr_struct_memberp)
-        {
-            if (xdr_structp->linkedlist &&
-                strncmp(xdr_struct_memberp->name, "next", 4) == 0) {
-                continue;
-            }
-
-            emit_marshall(source, xdr_struct_memberp->name,
-                          xdr_struct_memberp->type);
-        }
+    DL_FOREACH(xdr_structs, xdr_structp)
+    {
 
-        fprintf(source, "}\n\n");
+        emit_marshall_struct(source, xdr_structp, "", "xdr_write_cursor");
+        emit_marshall_struct(source, xdr_structp, "flat_", "xdr_flat_cursor");
 
         fprintf(source, "static int\n");
         fprintf(source, "__unmarshall_%s(\n", xdr_structp->name);
@@ -1430,17 +5268,50 @@ main(
         fprintf(source, "    xdr_dbuf *dbuf) {\n");
         fprintf(source, "    int rc, len = 0;\n");
 
+        if (xdr_structp->cached) {
+            fprintf(source, "    out->xdr_cache = NULL;\n");
+        }
+
+        if (xdr_structp->passthrough) {
+            emit_wire_start(source);
+        }
+
         DL_FOREACH(xdr_structp->members, xdr_struct_memberp)
         {
 
-            if (xdr_structp->linkedlist &&
-                strncmp(xdr_struct_memberp->name, "next", 4) == 0) {
+            if (struct_member_is_next(xdr_structp, xdr_struct_memberp)) {
                 continue;
             }
 
-            emit_unmarshall(source, xdr_struct_memberp->name, xdr_struct_memberp
-                            ->type);
+            if (xdr_struct_memberp->listctl) {
+                fprintf(source, "    out->%s_ctl = NULL;\n",
+                        xdr_struct_memberp->name);
+            }
+
+            if (xdr_struct_memberp->checksum) {
+                emit_unmarshall_checksum(source, xdr_structp->name,
+                                         xdr_struct_memberp->name,
+                                         xdr_struct_memberp->type);
+            } else if (xdr_struct_memberp->listarray) {
+                emit_unmarshall_listarray(source, xdr_struct_memberp->name,
+                                          xdr_struct_memberp->type);
+            } else if (xdr_struct_memberp->hashtype ||
+                       xdr_struct_memberp->utf8) {
+                emit_unmarshall_name(source, xdr_struct_memberp->name,
+                                     xdr_struct_memberp->type,
+                                     xdr_struct_memberp->hashtype,
+                                     xdr_struct_memberp->utf8);
+            } else {
+                emit_unmarshall(source, xdr_structp->name,
+                                xdr_struct_memberp->name,
+                                xdr_struct_memberp->type);
+            }
+        }
+
+        if (xdr_structp->passthrough) {
+            emit_wire_finish(source);
         }
+
         fprintf(source, "    return len;\n");
         fprintf(source, "}\n\n");
 
@@ -1448,91 +5319,39 @@ main(
 
         emit_dump_struct(source, xdr_structp->name, xdr_structp);
         emit_length_struct(source, xdr_structp->name, xdr_structp);
-    } /* main */
-
-    DL_FOREACH(xdr_unions, xdr_unionp)
-    {
-        fprintf(source, "static void\n");
-        fprintf(source, "__marshall_%s(\n", xdr_unionp->name);
-        fprintf(source, "    const struct %s *in,\n", xdr_unionp->name);
-        fprintf(source, "    struct xdr_write_cursor *cursor) {\n");
-
-        emit_marshall(source, xdr_unionp->pivot_name, xdr_unionp->pivot_type);
+        emit_clone_struct(source, xdr_structp);
+        emit_offsets_struct(source, xdr_structp, 0);
 
-        fprintf(source, "    switch (in->%s) {\n", xdr_unionp->pivot_name);
-
-        DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
-        {
-            if (strcmp(xdr_union_casep->label, "default") != 0) {
-                fprintf(source, "    case %s:\n", xdr_union_casep->label);
-                if (xdr_union_casep->voided) {
-                    fprintf(source, "        break;\n");
-                } else if (xdr_union_casep->type) {
-                    emit_marshall(source, xdr_union_casep->name, xdr_union_casep
-                                  ->type);
-                    fprintf(source, "        break;\n");
-                }
-            }
+        if (emit_stream) {
+            emit_stream_struct(source, xdr_structp);
         }
 
-        DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
-        {
-            if (strcmp(xdr_union_casep->label, "default") == 0) {
-                fprintf(source, "    default:\n");
-                if (xdr_union_casep->voided) {
-                    fprintf(source, "        break;\n");
-                } else if (xdr_union_casep->type) {
-                    emit_marshall(source, xdr_union_casep->name, xdr_union_casep
-                                  ->type);
-                    fprintf(source, "        break;\n");
-                }
-            }
+        if (emit_views) {
+            emit_view_struct(source, xdr_structp, 0);
         }
+    } /* main */
 
-        fprintf(source, "    }\n");
-        fprintf(source, "    ;\n");
-        fprintf(source, "}\n\n");
+    DL_FOREACH(xdr_unions, xdr_unionp)
+    {
+        emit_marshall_union(source, xdr_unionp, "", "xdr_write_cursor");
+        emit_marshall_union(source, xdr_unionp, "flat_", "xdr_flat_cursor");
 
-        fprintf(source, "static int\n");
-        fprintf(source, "__unmarshall_%s(\n", xdr_unionp->name);
-        fprintf(source, "    struct %s *out,\n", xdr_unionp->name);
-        fprintf(source, "    struct xdr_read_cursor *cursor,\n");
-        fprintf(source, "    xdr_dbuf *dbuf) {\n");
-        fprintf(source, "    int rc, len = 0;\n");
+        emit_unmarshall_union(source, xdr_unionp);
 
-        emit_unmarshall(source, xdr_unionp->pivot_name, xdr_unionp->pivot_type);
+        emit_wrappers(source, xdr_unionp->name);
 
-        fprintf(source, "    switch (out->%s) {\n", xdr_unionp->pivot_name);
+        emit_dump_union(source, xdr_unionp->name, xdr_unionp);
+        emit_length_union(source, xdr_unionp->name, xdr_unionp);
+        emit_clone_union(source, xdr_unionp);
+        emit_offsets_union(source, xdr_unionp, 0);
 
-        DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
-        {
-            if (strcmp(xdr_union_casep->label, "default") != 0) {
-                fprintf(source, "    case %s:\n", xdr_union_casep->label);
-                if (xdr_union_casep->voided) {
-                    fprintf(source, "        break;\n");
-                } else if (xdr_union_casep->type) {
-                    emit_unmarshall(source, xdr_union_casep->name,
-                                    xdr_union_casep->type);
-                    fprintf(source, "        break;\n");
-                }
-            }
+        if (emit_stream) {
+            emit_stream_union(source, xdr_unionp);
         }
 
-        DL_FOREACH(xdr_unionp->cases, xdr_union_casep)
-        {
-            if (strcmp(xdr_union_casep->label, "default") == 0) {
-                fprintf(source, "    default:\n");
-                fprintf(source, "        break;\n");
-            }
+        if (emit_views) {
+            emit_view_union(source, xdr_unionp, 0);
         }
-        fprintf(source, "    }\n");
-        fprintf(source, "    return len;\n");
-        fprintf(source, "}\n\n");
-
-        emit_wrappers(source, xdr_unionp->name);
-
-        emit_dump_union(source, xdr_unionp->name, xdr_unionp);
-        emit_length_union(source, xdr_unionp->name, xdr_unionp);
     }
 
     if (emit_rpc2) {
@@ -0,0 +1,151 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "cache_xdr.h"
+
+static int
+encode(
+    const struct Reply *reply,
+    uint8_t            *out,
+    int                *niov)
+{
+    static uint8_t buffer[4096];
+    xdr_iovec      iov_in, iov_out[8];
+    int            i, rc, len;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    *niov = 8;
+
+    rc = marshall_Reply(reply, &iov_in, iov_out, niov, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < *niov; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    return len;
+} /* encode */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Reply     reply, reply2;
+    struct AttrRes   stale;
+    xdr_encode_cache cache, stale_cache;
+    xdr_dbuf        *dbuf;
+    xdr_iovec        iov;
+    uint8_t          cache_buf[1024], stale_buf[16], label[600];
+    uint8_t          out1[2048], out2[2048], flat[2048];
+    int              len1, len2, niov1, niov2, rc;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    xdr_encode_cache_init(&cache, cache_buf, sizeof(cache_buf));
+
+    memset(label, 0x5a, sizeof(label));
+
+    reply.xid                 = 1;
+    reply.res.status          = STATUS_OK;
+    reply.res.xdr_cache       = NULL;
+    reply.res.attr.size       = 12345;
+    reply.res.attr.mode       = 0644;
+    reply.res.attr.label.len  = 3;
+    reply.res.attr.label.data = label;
+    xdr_set_str_static(&reply.res.attr, owner, "root", 4);
+    reply.res.attr.xdr_cache     = &cache;
+    reply.res.attr.xdr_cache_key = 1;
+
+    /* First encode fills the cache */
+    len1 = encode(&reply, out1, &niov1);
+
+    assert(cache.valid && cache.key == 1);
+    assert(cache.len == 8 + 4 + 8 + 8);
+
+    /* While the key is unchanged the memoized bytes are spliced in as is */
+    reply.res.attr.mode = 0755;
+
+    len2 = encode(&reply, out2, &niov2);
+
+    assert(len1 == len2);
+    assert(memcmp(out1, out2, len1) == 0);
+
+    /* A new key re-encodes */
+    reply.res.attr.xdr_cache_key = 2;
+
+    len2 = encode(&reply, out2, &niov2);
+
+    assert(len1 == len2);
+    assert(memcmp(out1, out2, len1) != 0);
+    assert(cache.key == 2);
+
+    xdr_iovec_set_data(&iov, out2);
+    xdr_iovec_set_len(&iov, len2);
+
+    rc = unmarshall_Reply(&reply2, &iov, 1, NULL, dbuf);
+
+    assert(rc == len2);
+    assert(reply2.res.attr.mode == 0755);
+    assert(reply2.res.xdr_cache == NULL);
+    assert(reply2.res.attr.xdr_cache == NULL);
+
+    /* Flat output splices from the same cache */
+    rc = marshall_flat_Reply(&reply, flat, sizeof(flat));
+
+    assert(rc == len2);
+    assert(memcmp(flat, out2, len2) == 0);
+
+    /* Large cached encodings are referenced rather than copied */
+    reply.res.attr.label.len     = sizeof(label);
+    reply.res.attr.xdr_cache_key = 3;
+
+    len1 = encode(&reply, out1, &niov1);
+
+    assert(cache.valid && cache.len >= XDR_CACHE_REF_MIN);
+
+    len2 = encode(&reply, out2, &niov2);
+
+    assert(len1 == len2);
+    assert(memcmp(out1, out2, len1) == 0);
+    assert(niov2 > niov1);
+
+    /* An encoding that does not fit is simply not cached */
+    xdr_encode_cache_init(&cache, cache_buf, 16);
+
+    encode(&reply, out1, &niov1);
+
+    assert(!cache.valid);
+
+    /* Constant error replies memoize just the same */
+    xdr_encode_cache_init(&stale_cache, stale_buf, sizeof(stale_buf));
+
+    stale.status        = STATUS_STALE;
+    stale.xdr_cache     = &stale_cache;
+    stale.xdr_cache_key = 0;
+
+    rc = marshall_flat_AttrRes(&stale, flat, sizeof(flat));
+
+    assert(rc == 4);
+    assert(stale_cache.valid && stale_cache.len == 4);
+
+    rc = marshall_flat_AttrRes(&stale, flat, sizeof(flat));
+
+    assert(rc == 4);
+    assert(flat[3] == STATUS_STALE);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,23 @@
+enum Status {
+    STATUS_OK    = 0,
+    STATUS_STALE = 70
+};
+
+struct Attr {
+    uint64_t       size;
+    unsigned int   mode;
+    string         owner<>;
+    opaque         label<>;
+};
+
+union AttrRes switch (Status status) {
+ case STATUS_OK:
+    Attr attr;
+ default:
+    void;
+};
+
+struct Reply {
+    unsigned int xid;
+    AttrRes      res;
+};
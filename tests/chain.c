@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "chain_xdr.h"
+
+/* Deep enough that a frame per element would exhaust the stack */
+#define NUM_NODES (1024 * 1024)
+
+static uint32_t
+get32(const uint8_t *p)
+{
+    return ((uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+} /* get32 */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Chain chain1, chain2;
+    struct Node *nodes, *node, single;
+    struct Tree  tree[3];
+    struct Back  back[2], back2;
+    uint8_t      tail[16];
+    xdr_dbuf    *dbuf;
+    xdr_iovec    iov;
+    uint8_t     *flat;
+    int          i, rc, len;
+
+    nodes = malloc(NUM_NODES * sizeof(*nodes));
+    flat  = malloc(NUM_NODES * 8 + 1024);
+
+    for (i = 0; i < NUM_NODES; ++i) {
+        nodes[i].value = i;
+        nodes[i].link  = i + 1 < NUM_NODES ? &nodes[i + 1] : NULL;
+    }
+
+    /* Two self references make a tree, which is still coded recursively */
+    tree[0].value = 1;
+    tree[0].left  = &tree[1];
+    tree[0].right = &tree[2];
+    tree[1].value = 2;
+    tree[1].left  = NULL;
+    tree[1].right = NULL;
+    tree[2].value = 3;
+    tree[2].left  = NULL;
+    tree[2].right = NULL;
+
+    /* Other pointers to a chain type are coded as chains too */
+    single.value = 77;
+    single.link  = NULL;
+
+    chain1.head     = nodes;
+    chain1.root     = tree;
+    chain1.nextnode = &single;
+
+    /* A self reference that is not the last member is not a chain */
+    back[0].value = 5;
+    back[0].prev  = &back[1];
+    back[1].value = 6;
+    back[1].prev  = NULL;
+
+    chain1.back = back;
+
+    len = marshall_length_Chain(&chain1);
+
+    /* Each node is its marker and value, each tree node a value and two markers */
+    assert(len == NUM_NODES * 8 + 4 + 4 + 3 * 12 + 8 + 4 + 5 * 4);
+
+    rc = marshall_flat_Chain(&chain1, flat, NUM_NODES * 8 + 1024);
+
+    assert(rc == len);
+
+    /* Standard XDR nests the rest of the list before each value */
+    assert(get32(flat + len - 20) == 1);
+    assert(get32(flat + len - 16) == 1);
+    assert(get32(flat + len - 12) == 0);
+    assert(get32(flat + len - 8) == 6);
+    assert(get32(flat + len - 4) == 5);
+
+    dbuf = xdr_dbuf_alloc(NUM_NODES * sizeof(struct Node) + 64 * 1024);
+
+    xdr_iovec_set_data(&iov, flat);
+    xdr_iovec_set_len(&iov, len);
+
+    rc = unmarshall_Chain(&chain2, &iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+
+    for (i = 0, node = chain2.head; node; node = node->link) {
+        assert(node->value == (uint32_t) i);
+        ++i;
+    }
+
+    assert(i == NUM_NODES);
+    assert(chain2.root->value == 1);
+    assert(chain2.root->left->value == 2 && chain2.root->left->left == NULL);
+    assert(chain2.root->right->value == 3 && chain2.root->right->right == NULL);
+    assert(chain2.nextnode->value == 77 && chain2.nextnode->link == NULL);
+    assert(chain2.back->value == 5 && chain2.back->prev->value == 6);
+    assert(chain2.back->prev->prev == NULL);
+
+    /* Coding the type on its own keeps the self reference */
+    rc = marshall_flat_Back(back, tail, sizeof(tail));
+
+    assert(rc == 16);
+    assert(get32(tail) == 1 && get32(tail + 4) == 0);
+    assert(get32(tail + 8) == 6 && get32(tail + 12) == 5);
+
+    xdr_iovec_set_data(&iov, tail);
+    xdr_iovec_set_len(&iov, rc);
+
+    rc = unmarshall_Back(&back2, &iov, 1, NULL, dbuf);
+
+    assert(rc == 16);
+    assert(back2.value == 5 && back2.prev->value == 6 && !back2.prev->prev);
+
+    xdr_dbuf_free(dbuf);
+    free(flat);
+    free(nodes);
+
+    return 0;
+} /* main */
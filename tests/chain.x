@@ -0,0 +1,22 @@
+struct Node {
+    unsigned int value;
+    Node        *link;
+};
+
+struct Tree {
+    unsigned int value;
+    Tree        *left;
+    Tree        *right;
+};
+
+struct Back {
+    Back        *prev;
+    unsigned int value;
+};
+
+struct Chain {
+    Node *head;
+    Tree *root;
+    Node *nextnode;
+    Back *back;
+};
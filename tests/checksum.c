@@ -0,0 +1,144 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "checksum_xdr.h"
+
+/* Bitwise reference implementation */
+static uint32_t
+crc32c_ref(
+    const uint8_t *p,
+    int            len)
+{
+    uint32_t crc = ~0U;
+    int      i;
+
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ (0x82f63b78 & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+} /* crc32c_ref */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct WriteArgs msg1, msg2;
+    xdr_dbuf        *dbuf;
+    static uint8_t   buffer[32768], flat[32768], data[20000];
+    xdr_iovec        iov_in, iov_out[8], iov_data[3], iov_split[3];
+    xdr_file_segment seg;
+    uint32_t         crc_verifier, crc_data, flat_verifier, flat_data;
+    uint32_t         expect_data;
+    int              i, rc, len, niov_out = 8;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    assert(crc32c_ref((const uint8_t *) "123456789", 9) == 0xe3069283);
+
+    for (i = 0; i < 20000; ++i) {
+        data[i] = (i * 31) ^ (i >> 7);
+    }
+
+    expect_data = crc32c_ref(data, 20000);
+
+    /* Odd sized pieces exercise the word and byte tails */
+    xdr_iovec_set_data(&iov_data[0], data);
+    xdr_iovec_set_len(&iov_data[0], 13);
+    xdr_iovec_set_data(&iov_data[1], data + 13);
+    xdr_iovec_set_len(&iov_data[1], 9000);
+    xdr_iovec_set_data(&iov_data[2], data + 9013);
+    xdr_iovec_set_len(&iov_data[2], 20000 - 9013);
+
+    msg1.id            = 5;
+    msg1.verifier.len  = 9;
+    msg1.verifier.data = "123456789";
+    xdr_set_ref(&msg1, data, iov_data, 3, 20000);
+    msg1.verifier_crc32c = &crc_verifier;
+    msg1.data_crc32c     = &crc_data;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_WriteArgs(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+    assert(crc_verifier == 0xe3069283);
+    assert(crc_data == expect_data);
+
+    len = marshall_flat_WriteArgs(&msg1, flat, sizeof(flat));
+
+    assert(len == rc);
+
+    msg1.verifier_crc32c = &flat_verifier;
+    msg1.data_crc32c     = &flat_data;
+    flat_verifier        = 0;
+    flat_data            = 0;
+
+    assert(marshall_flat_WriteArgs(&msg1, flat, sizeof(flat)) == len);
+    assert(flat_verifier == 0xe3069283);
+    assert(flat_data == expect_data);
+
+    /* Without a destination nothing is computed */
+    msg1.verifier_crc32c = NULL;
+    msg1.data_crc32c     = NULL;
+    niov_out             = 8;
+
+    assert(marshall_WriteArgs(&msg1, &iov_in, iov_out, &niov_out, NULL, 0) == len);
+
+    /* Contiguous input, verifier referenced and checksummed in place */
+    xdr_iovec_set_data(&iov_in, flat);
+    xdr_iovec_set_len(&iov_in, len);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(*msg2.verifier_crc32c == 0xe3069283);
+    assert(*msg2.data_crc32c == expect_data);
+
+    /* Verifier split across iovecs is checksummed while it is copied */
+    xdr_iovec_set_data(&iov_split[0], flat);
+    xdr_iovec_set_len(&iov_split[0], 11);
+    xdr_iovec_set_data(&iov_split[1], flat + 11);
+    xdr_iovec_set_len(&iov_split[1], 5000);
+    xdr_iovec_set_data(&iov_split[2], flat + 5011);
+    xdr_iovec_set_len(&iov_split[2], len - 5011);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_WriteArgs(&msg2, iov_split, 3, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.verifier.len == 9);
+    assert(memcmp(msg2.verifier.data, "123456789", 9) == 0);
+    assert(*msg2.verifier_crc32c == 0xe3069283);
+    assert(msg2.data.niov == 2);
+    assert(*msg2.data_crc32c == expect_data);
+
+    /* A file segment that cannot be read back fails the marshall */
+    seg.fd     = -1;
+    seg.offset = 0;
+
+    xdr_iovec_set_file(&iov_data[0], &seg, 100);
+    xdr_set_ref(&msg1, data, iov_data, 1, 100);
+    msg1.data_crc32c = &crc_data;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+    niov_out = 8;
+
+    assert(marshall_WriteArgs(&msg1, &iov_in, iov_out, &niov_out, NULL, 0) == -1);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,5 @@
+struct WriteArgs {
+    unsigned int id;
+    opaque       verifier<>;
+    zcopaque     data<>;
+};
@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "clone_xdr.h"
+
+#define NUM_ENTRIES 5
+
+static char    *block;
+static uint32_t block_size;
+
+static void
+check_inside(const void *ptr)
+{
+    assert((const char *) ptr >= block &&
+           (const char *) ptr < block + block_size);
+} /* check_inside */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Message  msg1, msg2, *copy;
+    struct Detail   details[4];
+    struct Attr     attr;
+    struct Entry    entries[NUM_ENTRIES], *entry;
+    char            names[NUM_ENTRIES][16];
+    unsigned int    counts[3] = { 7, 8, 9 };
+    xdr_iovec       data_iov[2];
+    xdr_dbuf       *dbuf;
+    uint8_t         flat[4096], again[4096], *wire;
+    xdr_iovec       iov_wire[2];
+    int             i, rc, len;
+    uint32_t        size;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    memcpy(msg1.verifier, "verifier", 8);
+    xdr_set_str_static(&msg1, tag, "clone-me", 8);
+
+    details[0].kind = KIND_NONE;
+    details[1].kind = KIND_NAME;
+    xdr_set_str_static(&details[1], name, "detail", 6);
+    details[2].kind      = KIND_BLOB;
+    details[2].blob.data = "blobby";
+    details[2].blob.len  = 6;
+    details[3].kind      = KIND_ATTR;
+    details[3].attr.size = 1ULL << 33;
+    xdr_set_str_static(&details[3].attr, owner, "root", 4);
+
+    msg1.num_details = 4;
+    msg1.details     = details;
+
+    attr.size = 4096;
+    xdr_set_str_static(&attr, owner, "nobody", 6);
+    msg1.attr = &attr;
+
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        entries[i].cookie = 100 + i;
+        xdr_set_str_static(&entries[i], name, names[i],
+                           snprintf(names[i], sizeof(names[i]), "entry%d", i));
+        entries[i].nextentry = i + 1 < NUM_ENTRIES ? &entries[i + 1] : NULL;
+    }
+
+    msg1.entries = entries;
+
+    /* Payload split across two iovecs is gathered into one in the clone */
+    xdr_iovec_set_data(&data_iov[0], "0123");
+    xdr_iovec_set_len(&data_iov[0], 4);
+    xdr_iovec_set_data(&data_iov[1], "456789");
+    xdr_iovec_set_len(&data_iov[1], 6);
+
+    msg1.data.iov    = data_iov;
+    msg1.data.niov   = 2;
+    msg1.data.length = 10;
+
+    msg1.num_counts = 3;
+    msg1.counts     = counts;
+
+    len = marshall_flat_Message(&msg1, flat, sizeof(flat));
+
+    assert(len > 0);
+    assert(marshall_length_Message(&msg1) == len);
+
+    /* Decode from a copy of the wire that is destroyed afterwards */
+    wire = malloc(len);
+    memcpy(wire, flat, len);
+
+    xdr_iovec_set_data(&iov_wire[0], wire);
+    xdr_iovec_set_len(&iov_wire[0], 40);
+    xdr_iovec_set_data(&iov_wire[1], wire + 40);
+    xdr_iovec_set_len(&iov_wire[1], len - 40);
+
+    rc = unmarshall_Message(&msg2, iov_wire, 2, NULL, dbuf);
+
+    assert(rc == len);
+
+    size = clone_size_Message(&msg2);
+
+    assert(size > sizeof(struct Message));
+
+    block_size = size;
+    block      = malloc(block_size);
+
+    /* A block that is too small fails wherever it runs out */
+    for (i = 0; i < (int) size; ++i) {
+        assert(clone_Message(&msg2, block, i) == NULL);
+    }
+
+    copy = clone_Message(&msg2, block, block_size);
+
+    assert(copy == (struct Message *) block);
+
+    memset(wire, 0xa5, len);
+    free(wire);
+    xdr_dbuf_free(dbuf);
+    memset(&msg2, 0xa5, sizeof(msg2));
+
+    /* Everything the clone points at lives in the block */
+    assert(memcmp(copy->verifier, "verifier", 8) == 0);
+    check_inside(copy->tag.str);
+    assert(copy->tag.len == 8 && memcmp(copy->tag.str, "clone-me", 8) == 0);
+
+    check_inside(copy->details);
+    assert(copy->num_details == 4);
+    assert(copy->details[0].kind == KIND_NONE);
+    check_inside(copy->details[1].name.str);
+    assert(memcmp(copy->details[1].name.str, "detail", 6) == 0);
+    check_inside(copy->details[2].blob.data);
+    assert(copy->details[2].blob.len == 6);
+    assert(memcmp(copy->details[2].blob.data, "blobby", 6) == 0);
+    assert(copy->details[3].attr.size == 1ULL << 33);
+    check_inside(copy->details[3].attr.owner.str);
+    assert(memcmp(copy->details[3].attr.owner.str, "root", 4) == 0);
+
+    check_inside(copy->attr);
+    check_inside(copy->attr->owner.str);
+    assert(copy->attr->size == 4096);
+    assert(memcmp(copy->attr->owner.str, "nobody", 6) == 0);
+
+    for (i = 0, entry = copy->entries; entry; entry = entry->nextentry, ++i) {
+        check_inside(entry);
+        check_inside(entry->name.str);
+        assert(entry->cookie == 100 + i);
+        assert(entry->name.len == strlen(names[i]));
+        assert(memcmp(entry->name.str, names[i], entry->name.len) == 0);
+    }
+
+    assert(i == NUM_ENTRIES);
+
+    /* List nodes are laid out next to each other */
+    assert(copy->entries[1].nextentry == &copy->entries[2]);
+
+    check_inside(copy->data.iov);
+    assert(copy->data.niov == 1 && copy->data.length == 10);
+    check_inside(xdr_iovec_data(&copy->data.iov[0]));
+    assert(memcmp(xdr_iovec_data(&copy->data.iov[0]), "0123456789", 10) == 0);
+
+    check_inside(copy->counts);
+    assert(copy->num_counts == 3 && copy->counts[2] == 9);
+
+    /* The clone encodes to the same bytes as the original */
+    assert(marshall_length_Message(copy) == len);
+    rc = marshall_flat_Message(copy, again, sizeof(again));
+    assert(rc == len);
+    assert(memcmp(again, flat, len) == 0);
+
+    /* Absent members need no space */
+    memset(block, 0, block_size);
+    msg1.attr        = NULL;
+    msg1.entries     = NULL;
+    msg1.num_details = 0;
+
+    assert(clone_size_Message(&msg1) < size);
+
+    copy = clone_Message(&msg1, block, block_size);
+
+    assert(copy->attr == NULL && copy->entries == NULL);
+    assert(copy->num_details == 0);
+
+    free(block);
+
+    return 0;
+} /* main */
@@ -0,0 +1,41 @@
+enum Kind {
+    KIND_NONE  = 0,
+    KIND_NAME  = 1,
+    KIND_BLOB  = 2,
+    KIND_ATTR  = 3
+};
+
+typedef string Name<>;
+typedef opaque Blob<>;
+
+struct Attr {
+    uint64_t size;
+    string   owner<>;
+};
+
+union Detail switch (Kind kind) {
+ case KIND_NONE:
+    void;
+ case KIND_NAME:
+    Name   name;
+ case KIND_BLOB:
+    Blob   blob;
+ case KIND_ATTR:
+    Attr   attr;
+};
+
+struct Entry {
+    uint64_t cookie;
+    string   name<>;
+    Entry   *nextentry;
+};
+
+struct Message {
+    opaque       verifier[8];
+    string       tag<>;
+    Detail       details<>;
+    Attr        *attr;
+    Entry       *entries;
+    zcopaque     data<>;
+    unsigned int counts<>;
+};
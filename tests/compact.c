@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <stddef.h>
+
+#include "compact_xdr.h"
+
+static uint8_t *
+put32(
+    uint8_t *p,
+    uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+} /* put32 */
+
+static uint8_t *
+put64(
+    uint8_t *p,
+    uint64_t v)
+{
+    return put32(put32(p, v >> 32), v);
+} /* put64 */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Mixed msg1, msg2;
+    Color        colors[2] = { BLUE, GREEN };
+    xdr_dbuf    *dbuf;
+    uint8_t      flat[256], expect[256], *p;
+    xdr_iovec    iov_flat;
+    int          rc, len;
+
+    /* Enums and bools are narrowed, members are ordered by alignment */
+    assert(sizeof(msg1.flag) == 1);
+    assert(sizeof(msg1.color) == 1);
+    assert(sizeof(msg1.wide) == 2);
+    assert(sizeof(msg1.count) == 4);
+    assert(sizeof(struct Mixed) == 48);
+    assert(offsetof(struct Mixed, big) == 0);
+    assert(offsetof(struct Mixed, offset) == 8);
+
+    /* A struct without padding keeps its declaration order */
+    assert(offsetof(struct Packed, a) == 0);
+    assert(offsetof(struct Packed, b) == 4);
+    assert(offsetof(struct Packed, c) == 8);
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    msg1.flag       = 1;
+    msg1.big        = 0x0102030405060708ULL;
+    msg1.color      = BLUE;
+    msg1.count      = 77;
+    msg1.wide       = WIDE_HIGH;
+    msg1.offset     = -2;
+    msg1.done       = 0;
+    msg1.num_colors = 2;
+    msg1.colors     = colors;
+
+    /* The wire keeps the declaration order */
+    p = put32(expect, 1);
+    p = put64(p, 0x0102030405060708ULL);
+    p = put32(p, BLUE);
+    p = put32(p, 77);
+    p = put32(p, WIDE_HIGH);
+    p = put64(p, (uint64_t) -2);
+    p = put32(p, 0);
+    p = put32(p, 2);
+    p = put32(p, BLUE);
+    p = put32(p, GREEN);
+
+    len = marshall_flat_Mixed(&msg1, flat, sizeof(flat));
+
+    assert(len == p - expect);
+    assert(memcmp(flat, expect, len) == 0);
+    assert(marshall_length_Mixed(&msg1) == len);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Mixed(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.flag == 1);
+    assert(msg2.big == 0x0102030405060708ULL);
+    assert(msg2.color == BLUE);
+    assert(msg2.count == 77);
+    assert(msg2.wide == WIDE_HIGH);
+    assert(msg2.offset == -2);
+    assert(msg2.done == 0);
+    assert(msg2.num_colors == 2 && msg2.colors[0] == BLUE);
+
+    /* A value too wide for the narrowed member is rejected */
+    put32(flat + 12, 256);
+
+    rc = unmarshall_Mixed(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc < 0);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,28 @@
+
+enum Color {
+    RED   = 0,
+    GREEN = 1,
+    BLUE  = 2
+};
+
+enum Wide {
+    WIDE_LOW  = 1,
+    WIDE_HIGH = 300
+};
+
+struct Mixed {
+    bool         flag;
+    uint64_t     big;
+    Color        color;
+    unsigned int count;
+    Wide         wide;
+    int64_t      offset;
+    bool         done;
+    Color        colors<>;
+};
+
+struct Packed {
+    unsigned int a;
+    unsigned int b;
+    uint64_t     c;
+};
@@ -30,6 +30,9 @@ main(
 
     assert(rc == 8);
 
+    /* XDR carries the IEEE 754 bits in big-endian order */
+    assert(memcmp(xdr_iovec_data(&iov_out), "\x40\x45\x59\x99\x99\x99\x99\x9a", 8) == 0);
+
     rc = unmarshall_MyMsg(&msg2, &iov_out, one, NULL, dbuf);
 
     assert(rc == 8);
@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <unistd.h>
+
+#define XDR_SOCKET_WRITER
+#include "fileseg_xdr.h"
+
+#define FILE_SIZE   (128 * 1024)
+#define SEG_OFFSET  1000
+#define SEG_LENGTH  50001
+#define HEAD_LENGTH 10
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct ReadRes    res;
+    xdr_file_segment  seg;
+    xdr_socket_writer writer;
+    xdr_iovec         iov_in, iov_out[8], iov_data[2];
+    char              path[] = "/tmp/xdrzcc_filesegXXXXXX";
+    uint8_t          *pattern, *expect, *out, scratch[256];
+    int               fd, sv[2], i, len, got, niov_out, nfile;
+    ssize_t           rc;
+
+    pattern = malloc(FILE_SIZE);
+    expect  = malloc(FILE_SIZE);
+    out     = malloc(FILE_SIZE);
+
+    for (i = 0; i < FILE_SIZE; ++i) {
+        pattern[i] = i * 13;
+    }
+
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    assert(write(fd, pattern, FILE_SIZE) == FILE_SIZE);
+
+    res.status  = 0;
+    res.eof     = 1;
+    res.trailer = 0xabcd;
+
+    /* Reference encoding with the payload in memory */
+    xdr_iovec_set_data(&iov_data[0], pattern + SEG_OFFSET - HEAD_LENGTH);
+    xdr_iovec_set_len(&iov_data[0], HEAD_LENGTH + SEG_LENGTH);
+    xdr_set_ref(&res, data, iov_data, 1, HEAD_LENGTH + SEG_LENGTH);
+
+    len = marshall_flat_ReadRes(&res, expect, FILE_SIZE);
+    assert(len == 4 + 4 + 4 + HEAD_LENGTH + SEG_LENGTH + 1 + 4);
+
+    /* Same payload as a memory head followed by a file range */
+    seg.fd     = fd;
+    seg.offset = SEG_OFFSET;
+
+    xdr_iovec_set_data(&iov_data[0], pattern + SEG_OFFSET - HEAD_LENGTH);
+    xdr_iovec_set_len(&iov_data[0], HEAD_LENGTH);
+    xdr_iovec_set_file(&iov_data[1], &seg, SEG_LENGTH);
+    xdr_set_ref(&res, data, iov_data, 2, HEAD_LENGTH + SEG_LENGTH);
+
+    rc = marshall_flat_ReadRes(&res, out, FILE_SIZE);
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    xdr_iovec_set_data(&iov_in, scratch);
+    xdr_iovec_set_len(&iov_in, sizeof(scratch));
+    niov_out = 8;
+
+    rc = marshall_ReadRes(&res, &iov_in, iov_out, &niov_out, NULL, 0);
+    assert(rc == len);
+
+    for (i = 0, nfile = 0; i < niov_out; ++i) {
+        if (xdr_iovec_is_file(&iov_out[i])) {
+            assert(xdr_iovec_data(&iov_out[i]) == &seg);
+            assert(xdr_iovec_len(&iov_out[i]) == SEG_LENGTH);
+            nfile++;
+        }
+    }
+
+    assert(nfile == 1);
+
+    /* The writer sends the file range with sendfile between scratch */
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    assert(xdr_socket_writer_init(&writer, sv[0], 0, 16, NULL, NULL) == 0);
+
+    assert(xdr_socket_writev(&writer, iov_out, niov_out) == len);
+    assert(xdr_socket_writer_drain(&writer) == 0);
+
+    for (got = 0; got < len; got += rc) {
+        rc = read(sv[1], out + got, len - got);
+        assert(rc > 0);
+    }
+
+    assert(memcmp(out, expect, len) == 0);
+
+    /* A segment reaching past end of file cannot be flattened */
+    seg.offset = FILE_SIZE - 10;
+
+    rc = marshall_flat_ReadRes(&res, out, FILE_SIZE);
+    assert(rc == -1);
+
+    xdr_socket_writer_destroy(&writer);
+    close(sv[0]);
+    close(sv[1]);
+    close(fd);
+    free(pattern);
+    free(expect);
+    free(out);
+
+    return 0;
+} /* main */
@@ -0,0 +1,6 @@
+struct ReadRes {
+    unsigned int status;
+    bool         eof;
+    zcopaque     data<>;
+    unsigned int trailer;
+};
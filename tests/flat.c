@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "flat_xdr.h"
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct MyMsg msg1, msg2;
+    xdr_dbuf    *dbuf;
+    uint8_t      buffer[256], flat[256], expect[256], data[11];
+    xdr_iovec    iov_in, iov_out[4], iov_data[2], iov_flat;
+    uint32_t     words[3] = { 7, 8, 9 };
+    int          i, rc, len, niov_out = 4;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    for (i = 0; i < 11; ++i) {
+        data[i] = 0xa0 + i;
+    }
+
+    /* Payload split across two iovecs so the flat writer must gather it */
+    xdr_iovec_set_data(&iov_data[0], data);
+    xdr_iovec_set_len(&iov_data[0], 4);
+    xdr_iovec_set_data(&iov_data[1], data + 4);
+    xdr_iovec_set_len(&iov_data[1], 7);
+
+    msg1.value = 42;
+    xdr_set_str_static(&msg1, name, "hello", 5);
+    msg1.cookie.len  = 3;
+    msg1.cookie.data = "abc";
+    msg1.num_words   = 3;
+    msg1.words       = words;
+    msg1.choice.kind  = KIND_VALUE;
+    msg1.choice.value = 0x0102030405060708ULL;
+    xdr_set_ref(&msg1, data, iov_data, 2, 11);
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_MyMsg(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(expect + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    rc = marshall_flat_MyMsg(&msg1, flat, sizeof(flat));
+
+    assert(rc == len);
+    assert(memcmp(flat, expect, len) == 0);
+
+    /* Exact fit succeeds, one byte short reports overflow */
+    assert(marshall_flat_MyMsg(&msg1, flat, len) == len);
+    assert(marshall_flat_MyMsg(&msg1, flat, len - 1) == -1);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_MyMsg(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.value == 42);
+    assert(msg2.name.len == 5 && memcmp(msg2.name.str, "hello", 5) == 0);
+    assert(msg2.cookie.len == 3 && memcmp(msg2.cookie.data, "abc", 3) == 0);
+    assert(msg2.num_words == 3 && msg2.words[2] == 9);
+    assert(msg2.choice.value == 0x0102030405060708ULL);
+    assert(msg2.data.length == 11 && msg2.data.niov == 1);
+    assert(memcmp(xdr_iovec_data(msg2.data.iov), data, 11) == 0);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
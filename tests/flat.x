@@ -0,0 +1,20 @@
+enum Kind {
+    KIND_NONE  = 0,
+    KIND_VALUE = 1
+};
+
+union MyChoice switch (Kind kind) {
+ case KIND_VALUE:
+    uint64_t value;
+ default:
+    void;
+};
+
+struct MyMsg {
+    unsigned int value;
+    string       name<>;
+    opaque       cookie<8>;
+    unsigned int words<>;
+    MyChoice     choice;
+    zcopaque     data<>;
+};
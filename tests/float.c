@@ -30,6 +30,9 @@ main(
 
     assert(rc == 4);
 
+    /* XDR carries the IEEE 754 bits in big-endian order */
+    assert(memcmp(xdr_iovec_data(&iov_out), "\x42\x2a\xcc\xcd", 4) == 0);
+
     rc = unmarshall_MyMsg(&msg2, &iov_out, one, NULL, dbuf);
 
     assert(rc == 4);
@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "floatvec_xdr.h"
+
+#define NSAMPLES 1001
+#define NHISTORY 37
+
+/* Big-endian encoding of the fixed part, as produced by any XDR library */
+static const uint8_t expect_head[] = {
+    0x3f, 0x80, 0x00, 0x00,                         /* scale 1.0f */
+    0x40, 0x09, 0x21, 0xfb, 0x54, 0x44, 0x2d, 0x18, /* offset pi */
+    0x00, 0x00, 0x03, 0xe9,                         /* 1001 samples */
+    0xc0, 0x20, 0x00, 0x00,                         /* samples[0] -2.5f */
+    0x3e, 0x80, 0x00, 0x00,                         /* samples[1] 0.25f */
+};
+
+static const uint8_t expect_tail[] = {
+    0x3f, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* origin[0] 1.0 */
+    0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* origin[1] -2.0 */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* origin[2] 0.0 */
+    0x3f, 0x80, 0x00, 0x00,                         /* grid 1.0f .. 5.0f */
+    0x40, 0x00, 0x00, 0x00,
+    0x40, 0x40, 0x00, 0x00,
+    0x40, 0x80, 0x00, 0x00,
+    0x40, 0xa0, 0x00, 0x00,
+};
+
+static void
+check(const struct Telemetry *a)
+{
+    int i;
+
+    assert(a->scale == 1.0f);
+    assert(a->offset == 3.141592653589793);
+    assert(a->num_samples == NSAMPLES);
+    assert(a->samples[0] == -2.5f && a->samples[1] == 0.25f);
+
+    for (i = 2; i < NSAMPLES; ++i) {
+        assert(a->samples[i] == i * 0.5f - 100.0f);
+    }
+
+    assert(a->num_history == NHISTORY);
+
+    for (i = 0; i < NHISTORY; ++i) {
+        assert(a->history[i] == i * 1e10 + 0.125);
+    }
+
+    assert(a->origin[0] == 1.0 && a->origin[1] == -2.0 && a->origin[2] == 0.0);
+
+    for (i = 0; i < 5; ++i) {
+        assert(a->grid[i] == i + 1.0f);
+    }
+} /* check */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Telemetry    msg1, msg2;
+    xdr_marshall_stream stream;
+    xdr_dbuf           *dbuf;
+    static uint8_t      buffer[16384], flat[16384], streamed[16384];
+    static float        samples[NSAMPLES];
+    static double       history[NHISTORY];
+    xdr_iovec           iov_in, iov_out[4], iov_split[3], window;
+    uint64_t            bits;
+    int                 i, rc, len, pos, niov_out = 4;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    samples[0] = -2.5f;
+    samples[1] = 0.25f;
+
+    for (i = 2; i < NSAMPLES; ++i) {
+        samples[i] = i * 0.5f - 100.0f;
+    }
+
+    for (i = 0; i < NHISTORY; ++i) {
+        history[i] = i * 1e10 + 0.125;
+    }
+
+    msg1.scale       = 1.0f;
+    msg1.offset      = 3.141592653589793;
+    msg1.num_samples = NSAMPLES;
+    msg1.samples     = samples;
+    msg1.num_history = NHISTORY;
+    msg1.history     = history;
+    msg1.origin[0]   = 1.0;
+    msg1.origin[1]   = -2.0;
+    msg1.origin[2]   = 0.0;
+
+    for (i = 0; i < 5; ++i) {
+        msg1.grid[i] = i + 1.0f;
+    }
+
+    len = marshall_flat_Telemetry(&msg1, flat, sizeof(flat));
+
+    assert(len == 4 + 8 + 4 + NSAMPLES * 4 + 4 + NHISTORY * 8 + 24 + 20);
+    assert(memcmp(flat, expect_head, sizeof(expect_head)) == 0);
+    assert(memcmp(flat + len - sizeof(expect_tail), expect_tail,
+                  sizeof(expect_tail)) == 0);
+
+    /* Every sample matches the scalar conversion of its value */
+    for (i = 0; i < NHISTORY; ++i) {
+        memcpy(&bits, flat + 16 + NSAMPLES * 4 + 4 + i * 8, 8);
+        bits = be64toh(bits);
+        assert(memcmp(&bits, &history[i], 8) == 0);
+    }
+
+    /* iovec and resumable encoders agree with the flat one */
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_Telemetry(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc == len && niov_out == 1);
+    assert(memcmp(xdr_iovec_data(&iov_out[0]), flat, len) == 0);
+
+    xdr_marshall_stream_init(&stream);
+
+    for (pos = 0; !xdr_marshall_stream_done(&stream);) {
+        xdr_iovec_set_data(&window, buffer);
+        xdr_iovec_set_len(&window, 100);
+        niov_out = 4;
+
+        rc = marshall_stream_Telemetry(&msg1, &stream, &window, iov_out, &niov_out, 0);
+
+        assert(rc >= 0);
+
+        for (i = 0; i < niov_out; ++i) {
+            memcpy(streamed + pos, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+            pos += xdr_iovec_len(&iov_out[i]);
+        }
+    }
+
+    assert(pos == len);
+    assert(memcmp(streamed, flat, len) == 0);
+
+    /* Contiguous input is swapped straight out of the buffer */
+    xdr_iovec_set_data(&iov_in, flat);
+    xdr_iovec_set_len(&iov_in, len);
+
+    rc = unmarshall_Telemetry(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == len);
+    check(&msg2);
+
+    /* Split mid-element, so arrays are gathered before swapping */
+    xdr_iovec_set_data(&iov_split[0], flat);
+    xdr_iovec_set_len(&iov_split[0], 23);
+    xdr_iovec_set_data(&iov_split[1], flat + 23);
+    xdr_iovec_set_len(&iov_split[1], len - 23 - 30);
+    xdr_iovec_set_data(&iov_split[2], flat + len - 30);
+    xdr_iovec_set_len(&iov_split[2], 30);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_Telemetry(&msg2, iov_split, 3, NULL, dbuf);
+
+    assert(rc == len);
+    check(&msg2);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,8 @@
+struct Telemetry {
+    float        scale;
+    double       offset;
+    float        samples<>;
+    double       history<>;
+    double       origin[3];
+    float        grid[5];
+};
@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "inline_xdr.h"
+
+static int
+roundtrip(
+    struct Request *in,
+    struct Request *out,
+    xdr_dbuf       *dbuf)
+{
+    uint8_t   flat[256];
+    xdr_iovec iov_flat;
+    int       len, rc;
+
+    len = marshall_flat_Request(in, flat, sizeof(flat));
+
+    assert(len > 0);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Request(out, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+
+    /* Nothing decoded may refer to the wire buffer */
+    memset(flat, 0xee, sizeof(flat));
+
+    return rc;
+} /* roundtrip */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Request msg1, msg2;
+    xdr_dbuf      *dbuf;
+    uint32_t       words[5] = { 1, 2, 3, 4, 5 };
+    uint8_t        handle[16], data[20];
+    int            i;
+
+    for (i = 0; i < 20; ++i) {
+        data[i] = 0x40 + i;
+    }
+
+    for (i = 0; i < 16; ++i) {
+        handle[i] = 0x80 + i;
+    }
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    /* Everything fits inside the struct, so the dbuf is untouched */
+    msg1.num_mask    = 2;
+    msg1.mask        = words;
+    msg1.handle.len  = 16;
+    msg1.handle.data = handle;
+    msg1.data.len    = 8;
+    msg1.data.data   = data;
+
+    roundtrip(&msg1, &msg2, dbuf);
+
+    assert(dbuf->used == 0);
+    assert(msg2.mask == msg2.mask_inline);
+    assert(msg2.num_mask == 2 && msg2.mask[1] == 2);
+    assert(msg2.handle.data == msg2.handle_inline);
+    assert(msg2.handle.len == 16 && memcmp(msg2.handle.data, handle, 16) == 0);
+    assert(msg2.data.data == msg2.data_inline);
+    assert(msg2.data.len == 8 && memcmp(msg2.data.data, data, 8) == 0);
+
+    /* Values over capacity spill to the dbuf */
+    msg1.num_mask = 5;
+    msg1.data.len = 20;
+
+    roundtrip(&msg1, &msg2, dbuf);
+
+    assert(dbuf->used > 0);
+    assert(msg2.mask != msg2.mask_inline);
+    assert(msg2.num_mask == 5 && msg2.mask[4] == 5);
+    assert(msg2.handle.data == msg2.handle_inline);
+    assert(memcmp(msg2.handle.data, handle, 16) == 0);
+    assert(msg2.data.data != msg2.data_inline);
+    assert(msg2.data.len == 20 && memcmp(msg2.data.data, data, 20) == 0);
+
+    /* Empty values */
+    msg1.num_mask   = 0;
+    msg1.handle.len = 0;
+    msg1.data.len   = 0;
+
+    roundtrip(&msg1, &msg2, dbuf);
+
+    assert(msg2.num_mask == 0 && msg2.handle.len == 0 && msg2.data.len == 0);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
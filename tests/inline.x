@@ -0,0 +1,12 @@
+
+const FHSIZE = 16;
+
+typedef uint32_t bitmap4<>;
+typedef opaque   fh<FHSIZE>;
+typedef opaque   blob<>;
+
+struct Request {
+    bitmap4 mask;
+    fh      handle;
+    blob    data;
+};
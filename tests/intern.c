@@ -0,0 +1,169 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "intern_xdr.h"
+
+struct table {
+    int  calls;
+    int  fail;
+    char owner[16];
+};
+
+/* Owners are replaced by the table's copy, names are kept as decoded */
+static const void *
+intern(
+    const char *type,
+    const void *data,
+    uint32_t    len,
+    uint64_t    hash,
+    void       *private_data)
+{
+    struct table *table = private_data;
+
+    assert(hash == xdr_hash64(data, len));
+
+    table->calls++;
+
+    if (table->fail) {
+        return NULL;
+    }
+
+    if (strcmp(type, "fattr4_owner") == 0) {
+        assert(len <= sizeof(table->owner));
+        memcpy(table->owner, data, len);
+        return table->owner;
+    }
+
+    assert(strcmp(type, "component4") == 0);
+
+    return data;
+} /* intern */
+
+static int
+encode(
+    const struct LookupArgs *args,
+    uint8_t                 *out)
+{
+    uint8_t   buffer[256];
+    xdr_iovec iov_in, iov_out[4];
+    int       i, rc, len, niov_out = 4;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_LookupArgs(args, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    return len;
+} /* encode */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct LookupArgs args1, args2;
+    struct table      table = { 0 };
+    xdr_intern        interning;
+    xdr_dbuf         *dbuf;
+    xdr_iovec         iov[2];
+    uint8_t           msg[256];
+    int               rc, len;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    args1.dir = 7;
+    xdr_set_str_static(&args1, name, "somefile.txt", 12);
+    args1.owner.data   = "alice@example";
+    args1.owner.len    = 13;
+    args1.comment.data = "hi";
+    args1.comment.len  = 2;
+
+    len = encode(&args1, msg);
+
+    /* Hashes are computed whether or not an intern table is attached */
+    xdr_iovec_set_data(&iov[0], msg);
+    xdr_iovec_set_len(&iov[0], len);
+
+    rc = unmarshall_LookupArgs(&args2, iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(args2.name_hash == xdr_hash64("somefile.txt", 12));
+    assert(args2.owner_hash == xdr_hash64("alice@example", 13));
+    assert(args2.name_hash != args2.owner_hash);
+    assert(args2.comment.len == 2 && memcmp(args2.comment.data, "hi", 2) == 0);
+
+    /* A name split across iovecs hashes the same */
+    xdr_iovec_set_data(&iov[0], msg);
+    xdr_iovec_set_len(&iov[0], 10);
+    xdr_iovec_set_data(&iov[1], msg + 10);
+    xdr_iovec_set_len(&iov[1], len - 10);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_LookupArgs(&args2, iov, 2, NULL, dbuf);
+
+    assert(rc == len);
+    assert(args2.name_hash == xdr_hash64("somefile.txt", 12));
+    assert(args2.name.len == 12 && memcmp(args2.name.str, "somefile.txt", 12) == 0);
+
+    /* Interned values reference the table */
+    interning.intern       = intern;
+    interning.private_data = &table;
+
+    xdr_dbuf_set_intern(dbuf, &interning);
+    xdr_dbuf_reset(dbuf);
+
+    xdr_iovec_set_data(&iov[0], msg);
+    xdr_iovec_set_len(&iov[0], len);
+
+    rc = unmarshall_LookupArgs(&args2, iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(table.calls == 2);
+    assert(args2.owner.data == table.owner);
+    assert(memcmp(args2.owner.data, "alice@example", 13) == 0);
+    assert((uint8_t *) args2.name.str > msg && (uint8_t *) args2.name.str < msg + len);
+
+    /* A failed intern fails the unmarshall */
+    table.fail = 1;
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_LookupArgs(&args2, iov, 1, NULL, dbuf);
+
+    assert(rc < 0);
+
+    /* Empty values hash too */
+    table.fail = 0;
+    args1.name.len  = 0;
+    args1.owner.len = 0;
+
+    len = encode(&args1, msg);
+
+    xdr_iovec_set_len(&iov[0], len);
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_LookupArgs(&args2, iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(args2.name_hash == xdr_hash64("", 0));
+    assert(args2.owner_hash == args2.name_hash);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
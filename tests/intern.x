@@ -0,0 +1,11 @@
+typedef string     component4<>;
+typedef opaque     utf8string<>;
+typedef utf8string utf8str_mixed;
+typedef utf8str_mixed fattr4_owner;
+
+struct LookupArgs {
+    unsigned int  dir;
+    component4    name;
+    fattr4_owner  owner;
+    utf8str_mixed comment;
+};
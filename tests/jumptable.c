@@ -0,0 +1,213 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "jumptable_xdr.h"
+
+#define NUM_ARGS 17
+
+static void
+set_name(
+    xdr_string *str,
+    char       *value)
+{
+    str->str = value;
+    str->len = strlen(value);
+} /* set_name */
+
+static int
+same_name(
+    const xdr_string *a,
+    const xdr_string *b)
+{
+    return a->len == b->len && memcmp(a->str, b->str, a->len) == 0;
+} /* same_name */
+
+static void
+check_arg(
+    const struct Arg *a,
+    const struct Arg *b)
+{
+    assert(a->op == b->op);
+
+    switch (a->op) {
+        case OP_READ:
+            assert(a->read.offset == b->read.offset);
+            assert(a->read.count == b->read.count);
+            break;
+        case OP_WRITE:
+            assert(a->data.len == b->data.len);
+            assert(memcmp(a->data.data, b->data.data, a->data.len) == 0);
+            break;
+        case OP_LOOKUP:
+        case OP_GETATTR:
+            assert(same_name(&a->name, &b->name));
+            break;
+        case OP_SETATTR:
+            assert(a->size == b->size);
+            break;
+        case OP_REMOVE:
+            assert(same_name(&a->target, &b->target));
+            break;
+        case OP_RENAME:
+            assert(same_name(&a->rename.from, &b->rename.from));
+            assert(same_name(&a->rename.to, &b->rename.to));
+            break;
+        case OP_PING:
+            assert(a->seq == b->seq);
+            break;
+        case OP_PONG:
+            assert(a->ack == b->ack);
+            break;
+        case OP_EXTENDED:
+            assert(a->ext == b->ext);
+            break;
+        case OP_NULL:
+        case OP_LINK:
+        case OP_ILLEGAL:
+            break;
+        default:
+            assert(a->unknown == b->unknown);
+    } /* switch */
+} /* check_arg */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Compound msg1, msg2;
+    struct Arg      args[NUM_ARGS];
+    xdr_dbuf       *dbuf;
+    uint8_t         buffer[4096], flat[4096], expect[4096];
+    xdr_iovec       iov_in, iov_out[8], iov_flat;
+    int             i, rc, len, niov_out = 8;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    memset(args, 0, sizeof(args));
+
+    args[0].op = OP_NULL;
+
+    args[1].op          = OP_READ;
+    args[1].read.offset = 0x0102030405060708ULL;
+    args[1].read.count  = 4096;
+
+    args[2].op        = OP_WRITE;
+    args[2].data.len  = 5;
+    args[2].data.data = "abcde";
+
+    /* OP_LOOKUP has no body of its own and shares the OP_GETATTR arm */
+    args[3].op = OP_LOOKUP;
+    set_name(&args[3].name, "lookup");
+
+    args[4].op = OP_GETATTR;
+    set_name(&args[4].name, "attr");
+
+    args[5].op   = OP_SETATTR;
+    args[5].size = 1ULL << 40;
+
+    args[6].op = OP_REMOVE;
+    set_name(&args[6].target, "victim");
+
+    args[7].op = OP_RENAME;
+    set_name(&args[7].rename.from, "old");
+    set_name(&args[7].rename.to, "new");
+
+    args[8].op = OP_LINK;
+
+    args[9].op  = OP_PING;
+    args[9].seq = 11;
+
+    args[10].op  = OP_PONG;
+    args[10].ack = 12;
+
+    /* Label from a const rather than an enum entry */
+    args[11].op  = OP_EXTENDED;
+    args[11].ext = 13;
+
+    /* Outside the table */
+    args[12].op = OP_ILLEGAL;
+
+    /* The hole at 9 inside the table runs the default arm */
+    args[13].op      = 9;
+    args[13].unknown = 0x99;
+
+    /* Below and above the table */
+    args[14].op      = 0;
+    args[14].unknown = 0x100;
+
+    args[15].op      = 14;
+    args[15].unknown = 0x140;
+
+    args[16].op      = 0x7fffffff;
+    args[16].unknown = 0x7fff;
+
+    msg1.num_args    = NUM_ARGS;
+    msg1.args        = args;
+    msg1.small.op    = OP_NULL;
+    msg1.small.value = 77;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_Compound(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(expect + len, xdr_iovec_data(&iov_out[i]),
+               xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+    assert(marshall_length_Compound(&msg1) == len);
+
+    rc = marshall_flat_Compound(&msg1, flat, sizeof(flat));
+
+    assert(rc == len);
+    assert(memcmp(flat, expect, len) == 0);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Compound(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.num_args == NUM_ARGS);
+
+    for (i = 0; i < NUM_ARGS; ++i) {
+        assert(marshall_length_Arg(&msg2.args[i]) ==
+               marshall_length_Arg(&args[i]));
+        check_arg(&args[i], &msg2.args[i]);
+    }
+
+    assert(msg2.small.op == OP_NULL && msg2.small.value == 77);
+
+    /* Fall-through and default arms of a union too small for a table */
+    msg1.num_args    = 0;
+    msg1.small.op    = OP_WRITE;
+    msg1.small.other = 0x1122334455667788ULL;
+
+    len = marshall_flat_Compound(&msg1, flat, sizeof(flat));
+
+    assert(len == 4 + 4 + 8);
+    assert(marshall_length_Compound(&msg1) == len);
+
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Compound(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.small.op == OP_WRITE);
+    assert(msg2.small.other == 0x1122334455667788ULL);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,73 @@
+
+const OP_EXTENDED = 13;
+
+enum Op {
+    OP_NULL    = 1,
+    OP_READ    = 2,
+    OP_WRITE   = 3,
+    OP_LOOKUP  = 4,
+    OP_GETATTR = 5,
+    OP_SETATTR = 6,
+    OP_REMOVE  = 7,
+    OP_RENAME  = 8,
+    OP_LINK    = 10,
+    OP_PING    = 11,
+    OP_PONG    = 12,
+    OP_ILLEGAL = 10044
+};
+
+typedef opaque Data<>;
+typedef string Name<>;
+
+struct ReadArgs {
+    uint64_t     offset;
+    unsigned int count;
+};
+
+struct RenameArgs {
+    Name from;
+    Name to;
+};
+
+union Arg switch (Op op) {
+ case OP_NULL:
+    void;
+ case OP_READ:
+    ReadArgs read;
+ case OP_WRITE:
+    Data data;
+ case OP_LOOKUP:
+ case OP_GETATTR:
+    Name name;
+ case OP_SETATTR:
+    uint64_t size;
+ case OP_REMOVE:
+    Name target;
+ case OP_RENAME:
+    RenameArgs rename;
+ case OP_LINK:
+    void;
+ case OP_PING:
+    unsigned int seq;
+ case OP_PONG:
+    unsigned int ack;
+ case OP_EXTENDED:
+    unsigned int ext;
+ case OP_ILLEGAL:
+    void;
+ default:
+    unsigned int unknown;
+};
+
+union Small switch (Op op) {
+ case OP_NULL:
+ case OP_READ:
+    unsigned int value;
+ default:
+    uint64_t other;
+};
+
+struct Compound {
+    Arg   args<>;
+    Small small;
+};
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "layout_xdr.h"
+
+#define PAGE 4096
+
+static int
+flatten(
+    const xdr_iovec *iov,
+    int              niov,
+    uint8_t         *out)
+{
+    int i, len = 0;
+
+    for (i = 0; i < niov; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov[i]), xdr_iovec_len(&iov[i]));
+        len += xdr_iovec_len(&iov[i]);
+    }
+
+    return len;
+} /* flatten */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct WriteReq     msg;
+    xdr_marshall_layout layout;
+    static uint8_t      scratch[4 * PAGE] __attribute__((aligned(PAGE)));
+    static uint8_t      name[5000], data[3000], expect[16384], wire[16384];
+    xdr_iovec           iov_in, iov_out[16], iov_data;
+    int                 i, rc, len, niov_out;
+
+    for (i = 0; i < 5000; ++i) {
+        name[i] = i * 7;
+    }
+
+    for (i = 0; i < 3000; ++i) {
+        data[i] = i * 13;
+    }
+
+    xdr_iovec_set_data(&iov_data, data);
+    xdr_iovec_set_len(&iov_data, 3000);
+
+    msg.xid       = 77;
+    msg.name.len  = 5000;
+    msg.name.data = name;
+    xdr_set_ref(&msg, data, &iov_data, 1, 3000);
+    msg.trailer = 99;
+
+    /* Reference encoding, leaving room for a 4 byte record mark */
+    xdr_iovec_set_data(&iov_in, scratch);
+    xdr_iovec_set_len(&iov_in, sizeof(scratch));
+    niov_out = 16;
+
+    rc = marshall_WriteReq(&msg, &iov_in, iov_out, &niov_out, NULL, 4);
+
+    assert(rc > 0);
+    len = flatten(iov_out, niov_out, expect);
+    assert(len == rc);
+
+    /* Page alignment policy */
+    xdr_iovec_set_data(&iov_in, scratch + 8);
+    xdr_iovec_set_len(&iov_in, sizeof(scratch) - 8);
+    niov_out = 16;
+    xdr_marshall_layout_init(&layout, PAGE);
+
+    rc = marshall_aligned_WriteReq(&msg, &iov_in, iov_out, &niov_out, 4, &layout);
+
+    assert(rc == len);
+    assert(flatten(iov_out, niov_out, wire) == len);
+    assert(memcmp(wire + 4, expect + 4, len - 4) == 0);
+
+    assert(layout.npayload == 2);
+
+    /* Copied opaque sits alone on its own page */
+    assert(layout.payload[0].offset == 12);
+    assert(layout.payload[0].length == 5000);
+    assert(xdr_iovec_len(&iov_out[layout.payload[0].iov]) == 5000);
+    assert(((uintptr_t) xdr_iovec_data(&iov_out[layout.payload[0].iov]) & (PAGE - 1)) == 0);
+    assert(((uintptr_t) xdr_iovec_data(&iov_out[layout.payload[0].iov + 1]) & (PAGE - 1)) == 0);
+    assert(memcmp(wire + layout.payload[0].offset, name, 5000) == 0);
+
+    /* Zero-copy payload is referenced where the transport will find it */
+    assert(layout.payload[1].offset == 12 + 5000 + 4);
+    assert(layout.payload[1].length == 3000);
+    assert(xdr_iovec_data(&iov_out[layout.payload[1].iov]) == data);
+    assert(memcmp(wire + layout.payload[1].offset, data, 3000) == 0);
+
+    /* Without an alignment only zero-copy payloads are reported */
+    xdr_iovec_set_data(&iov_in, scratch);
+    xdr_iovec_set_len(&iov_in, sizeof(scratch));
+    niov_out = 16;
+    xdr_marshall_layout_init(&layout, 0);
+
+    rc = marshall_aligned_WriteReq(&msg, &iov_in, iov_out, &niov_out, 0, &layout);
+
+    assert(rc == len - 4);
+    assert(layout.npayload == 1);
+    assert(layout.payload[0].offset == 8 + 5000 + 4);
+    assert(xdr_iovec_data(&iov_out[layout.payload[0].iov]) == data);
+
+    return 0;
+} /* main */
@@ -0,0 +1,6 @@
+struct WriteReq {
+    unsigned int xid;
+    opaque       name<>;
+    zcopaque     data<>;
+    unsigned int trailer;
+};
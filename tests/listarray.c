@@ -0,0 +1,134 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "listarray_xdr.h"
+
+#define NUM_ENTRIES 40
+
+static int
+encode(
+    const struct DirList *list,
+    uint8_t              *out)
+{
+    static uint8_t buffer[8192];
+    xdr_iovec      iov_in, iov_out[4];
+    int            i, rc, len, niov_out = 4;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_DirList(list, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    return len;
+} /* encode */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct DirList list1, list2;
+    struct Entry   entries[NUM_ENTRIES], *entry;
+    char           names[NUM_ENTRIES][32];
+    xdr_dbuf      *dbuf;
+    xdr_iovec      iov;
+    uint8_t        expect[8192], out[8192];
+    int            i, len, rc;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    /* Reference encoding from a conventional linked list */
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        entries[i].cookie = i + 3;
+        xdr_set_str_static(&entries[i], name, names[i],
+                           snprintf(names[i], sizeof(names[i]), "file%d", i));
+        entries[i].nextentry = i + 1 < NUM_ENTRIES ? &entries[i + 1] : NULL;
+    }
+
+    list1.entries     = entries;
+    list1.num_entries = 0;
+    list1.eof         = 1;
+
+    len = encode(&list1, expect);
+
+    assert(len == marshall_length_DirList(&list1));
+
+    /* Decoding yields one contiguous array, still linked as a list */
+    xdr_iovec_set_data(&iov, expect);
+    xdr_iovec_set_len(&iov, len);
+
+    rc = unmarshall_DirList(&list2, &iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(list2.num_entries == NUM_ENTRIES);
+    assert(list2.eof == 1);
+
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        assert(list2.entries[i].cookie == (uint64_t) i + 3);
+        assert(list2.entries[i].name.len == strlen(names[i]));
+        assert(memcmp(list2.entries[i].name.str, names[i], strlen(names[i])) == 0);
+    }
+
+    for (i = 0, entry = list2.entries; entry; entry = entry->nextentry) {
+        assert(entry == &list2.entries[i]);
+        ++i;
+    }
+
+    assert(i == NUM_ENTRIES);
+
+    /* Arrays encode without their next pointers being consulted */
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        entries[i].nextentry = NULL;
+    }
+
+    list1.num_entries = NUM_ENTRIES;
+
+    assert(marshall_length_DirList(&list1) == len);
+
+    rc = encode(&list1, out);
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    rc = marshall_flat_DirList(&list1, out, sizeof(out));
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    /* An empty list decodes to an empty array */
+    list1.entries     = NULL;
+    list1.num_entries = 0;
+    list1.eof         = 0;
+
+    len = encode(&list1, expect);
+
+    assert(len == 8);
+
+    xdr_iovec_set_data(&iov, expect);
+    xdr_iovec_set_len(&iov, len);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_DirList(&list2, &iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(list2.num_entries == 0 && list2.entries == NULL);
+    assert(list2.eof == 0);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
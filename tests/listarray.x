@@ -0,0 +1,12 @@
+typedef string filename<>;
+
+struct Entry {
+    uint64_t cookie;
+    filename name;
+    Entry   *nextentry;
+};
+
+struct DirList {
+    Entry *entries;
+    bool   eof;
+};
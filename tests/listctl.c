@@ -0,0 +1,249 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "listctl_xdr.h"
+
+#define NUM_ENTRIES 50
+
+struct entry_iter {
+    int          index;
+    char         name[32];
+    struct Entry entry;
+};
+
+struct count_iter {
+    uint32_t index;
+    uint32_t value;
+};
+
+/* Produces entries one at a time in a single reused struct */
+static const void *
+next_entry(void *arg)
+{
+    struct entry_iter *iter = arg;
+    int                len;
+
+    if (iter->index == NUM_ENTRIES) {
+        return NULL;
+    }
+
+    len = snprintf(iter->name, sizeof(iter->name), "file%d", iter->index);
+
+    iter->entry.cookie = iter->index + 3;
+    xdr_set_str_static(&iter->entry, name, iter->name, len);
+    iter->entry.nextentry = NULL;
+
+    iter->index++;
+
+    return &iter->entry;
+} /* next_entry */
+
+static const void *
+next_count(void *arg)
+{
+    struct count_iter *iter = arg;
+
+    if (iter->index == 5) {
+        return NULL;
+    }
+
+    iter->value = iter->index++ * 10;
+
+    return &iter->value;
+} /* next_count */
+
+static int
+encode(
+    const struct DirList *list,
+    uint8_t              *out)
+{
+    static uint8_t buffer[8192];
+    xdr_iovec      iov_in, iov_out[4];
+    int            i, rc, len, niov_out = 4;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_DirList(list, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    return len;
+} /* encode */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct DirList    list1, list2;
+    struct Entry      entries[NUM_ENTRIES], *entry;
+    char              names[NUM_ENTRIES][32];
+    uint32_t          counts[5];
+    struct entry_iter eiter = { 0 };
+    struct count_iter citer = { 0 };
+    xdr_marshall_list ectl, cctl;
+    xdr_dbuf         *dbuf;
+    xdr_iovec         iov, iov_out[1];
+    uint8_t           expect[8192], out[8192];
+    int               i, len, rc, niov;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    /* Materialised reference encoding */
+    for (i = 0; i < NUM_ENTRIES; ++i) {
+        entries[i].cookie = i + 3;
+        xdr_set_str_static(&entries[i], name, names[i],
+                           snprintf(names[i], sizeof(names[i]), "file%d", i));
+        entries[i].nextentry = i + 1 < NUM_ENTRIES ? &entries[i + 1] : NULL;
+    }
+
+    for (i = 0; i < 5; ++i) {
+        counts[i] = i * 10;
+    }
+
+    list1.entries    = entries;
+    list1.num_counts = 5;
+    list1.counts     = counts;
+    list1.eof        = 1;
+    list1.entries_ctl = NULL;
+    list1.counts_ctl  = NULL;
+
+    len = encode(&list1, expect);
+
+    /* Attached controls without iterators read the members themselves */
+    xdr_marshall_list_init(&ectl, NULL, NULL);
+    xdr_marshall_list_init(&cctl, NULL, NULL);
+
+    list1.entries_ctl = &ectl;
+    list1.counts_ctl  = &cctl;
+
+    rc = encode(&list1, out);
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+    assert(ectl.count == NUM_ENTRIES && cctl.count == 5);
+
+    /* Iterators produce the same bytes with nothing materialised */
+    xdr_marshall_list_init(&ectl, next_entry, &eiter);
+    xdr_marshall_list_init(&cctl, next_count, &citer);
+
+    list2.entries     = NULL;
+    list2.num_counts  = 0;
+    list2.counts      = NULL;
+    list2.eof         = 1;
+    list2.entries_ctl = &ectl;
+    list2.counts_ctl  = &cctl;
+
+    rc = encode(&list2, out);
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+    assert(ectl.count == NUM_ENTRIES && cctl.count == 5);
+
+    eiter.index = 0;
+    citer.index = 0;
+
+    rc = marshall_flat_DirList(&list2, out, sizeof(out));
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    xdr_iovec_set_data(&iov, out);
+    xdr_iovec_set_len(&iov, len);
+
+    rc = unmarshall_DirList(&list1, &iov, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(list1.entries_ctl == NULL && list1.counts_ctl == NULL);
+    assert(list1.num_counts == 5 && list1.counts[4] == 40);
+    assert(list1.entries->nextentry->cookie == 4);
+
+    /* Each entry is 24 bytes with its marker, plus 4 for the terminator */
+    eiter.index = 0;
+    citer.index = 0;
+
+    xdr_marshall_list_init(&ectl, next_entry, &eiter);
+    xdr_marshall_list_init(&cctl, next_count, &citer);
+
+    ectl.budget = 10 * 24 + 4 + 23;
+    cctl.budget = 4 + 2 * 4;
+
+    rc = encode(&list2, out);
+
+    assert(ectl.count == 10 && ectl.truncated);
+    assert(cctl.count == 2 && cctl.truncated);
+    assert(eiter.index == 11);
+    assert(rc == 10 * 24 + 4 + 12 + 4);
+
+    xdr_iovec_set_data(&iov, out);
+    xdr_iovec_set_len(&iov, rc);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_DirList(&list1, &iov, 1, NULL, dbuf);
+
+    assert(rc == 10 * 24 + 4 + 12 + 4);
+    assert(list1.num_counts == 2 && list1.counts[1] == 10);
+    assert(list1.eof == 1);
+
+    for (i = 0, entry = list1.entries; entry; entry = entry->nextentry) {
+        ++i;
+    }
+
+    assert(i == 10);
+
+    /* Budgets apply to materialised lists too, and to flat output */
+    xdr_marshall_list_init(&ectl, NULL, NULL);
+    xdr_marshall_list_init(&cctl, NULL, NULL);
+
+    ectl.budget = 3;
+    cctl.budget = NUM_ENTRIES * 24 + 4;
+
+    list2.entries     = entries;
+    list2.num_counts  = 5;
+    list2.counts      = counts;
+
+    rc = marshall_flat_DirList(&list2, out, sizeof(out));
+
+    assert(ectl.count == 0 && ectl.truncated);
+    assert(cctl.count == 5 && !cctl.truncated);
+    assert(rc == 4 + 4 + 5 * 4 + 4);
+
+    ectl.budget = NUM_ENTRIES * 24 + 4;
+
+    rc = marshall_flat_DirList(&list2, out, sizeof(out));
+
+    assert(ectl.count == NUM_ENTRIES && !ectl.truncated);
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    /* Scratch sized to the budget holds the list without overflowing */
+    ectl.budget = 3 * 24 + 4;
+
+    list2.num_counts = 0;
+    list2.counts_ctl = NULL;
+
+    xdr_iovec_set_data(&iov, out);
+    xdr_iovec_set_len(&iov, ectl.budget + 8);
+
+    niov = 1;
+
+    rc = marshall_DirList(&list2, &iov, iov_out, &niov, NULL, 0);
+
+    assert(ectl.count == 3 && ectl.truncated);
+    assert(rc == 3 * 24 + 4 + 8);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,11 @@
+struct Entry {
+    uint64_t cookie;
+    string   name<>;
+    Entry   *nextentry;
+};
+
+struct DirList {
+    Entry       *entries;
+    unsigned int counts<>;
+    bool         eof;
+};
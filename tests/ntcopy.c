@@ -0,0 +1,178 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+/*
+ * Checks payload copies on either side of the non-temporal threshold.  Run
+ * as "ntcopy bench [bytes]" to time dbuf spills of a payload against a
+ * cache resident working set, e.g. with the generated code built once
+ * with the default XDR_NT_COPY_MIN and once with a much larger one.
+ */
+
+#include <assert.h>
+#include <time.h>
+
+#include "ntcopy_xdr.h"
+
+#define MAX_PAYLOAD (1024 * 1024 + 64)
+#define HOT_SIZE    (256 * 1024)
+#define PIECE       (64 * 1024 + 7)
+#define MAX_PIECES  (MAX_PAYLOAD / PIECE + 2)
+
+static uint8_t payload[MAX_PAYLOAD], scratch[MAX_PAYLOAD + 4096];
+static uint8_t flat[MAX_PAYLOAD + 4096];
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* now */
+
+/* Encode and decode one payload, splitting the input so it spills */
+static int
+roundtrip(
+    int       size,
+    int       skew,
+    xdr_dbuf *dbuf)
+{
+    struct Blob msg1, msg2;
+    xdr_iovec   iov_in, iov_out[8], iov_split[2], iov_pieces[MAX_PIECES];
+    int         rc, len, niov_out = 8, npieces, off;
+
+    msg1.id        = size;
+    msg1.data.len  = size;
+    msg1.data.data = payload + skew;
+    xdr_set_str_static(&msg1, name, payload + skew, size < 100 ? size : 100);
+
+    xdr_iovec_set_data(&iov_in, scratch + skew);
+    xdr_iovec_set_len(&iov_in, sizeof(scratch) - skew);
+
+    rc = marshall_Blob(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    /* Copied payloads all land in the one scratch iovec */
+    assert(niov_out == 1);
+    len = xdr_iovec_len(&iov_out[0]);
+    assert(len == rc);
+
+    len = marshall_flat_Blob(&msg1, flat + skew, sizeof(flat) - skew);
+
+    assert(len == rc);
+    assert(memcmp(flat + skew, xdr_iovec_data(&iov_out[0]), len) == 0);
+
+    xdr_iovec_set_data(&iov_split[0], flat + skew);
+    xdr_iovec_set_len(&iov_split[0], 9);
+    xdr_iovec_set_data(&iov_split[1], flat + skew + 9);
+    xdr_iovec_set_len(&iov_split[1], len - 9);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_Blob(&msg2, iov_split, 2, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.id == size);
+    assert(msg2.data.len == size);
+    assert(memcmp(msg2.data.data, payload + skew, size) == 0);
+    assert(msg2.name.len == msg1.name.len);
+    assert(memcmp(msg2.name.str, payload + skew, msg2.name.len) == 0);
+
+    /* A large payload gathered from pieces below the threshold */
+    for (npieces = 0, off = 0; off < len; ++npieces, off += PIECE) {
+        xdr_iovec_set_data(&iov_pieces[npieces], flat + skew + off);
+        xdr_iovec_set_len(&iov_pieces[npieces], len - off < PIECE ? len - off : PIECE);
+    }
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_Blob(&msg2, iov_pieces, npieces, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.data.len == size);
+    assert(memcmp(msg2.data.data, payload + skew, size) == 0);
+
+    return len;
+} /* roundtrip */
+
+static void
+bench(
+    int       size,
+    xdr_dbuf *dbuf)
+{
+    static uint64_t hot[HOT_SIZE / 8];
+    struct Blob     msg;
+    xdr_iovec       iov_split[2];
+    double          copy = 0, probe = 0, start;
+    uint64_t        sum = 0;
+    int             i, j, len, iters = 2000;
+
+    if (size > MAX_PAYLOAD) {
+        size = MAX_PAYLOAD;
+    }
+
+    for (j = 0; j < HOT_SIZE / 8; ++j) {
+        hot[j] = j;
+    }
+
+    len = roundtrip(size, 0, dbuf);
+
+    xdr_iovec_set_data(&iov_split[0], flat);
+    xdr_iovec_set_len(&iov_split[0], 9);
+    xdr_iovec_set_data(&iov_split[1], flat + 9);
+    xdr_iovec_set_len(&iov_split[1], len - 9);
+
+    for (i = 0; i < iters; ++i) {
+        start = now();
+        xdr_dbuf_reset(dbuf);
+        unmarshall_Blob(&msg, iov_split, 2, NULL, dbuf);
+        copy += now() - start;
+
+        /* Walk the working set the copy may have evicted */
+        start = now();
+        for (j = 0; j < HOT_SIZE / 8; j += 8) {
+            sum += hot[j];
+        }
+        probe += now() - start;
+    }
+
+    printf("payload %d bytes: spill %.1f MB/s, working set walk %.1f ns/line (%llu)\n",
+           size, (double) size * iters / copy / 1e6,
+           probe * 1e9 / iters / (HOT_SIZE / 64), (unsigned long long) sum);
+} /* bench */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    static const int sizes[] = { 0, 1, 15, 63, 64, 65, 4095, 200000,
+                                 300001, 1024 * 1024 + 3 };
+    xdr_dbuf        *dbuf;
+    int              i, skew;
+
+    dbuf = xdr_dbuf_alloc(4 * 1024 * 1024);
+
+    for (i = 0; i < MAX_PAYLOAD; ++i) {
+        payload[i] = i ^ (i >> 9);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? atoi(argv[2]) : 1024 * 1024, dbuf);
+        xdr_dbuf_free(dbuf);
+        return 0;
+    }
+
+    for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); ++i) {
+        for (skew = 0; skew < 4; ++skew) {
+            roundtrip(sizes[i], skew, dbuf);
+        }
+    }
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,5 @@
+struct Blob {
+    unsigned int id;
+    opaque       data<>;
+    string       name<>;
+};
@@ -0,0 +1,124 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "outofline_xdr.h"
+
+#define NUM_OPS 5
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Compound msg1, msg2;
+    struct Op       ops[NUM_OPS];
+    struct Big      big1, big2;
+    xdr_dbuf       *dbuf;
+    uint8_t         buffer[1024], flat[1024], expect[1024];
+    xdr_iovec       iov_in, iov_out[8], iov_flat;
+    int             i, rc, len, niov_out = 8, used;
+
+    /* Big is over the -O limit so Op and Inner only hold a pointer to it */
+    assert(sizeof(struct Op) < sizeof(struct Big));
+    assert(sizeof(struct Inner) < sizeof(struct Big));
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    for (i = 0; i < 8; ++i) {
+        big1.words[i] = 0x1000 + i;
+        big2.words[i] = 0x2000 + i;
+    }
+
+    xdr_set_str_static(&big1, name, "first", 5);
+    xdr_set_str_static(&big2, name, "second", 6);
+
+    ops[0].kind = KIND_NONE;
+
+    ops[1].kind  = KIND_SMALL;
+    ops[1].small = 42;
+
+    ops[2].kind = KIND_BIG;
+    ops[2].big  = &big1;
+
+    ops[3].kind       = KIND_INNER;
+    ops[3].inner.kind = KIND_BIG;
+    ops[3].inner.big  = &big2;
+
+    ops[4].kind        = KIND_INNER;
+    ops[4].inner.kind  = KIND_SMALL;
+    ops[4].inner.small = 7;
+
+    msg1.num_ops = NUM_OPS;
+    msg1.ops     = ops;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_Compound(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(expect + len, xdr_iovec_data(&iov_out[i]),
+               xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+    assert(len == 4 + 4 + (4 + 4) + (4 + 64 + 4 + 8) +
+           (4 + 4 + 64 + 4 + 8) + (4 + 4 + 4));
+    assert(marshall_length_Compound(&msg1) == len);
+
+    rc = marshall_flat_Compound(&msg1, flat, sizeof(flat));
+
+    assert(rc == len);
+    assert(memcmp(flat, expect, len) == 0);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Compound(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.num_ops == NUM_OPS);
+    assert(msg2.ops[0].kind == KIND_NONE);
+    assert(msg2.ops[1].kind == KIND_SMALL && msg2.ops[1].small == 42);
+
+    assert(msg2.ops[2].kind == KIND_BIG);
+    assert(msg2.ops[2].big->words[7] == 0x1007);
+    assert(msg2.ops[2].big->name.len == 5);
+    assert(memcmp(msg2.ops[2].big->name.str, "first", 5) == 0);
+
+    assert(msg2.ops[3].inner.kind == KIND_BIG);
+    assert(msg2.ops[3].inner.big->words[0] == 0x2000);
+    assert(msg2.ops[3].inner.big->name.len == 6);
+
+    assert(msg2.ops[4].inner.kind == KIND_SMALL);
+    assert(msg2.ops[4].inner.small == 7);
+
+    /* Only ops that carry a Big pay for one in dbuf */
+    xdr_dbuf_reset(dbuf);
+
+    msg1.num_ops = 2;
+
+    len = marshall_flat_Compound(&msg1, flat, sizeof(flat));
+
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_Compound(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+
+    used = dbuf->used;
+
+    assert(used < sizeof(struct Big));
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
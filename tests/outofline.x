@@ -0,0 +1,36 @@
+
+enum Kind {
+    KIND_NONE  = 0,
+    KIND_SMALL = 1,
+    KIND_BIG   = 2,
+    KIND_INNER = 3
+};
+
+struct Big {
+    uint64_t     words[8];
+    string       name<>;
+};
+
+union Inner switch (Kind kind) {
+ case KIND_SMALL:
+    unsigned int small;
+ case KIND_BIG:
+    Big          big;
+ default:
+    void;
+};
+
+union Op switch (Kind kind) {
+ case KIND_NONE:
+    void;
+ case KIND_SMALL:
+    unsigned int small;
+ case KIND_BIG:
+    Big          big;
+ case KIND_INNER:
+    Inner        inner;
+};
+
+struct Compound {
+    Op ops<>;
+};
@@ -0,0 +1,173 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "passthrough_xdr.h"
+
+#define NUM_ARGS   3
+#define WRITE_SIZE 1000
+
+static void
+build(
+    struct Compound *msg,
+    struct Arg      *args,
+    const char      *fh,
+    uint8_t         *payload)
+{
+    memset(msg, 0, sizeof(*msg));
+    memset(args, 0, sizeof(*args) * NUM_ARGS);
+
+    xdr_set_str_static(msg, tag, "proxy", 5);
+    msg->minor    = 2;
+    msg->num_args = NUM_ARGS;
+    msg->args     = args;
+
+    args[0].op              = OP_PUTFH;
+    args[0].putfh.fh.data   = (void *) fh;
+    args[0].putfh.fh.len    = strlen(fh);
+    args[1].op              = OP_READ;
+    args[1].read.offset     = 4096;
+    args[1].read.count      = 512;
+    args[2].op              = OP_WRITE;
+    args[2].write.offset    = 8192;
+    args[2].write.data.data = payload;
+    args[2].write.data.len  = WRITE_SIZE;
+} /* build */
+
+static int
+encode(
+    const struct Compound *msg,
+    uint8_t               *out,
+    xdr_iovec             *iov_out,
+    int                   *niov_out)
+{
+    static uint8_t buffer[4096];
+    xdr_iovec      iov_in;
+    int            i, rc, len;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_Compound(msg, &iov_in, iov_out, niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    for (i = 0, len = 0; i < *niov_out; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov_out[i]),
+               xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    return len;
+} /* encode */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Compound msg, fresh;
+    struct Arg      args[NUM_ARGS], fresh_args[NUM_ARGS];
+    xdr_dbuf       *dbuf;
+    uint8_t         payload[WRITE_SIZE], input[4096], flat[4096], out[4096];
+    xdr_iovec       iov_in[2], iov_out[16];
+    int             i, rc, len, flat_len, niov_out = 16, referenced = 0;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    for (i = 0; i < WRITE_SIZE; ++i) {
+        payload[i] = i * 7;
+    }
+
+    build(&msg, args, "original-handle", payload);
+
+    flat_len = marshall_flat_Compound(&msg, flat, sizeof(flat));
+
+    assert(flat_len > WRITE_SIZE);
+
+    /* Decode from two iovecs split in the middle of the READ */
+    memcpy(input, flat, flat_len);
+
+    xdr_iovec_set_data(&iov_in[0], input);
+    xdr_iovec_set_len(&iov_in[0], 60);
+    xdr_iovec_set_data(&iov_in[1], input + 60);
+    xdr_iovec_set_len(&iov_in[1], flat_len - 60);
+
+    rc = unmarshall_Compound(&msg, iov_in, 2, NULL, dbuf);
+
+    assert(rc == flat_len);
+    assert(msg.xdr_wire.range.length == flat_len);
+    assert(msg.xdr_wire.range.niov == 2);
+    assert(!msg.xdr_wire.dirty);
+
+    for (i = 0; i < NUM_ARGS; ++i) {
+        assert(msg.args[i].xdr_wire.range.length ==
+               marshall_length_Arg(&msg.args[i]));
+    }
+
+    assert(msg.args[0].putfh.xdr_wire.range.length == 4 + 16);
+    assert(marshall_length_Compound(&msg) == flat_len);
+
+    /* A clean message is replayed from the input, by reference */
+    len = encode(&msg, out, iov_out, &niov_out);
+
+    assert(len == flat_len);
+    assert(memcmp(out, flat, len) == 0);
+
+    for (i = 0; i < niov_out; ++i) {
+        if ((uint8_t *) xdr_iovec_data(&iov_out[i]) >= input &&
+            (uint8_t *) xdr_iovec_data(&iov_out[i]) < input + flat_len) {
+            referenced += xdr_iovec_len(&iov_out[i]);
+        }
+    }
+
+    assert(referenced == flat_len);
+
+    len = marshall_flat_Compound(&msg, out, sizeof(out));
+
+    assert(len == flat_len);
+    assert(memcmp(out, flat, len) == 0);
+
+    /* Rewriting the file handle dirties it and everything around it */
+    msg.args[0].putfh.fh.data = "replacement-handle-42";
+    msg.args[0].putfh.fh.len  = 21;
+
+    xdr_wire_dirty(&msg.args[0].putfh);
+    xdr_wire_dirty(&msg.args[0]);
+    xdr_wire_dirty(&msg);
+
+    build(&fresh, fresh_args, "replacement-handle-42", payload);
+
+    flat_len = marshall_flat_Compound(&fresh, flat, sizeof(flat));
+
+    assert(marshall_length_Compound(&msg) == flat_len);
+
+    niov_out = 16;
+    len      = encode(&msg, out, iov_out, &niov_out);
+
+    assert(len == flat_len);
+    assert(memcmp(out, flat, len) == 0);
+
+    len = marshall_flat_Compound(&msg, out, sizeof(out));
+
+    assert(len == flat_len);
+    assert(memcmp(out, flat, len) == 0);
+
+    /* Clean values are replayed even if their members were changed */
+    msg.args[1].read.count = 1;
+
+    len = marshall_flat_Compound(&msg, out, sizeof(out));
+
+    assert(len == flat_len);
+    assert(memcmp(out, flat, len) == 0);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
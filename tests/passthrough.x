@@ -0,0 +1,38 @@
+enum Op {
+    OP_PUTFH = 1,
+    OP_READ  = 2,
+    OP_WRITE = 3
+};
+
+const HANDLE_SIZE = 64;
+
+typedef opaque Handle<HANDLE_SIZE>;
+
+struct PutFh {
+    Handle fh;
+};
+
+struct Read {
+    uint64_t     offset;
+    unsigned int count;
+};
+
+struct Write {
+    uint64_t offset;
+    opaque   data<>;
+};
+
+union Arg switch (Op op) {
+ case OP_PUTFH:
+    PutFh putfh;
+ case OP_READ:
+    Read read;
+ case OP_WRITE:
+    Write write;
+};
+
+struct Compound {
+    string       tag<>;
+    unsigned int minor;
+    Arg          args<>;
+};
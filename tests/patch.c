@@ -0,0 +1,99 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "patch_xdr.h"
+
+_Static_assert(XDR_SIZE_Header == 8, "Header size");
+_Static_assert(XDR_SIZE_Seq == 20, "Seq size");
+_Static_assert(XDR_OFFSET_Reply_res == 24, "Reply res offset");
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Reply msg1, msg2;
+    xdr_dbuf    *dbuf;
+    uint8_t      buffer[256], flat[256];
+    xdr_iovec    iov_in, iov_out[4], iov[3];
+    int          rc, len, niov_out = 4;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    msg1.hdr.xid            = 1;
+    msg1.hdr.msgtype        = 1;
+    msg1.seqid              = 7;
+    msg1.delta              = 3;
+    msg1.cookie             = 0x1111111111111111ULL;
+    msg1.res.status         = STATUS_OK;
+    msg1.res.seq.clientid   = 0xabcdef;
+    msg1.res.seq.seqid      = 1;
+    msg1.trailer            = 0xfeed;
+    memcpy(msg1.res.seq.verifier, "verifier", 8);
+    xdr_set_str_static(&msg1, tag, "tag", 3);
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    len = marshall_Reply(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(len > 0 && niov_out == 1);
+
+    memcpy(flat, xdr_iovec_data(&iov_out[0]), len);
+
+    /* Split the encoding so that patched fields straddle iovecs */
+    xdr_iovec_set_data(&iov[0], flat);
+    xdr_iovec_set_len(&iov[0], 10);
+    xdr_iovec_set_data(&iov[1], flat + 10);
+    xdr_iovec_set_len(&iov[1], 9);
+    xdr_iovec_set_data(&iov[2], flat + 19);
+    xdr_iovec_set_len(&iov[2], len - 19);
+
+    rc = patch_Header_xid(iov, 3, XDR_OFFSET_Reply_hdr, 0xdeadbeef);
+    assert(rc == 0);
+
+    rc = patch_Reply_seqid(iov, 3, 0, 0x01020304);
+    assert(rc == 0);
+
+    rc = patch_Reply_delta(iov, 3, 0, -5);
+    assert(rc == 0);
+
+    rc = patch_Reply_cookie(iov, 3, 0, 0x0102030405060708ULL);
+    assert(rc == 0);
+
+    rc = patch_Seq_seqid(iov, 3, XDR_OFFSET_Reply_res + XDR_OFFSET_Res_seq, 99);
+    assert(rc == 0);
+
+    /* Patching past the end of the encoding fails without writing */
+    rc = patch_Reply_cookie(iov, 3, len - 4, 0);
+    assert(rc == -1);
+
+    rc = unmarshall_Reply(&msg2, iov, 3, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.hdr.xid == 0xdeadbeef);
+    assert(msg2.hdr.msgtype == 1);
+    assert(msg2.seqid == 0x01020304);
+    assert(msg2.delta == -5);
+    assert(msg2.cookie == 0x0102030405060708ULL);
+    assert(msg2.res.status == STATUS_OK);
+    assert(msg2.res.seq.clientid == 0xabcdef);
+    assert(msg2.res.seq.seqid == 99);
+    assert(memcmp(msg2.res.seq.verifier, "verifier", 8) == 0);
+    assert(msg2.tag.len == 3 && memcmp(msg2.tag.str, "tag", 3) == 0);
+    assert(msg2.trailer == 0xfeed);
+
+    /* A status patch alone turns the template into an error reply */
+    rc = patch_Res_status(iov, 3, XDR_OFFSET_Reply_res, STATUS_ERR);
+    assert(rc == 0);
+    assert(flat[XDR_OFFSET_Reply_res + 3] == STATUS_ERR);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,34 @@
+const SEQ_VERIFIER_SIZE = 8;
+
+enum Status {
+    STATUS_OK  = 0,
+    STATUS_ERR = 1
+};
+
+struct Header {
+    unsigned int xid;
+    unsigned int msgtype;
+};
+
+struct Seq {
+    uint64_t     clientid;
+    unsigned int seqid;
+    opaque       verifier[SEQ_VERIFIER_SIZE];
+};
+
+union Res switch (Status status) {
+ case STATUS_OK:
+    Seq seq;
+ default:
+    void;
+};
+
+struct Reply {
+    Header       hdr;
+    unsigned int seqid;
+    int          delta;
+    uint64_t     cookie;
+    Res          res;
+    string       tag<>;
+    unsigned int trailer;
+};
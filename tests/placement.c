@@ -0,0 +1,194 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "placement_xdr.h"
+
+struct placement_state {
+    int         calls;
+    int         result;
+    const char *member;
+    uint32_t    length;
+    uint8_t    *dest;
+};
+
+static int
+place(
+    const char *member,
+    uint32_t    length,
+    xdr_iovec  *iov,
+    void       *private_data)
+{
+    struct placement_state *state = private_data;
+
+    state->calls++;
+    state->member = member;
+    state->length = length;
+
+    if (state->result) {
+        return state->result;
+    }
+
+    xdr_iovec_set_data(iov, state->dest);
+    xdr_iovec_set_len(iov, 4096);
+
+    return 0;
+} /* place */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct WriteArgs       msg1, msg2;
+    struct placement_state state;
+    xdr_placement          placement;
+    xdr_dbuf              *dbuf;
+    static uint8_t         buffer[256], data[64], tail[4];
+    static uint8_t         wire[512] __attribute__((aligned(4096)));
+    static uint8_t         dest[4096] __attribute__((aligned(4096)));
+    xdr_iovec              iov_in, iov_out[8], iov_data, iov_tail, iov_split[2];
+    int                    i, rc, len, niov_out = 8;
+
+    dbuf = xdr_dbuf_alloc(16 * 1024);
+
+    for (i = 0; i < 64; ++i) {
+        data[i] = i;
+    }
+
+    memset(tail, 0xee, sizeof(tail));
+
+    xdr_iovec_set_data(&iov_data, data);
+    xdr_iovec_set_len(&iov_data, 63);
+    xdr_iovec_set_data(&iov_tail, tail);
+    xdr_iovec_set_len(&iov_tail, 0);
+
+    msg1.offset = 1234;
+    xdr_set_ref(&msg1, data, &iov_data, 1, 63);
+    xdr_set_ref(&msg1, tail, &iov_tail, 1, 0);
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_WriteArgs(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    /* Place the encoding so the payload lands 8 bytes into the page */
+    for (i = 0, len = 0; i < niov_out; ++i) {
+        memcpy(wire + len, xdr_iovec_data(&iov_out[i]), xdr_iovec_len(&iov_out[i]));
+        len += xdr_iovec_len(&iov_out[i]);
+    }
+
+    assert(len == rc);
+
+    placement.alignment    = 4096;
+    placement.place        = place;
+    placement.private_data = &state;
+
+    xdr_dbuf_set_placement(dbuf, &placement);
+
+    /* Misaligned payload is copied into the caller's buffer */
+    memset(&state, 0, sizeof(state));
+    memset(dest, 0, sizeof(dest));
+    state.dest = dest;
+
+    xdr_iovec_set_data(&iov_in, wire);
+    xdr_iovec_set_len(&iov_in, len);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(state.calls == 1);
+    assert(strcmp(state.member, "WriteArgs.data") == 0);
+    assert(state.length == 63);
+    assert(msg2.offset == 1234);
+    assert(msg2.data.length == 63 && msg2.data.niov == 1);
+    assert(xdr_iovec_data(msg2.data.iov) == dest);
+    assert(xdr_iovec_len(msg2.data.iov) == 63);
+    assert(memcmp(dest, data, 63) == 0);
+    assert(msg2.tail.length == 0);
+
+    /* Alignment already satisfied, payload is referenced in place */
+    placement.alignment = 8;
+    memset(&state, 0, sizeof(state));
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(state.calls == 0);
+    assert(xdr_iovec_data(msg2.data.iov) == wire + 8);
+
+    /* A payload split across input iovecs is gathered even if aligned */
+    xdr_iovec_set_data(&iov_split[0], wire);
+    xdr_iovec_set_len(&iov_split[0], 40);
+    xdr_iovec_set_data(&iov_split[1], wire + 40);
+    xdr_iovec_set_len(&iov_split[1], len - 40);
+
+    memset(&state, 0, sizeof(state));
+    memset(dest, 0, sizeof(dest));
+    state.dest = dest;
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_WriteArgs(&msg2, iov_split, 2, NULL, dbuf);
+
+    assert(rc == len);
+    assert(state.calls == 1);
+    assert(msg2.data.niov == 1 && xdr_iovec_data(msg2.data.iov) == dest);
+    assert(memcmp(dest, data, 63) == 0);
+    assert(msg2.tail.length == 0);
+
+    /* The callback may decline, leaving the payload referenced */
+    placement.alignment = 0;
+    memset(&state, 0, sizeof(state));
+    state.result = 1;
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(state.calls == 1);
+    assert(xdr_iovec_data(msg2.data.iov) == wire + 8);
+
+    /* Or fail the unmarshall */
+    memset(&state, 0, sizeof(state));
+    state.result = -1;
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == -1);
+
+    /* A length running past the end of the input fails the unmarshall */
+    placement.alignment = 4096;
+    memset(&state, 0, sizeof(state));
+    state.dest = dest;
+    xdr_dbuf_reset(dbuf);
+
+    xdr_iovec_set_len(&iov_in, 8 + 20);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == -1);
+    assert(state.calls == 1);
+
+    /* As does a payload starting exactly at the end of the input */
+    memset(&state, 0, sizeof(state));
+    state.dest = dest;
+    xdr_dbuf_reset(dbuf);
+
+    xdr_iovec_set_len(&iov_in, 8);
+
+    rc = unmarshall_WriteArgs(&msg2, &iov_in, 1, NULL, dbuf);
+
+    assert(rc == -1);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
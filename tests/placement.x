@@ -0,0 +1,5 @@
+struct WriteArgs {
+    unsigned int offset;
+    zcopaque     data<>;
+    zcopaque     tail<>;
+};
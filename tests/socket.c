@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/wait.h>
+
+#define XDR_SOCKET_WRITER
+#include "socket_xdr.h"
+
+#define PAYLOAD_CHUNK (64 * 1024)
+#define PAYLOAD_IOVS  4
+#define ROUNDS        2
+
+static int released;
+
+static void
+release(
+    xdr_iovec *iov,
+    void      *private_data)
+{
+    released++;
+} /* release */
+
+/* Child side: read each message in full and check it */
+static int
+receive(
+    int      fd,
+    uint8_t *pattern,
+    int      len)
+{
+    struct SocketMsg msg;
+    xdr_dbuf        *dbuf;
+    xdr_iovec        iov;
+    uint8_t         *buffer = malloc(len), *payload;
+    ssize_t          rc;
+    int              round, got, i, off;
+
+    dbuf = xdr_dbuf_alloc(PAYLOAD_CHUNK * PAYLOAD_IOVS + 4096);
+
+    for (round = 0; round < ROUNDS; ++round) {
+
+        for (got = 0; got < len; got += rc) {
+            rc = read(fd, buffer + got, len - got);
+            if (rc <= 0) {
+                return 1;
+            }
+        }
+
+        xdr_iovec_set_data(&iov, buffer);
+        xdr_iovec_set_len(&iov, len);
+
+        xdr_dbuf_reset(dbuf);
+
+        if (unmarshall_SocketMsg(&msg, &iov, 1, NULL, dbuf) != len ||
+            msg.seq != round ||
+            msg.data.length != PAYLOAD_CHUNK * PAYLOAD_IOVS) {
+            return 1;
+        }
+
+        for (i = 0, off = 0; i < msg.data.niov; ++i) {
+            payload = xdr_iovec_data(&msg.data.iov[i]);
+            if (memcmp(payload, pattern + off, xdr_iovec_len(&msg.data.iov[i]))) {
+                return 1;
+            }
+            off += xdr_iovec_len(&msg.data.iov[i]);
+        }
+    }
+
+    xdr_dbuf_free(dbuf);
+    free(buffer);
+
+    return 0;
+} /* receive */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct SocketMsg   msg;
+    struct sockaddr_in addr;
+    socklen_t          addrlen = sizeof(addr);
+    xdr_socket_writer  writer;
+    xdr_iovec          iov_in, iov_out[16], iov_data[PAYLOAD_IOVS];
+    uint8_t            scratch[256], *pattern;
+    int                listener, fd, i, len, niov_out, status, round;
+    pid_t              pid;
+
+    pattern = malloc(PAYLOAD_CHUNK * PAYLOAD_IOVS);
+
+    for (i = 0; i < PAYLOAD_CHUNK * PAYLOAD_IOVS; ++i) {
+        pattern[i] = i * 7;
+    }
+
+    for (i = 0; i < PAYLOAD_IOVS; ++i) {
+        xdr_iovec_set_data(&iov_data[i], pattern + i * PAYLOAD_CHUNK);
+        xdr_iovec_set_len(&iov_data[i], PAYLOAD_CHUNK);
+    }
+
+    xdr_set_str_static(&msg, name, "socket", 6);
+    xdr_set_ref(&msg, data, iov_data, PAYLOAD_IOVS, PAYLOAD_CHUNK * PAYLOAD_IOVS);
+
+    len = 4 + 4 + 8 + 4 + PAYLOAD_CHUNK * PAYLOAD_IOVS;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    assert(listener >= 0);
+    assert(bind(listener, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    assert(listen(listener, 1) == 0);
+    assert(getsockname(listener, (struct sockaddr *) &addr, &addrlen) == 0);
+
+    pid = fork();
+    assert(pid >= 0);
+
+    if (pid == 0) {
+        fd = accept(listener, NULL, NULL);
+        _exit(fd < 0 ? 1 : receive(fd, pattern, len));
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+
+    /* First round copies, second asks for MSG_ZEROCOPY where supported */
+    for (round = 0; round < ROUNDS; ++round) {
+
+        assert(xdr_socket_writer_init(&writer, fd,
+                                      round ? XDR_SOCKET_ZEROCOPY : 0,
+                                      4, release, NULL) == 0);
+
+        msg.seq  = round;
+        released = 0;
+        niov_out = 16;
+
+        xdr_iovec_set_data(&iov_in, scratch);
+        xdr_iovec_set_len(&iov_in, sizeof(scratch));
+
+        assert(marshall_SocketMsg(&msg, &iov_in, iov_out, &niov_out, NULL, 0) == len);
+
+        assert(xdr_socket_writev(&writer, iov_out, niov_out) == len);
+        assert(xdr_socket_writer_drain(&writer) == 0);
+        assert(xdr_socket_writer_pending(&writer) == 0);
+        assert(released == niov_out);
+
+        xdr_socket_writer_destroy(&writer);
+    }
+
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    close(fd);
+    close(listener);
+    free(pattern);
+
+    return 0;
+} /* main */
@@ -0,0 +1,5 @@
+struct SocketMsg {
+    unsigned int seq;
+    string       name<>;
+    zcopaque     data<>;
+};
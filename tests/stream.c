@@ -0,0 +1,170 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "stream_xdr.h"
+
+static int
+flatten(
+    uint8_t         *out,
+    const xdr_iovec *iov,
+    int              niov)
+{
+    int i, len = 0;
+
+    for (i = 0; i < niov; ++i) {
+        memcpy(out + len, xdr_iovec_data(&iov[i]), xdr_iovec_len(&iov[i]));
+        len += xdr_iovec_len(&iov[i]);
+    }
+
+    return len;
+} /* flatten */
+
+static int
+marshall_windowed(
+    const struct MyMsg *msg,
+    uint8_t            *out,
+    int                 window)
+{
+    xdr_marshall_stream stream;
+    uint8_t             scratch[64];
+    xdr_iovec           iov_in, iov_out[4];
+    int                 rc, niov, len = 0;
+
+    xdr_marshall_stream_init(&stream);
+
+    while (!xdr_marshall_stream_done(&stream)) {
+        xdr_iovec_set_data(&iov_in, scratch);
+        xdr_iovec_set_len(&iov_in, window);
+
+        niov = 4;
+
+        rc = marshall_stream_MyMsg(msg, &stream, &iov_in, iov_out, &niov, 0);
+
+        assert(rc > 0);
+        assert(rc <= window || niov > 1);
+
+        len += flatten(out + len, iov_out, niov);
+    }
+
+    return len;
+} /* marshall_windowed */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct MyMsg        msg1, msg2;
+    struct MyEntry      entries[50], *entry;
+    struct MyTree       tree[XDR_MAX_STREAM_DEPTH + 1];
+    xdr_marshall_stream stream;
+    xdr_dbuf           *dbuf;
+    uint8_t             buffer[4096], expect[4096], got[4096], data[100];
+    char                names[50][16];
+    xdr_iovec           iov_in, iov_out[8], iov_data, iov_flat;
+    uint32_t            words[10];
+    int                 i, rc, len, niov_out = 8, window;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    for (i = 0; i < 100; ++i) {
+        data[i] = i;
+    }
+
+    for (i = 0; i < 10; ++i) {
+        words[i] = i * 3;
+    }
+
+    for (i = 0; i < 50; ++i) {
+        snprintf(names[i], sizeof(names[i]), "entry%d", i);
+        entries[i].cookie = 1000 + i;
+        xdr_set_str_static(&entries[i], name, names[i], strlen(names[i]));
+        entries[i].nextentry = (i < 49) ? &entries[i + 1] : NULL;
+    }
+
+    msg1.value = 42;
+    xdr_set_str_static(&msg1, label, "label", 5);
+    memcpy(msg1.verifier, "abcdefgh", 8);
+    msg1.num_words = 10;
+    msg1.words     = words;
+    msg1.choice.kind = KIND_NAME;
+    xdr_set_str_static(&msg1.choice, name, "choice", 6);
+    msg1.entries = entries;
+
+    xdr_iovec_set_data(&iov_data, data);
+    xdr_iovec_set_len(&iov_data, 100);
+    xdr_set_ref(&msg1, data, &iov_data, 1, 99);
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_MyMsg(&msg1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc > 0);
+
+    len = flatten(expect, iov_out, niov_out);
+
+    assert(len == rc);
+
+    for (window = 8; window <= 64; window += 5) {
+        memset(got, 0, sizeof(got));
+        assert(marshall_windowed(&msg1, got, window) == len);
+        assert(memcmp(got, expect, len) == 0);
+    }
+
+    xdr_iovec_set_data(&iov_flat, got);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    rc = unmarshall_MyMsg(&msg2, &iov_flat, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(msg2.value == 42);
+    assert(msg2.num_words == 10 && msg2.words[9] == 27);
+    assert(msg2.choice.kind == KIND_NAME);
+    assert(msg2.choice.name.len == 6);
+    assert(msg2.data.length == 99);
+
+    for (i = 0, entry = msg2.entries; entry; entry = entry->nextentry, ++i) {
+        assert(entry->cookie == 1000 + i);
+        assert(memcmp(entry->name.str, names[i], entry->name.len) == 0);
+    }
+
+    assert(i == 50);
+
+    /* Nesting deeper than the stream can track fails rather than aborts */
+    for (i = 0; i <= XDR_MAX_STREAM_DEPTH; ++i) {
+        tree[i].value = i;
+        tree[i].left  = i < XDR_MAX_STREAM_DEPTH ? &tree[i + 1] : NULL;
+        tree[i].right = NULL;
+    }
+
+    xdr_marshall_stream_init(&stream);
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+    niov_out = 8;
+
+    rc = marshall_stream_MyTree(tree, &stream, &iov_in, iov_out, &niov_out, 0);
+
+    assert(rc == -1);
+
+    /* One level less still fits */
+    tree[XDR_MAX_STREAM_DEPTH - 1].left = NULL;
+
+    xdr_marshall_stream_init(&stream);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+    niov_out = 8;
+
+    rc = marshall_stream_MyTree(tree, &stream, &iov_in, iov_out, &niov_out, 0);
+
+    assert(rc == XDR_MAX_STREAM_DEPTH * 12);
+    assert(xdr_marshall_stream_done(&stream));
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,36 @@
+enum Kind {
+    KIND_NONE  = 0,
+    KIND_VALUE = 1,
+    KIND_NAME  = 2
+};
+
+union MyChoice switch (Kind kind) {
+ case KIND_VALUE:
+    unsigned int value;
+ case KIND_NAME:
+    string name;
+ default:
+    void;
+};
+
+struct MyEntry {
+    uint64_t cookie;
+    string   name<>;
+    MyEntry *nextentry;
+};
+
+struct MyTree {
+    unsigned int value;
+    MyTree      *left;
+    MyTree      *right;
+};
+
+struct MyMsg {
+    unsigned int value;
+    string       label<>;
+    opaque       verifier[8];
+    unsigned int words<>;
+    MyChoice     choice;
+    MyEntry     *entries;
+    zcopaque     data<>;
+};
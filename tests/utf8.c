@@ -0,0 +1,261 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+/*
+ * Checks UTF-8 validation of -u typedefs against a reference decoder,
+ * with sequences straddling vector blocks.  Run as "utf8 bench [bytes]"
+ * to compare decoding a long validated name with copying it.
+ */
+
+#include <assert.h>
+#include <time.h>
+
+#include "utf8_xdr.h"
+
+#define MAX_NAME (1024 * 1024)
+
+static uint8_t msg[MAX_NAME + 1024], name[MAX_NAME];
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* now */
+
+/* Decodes code points one at a time and checks their ranges */
+static int
+reference_valid(
+    const uint8_t *p,
+    int            len)
+{
+    uint32_t cp;
+    int      i = 0, n, k;
+
+    while (i < len) {
+        if (p[i] < 0x80) {
+            i++;
+            continue;
+        } else if ((p[i] & 0xe0) == 0xc0) {
+            n  = 1;
+            cp = p[i] & 0x1f;
+        } else if ((p[i] & 0xf0) == 0xe0) {
+            n  = 2;
+            cp = p[i] & 0x0f;
+        } else if ((p[i] & 0xf8) == 0xf0) {
+            n  = 3;
+            cp = p[i] & 0x07;
+        } else {
+            return 0;
+        }
+
+        if (i + n >= len) {
+            return 0;
+        }
+
+        for (k = 1; k <= n; ++k) {
+            if ((p[i + k] & 0xc0) != 0x80) {
+                return 0;
+            }
+            cp = (cp << 6) | (p[i + k] & 0x3f);
+        }
+
+        if ((n == 1 && cp < 0x80) || (n == 2 && cp < 0x800) ||
+            (n == 3 && cp < 0x10000) || cp > 0x10ffff ||
+            (cp >= 0xd800 && cp <= 0xdfff)) {
+            return 0;
+        }
+
+        i += n + 1;
+    }
+
+    return 1;
+} /* reference_valid */
+
+static int
+encode(
+    const uint8_t *s,
+    int            len,
+    int            split,
+    xdr_dbuf      *dbuf)
+{
+    struct Names names1, names2;
+    xdr_iovec    iov[2];
+    int          rc, total;
+
+    names1.name.str    = (char *) s;
+    names1.name.len    = len;
+    names1.owner.data  = (void *) s;
+    names1.owner.len   = len;
+    names1.raw.data    = (void *) s;
+    names1.raw.len     = len;
+
+    total = marshall_flat_Names(&names1, msg, sizeof(msg));
+
+    assert(total > 0);
+
+    xdr_iovec_set_data(&iov[0], msg);
+    xdr_iovec_set_len(&iov[0], split);
+    xdr_iovec_set_data(&iov[1], msg + split);
+    xdr_iovec_set_len(&iov[1], total - split);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_Names(&names2, iov, 2, NULL, dbuf);
+
+    if (rc < 0) {
+        return 0;
+    }
+
+    assert(rc == total);
+    assert(names2.name_hash == xdr_hash64(s, len));
+    assert(memcmp(names2.owner.data, s, len) == 0);
+
+    return 1;
+} /* encode */
+
+/* Checks one sequence at every offset across the vector blocks */
+static void
+check(
+    const char *s,
+    int         len,
+    int         valid,
+    xdr_dbuf   *dbuf)
+{
+    uint8_t buf[64];
+    int     prefix;
+
+    for (prefix = 0; prefix < 40; ++prefix) {
+        memset(buf, 'a', prefix);
+        memcpy(buf + prefix, s, len);
+        buf[prefix + len] = 'z';
+
+        assert(reference_valid(buf, prefix + len) == valid);
+        assert(encode(buf, prefix + len, 6, dbuf) == valid);
+        assert(encode(buf, prefix + len + 1, 4 + 4 + prefix + 1, dbuf) == valid);
+    }
+} /* check */
+
+static void
+bench(
+    int       size,
+    xdr_dbuf *dbuf)
+{
+    struct Names names;
+    xdr_iovec    iov;
+    double       checked = 0, copy = 0, start;
+    int          i, len, iters = 200;
+
+    if (size > MAX_NAME) {
+        size = MAX_NAME;
+    }
+
+    /* Two byte sequences, so the ASCII fast path never applies */
+    for (i = 0; i + 1 < size; i += 2) {
+        name[i]     = 0xc3;
+        name[i + 1] = 0xa9;
+    }
+
+    size = i;
+
+    names.name.str   = "";
+    names.name.len   = 0;
+    names.owner.data = name;
+    names.owner.len  = size;
+    names.raw.data   = "";
+    names.raw.len    = 0;
+
+    len = marshall_flat_Names(&names, msg, sizeof(msg));
+
+    xdr_iovec_set_data(&iov, msg);
+    xdr_iovec_set_len(&iov, len);
+
+    for (i = 0; i < iters; ++i) {
+        start = now();
+        xdr_dbuf_reset(dbuf);
+        assert(unmarshall_Names(&names, &iov, 1, NULL, dbuf) == len);
+        checked += now() - start;
+    }
+
+    /* A copy of the same bytes gives the memory speed to compare with */
+    for (i = 0; i < iters; ++i) {
+        start = now();
+        memcpy(msg, name, size);
+        copy += now() - start;
+    }
+
+    printf("name %d bytes: validated %.1f MB/s, memcpy %.1f MB/s (%d)\n",
+           size, (double) size * iters / checked / 1e6,
+           (double) size * iters / copy / 1e6, msg[size / 2]);
+} /* bench */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    static const uint8_t alphabet[] = {
+        'a', 0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0, 0xc1, 0xc2,
+        0xdf, 0xe0, 0xe1, 0xed, 0xee, 0xef, 0xf0, 0xf1, 0xf4, 0xf5, 0xff
+    };
+    xdr_dbuf            *dbuf;
+    uint8_t              buf[48];
+    int                  i, j, len, valid, nvalid = 0;
+
+    dbuf = xdr_dbuf_alloc(4 * MAX_NAME);
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        bench(argc > 2 ? atoi(argv[2]) : MAX_NAME, dbuf);
+        xdr_dbuf_free(dbuf);
+        return 0;
+    }
+
+    check("", 0, 1, dbuf);
+    check("\xc3\xa9", 2, 1, dbuf);
+    check("\xe2\x82\xac", 3, 1, dbuf);
+    check("\xf0\x9d\x84\x9e", 4, 1, dbuf);
+    check("\xed\x9f\xbf\xee\x80\x80", 6, 1, dbuf);
+    check("\xf4\x8f\xbf\xbf", 4, 1, dbuf);
+    check("\xc0\x80", 2, 0, dbuf);
+    check("\xc1\xbf", 2, 0, dbuf);
+    check("\xe0\x80\x80", 3, 0, dbuf);
+    check("\xe0\x9f\xbf", 3, 0, dbuf);
+    check("\xed\xa0\x80", 3, 0, dbuf);
+    check("\xf0\x80\x80\x80", 4, 0, dbuf);
+    check("\xf0\x8f\xbf\xbf", 4, 0, dbuf);
+    check("\xf4\x90\x80\x80", 4, 0, dbuf);
+    check("\xf5\x80\x80\x80", 4, 0, dbuf);
+    check("\xff", 1, 0, dbuf);
+    check("\x80", 1, 0, dbuf);
+    check("\xc3\xa9\xa9", 3, 0, dbuf);
+    check("\xe2\x82", 2, 0, dbuf);
+    check("\xf0\x9d\x84", 3, 0, dbuf);
+
+    /* Random mixes of interesting bytes */
+    srand(1);
+
+    for (i = 0; i < 20000; ++i) {
+        len = rand() % sizeof(buf);
+
+        for (j = 0; j < len; ++j) {
+            buf[j] = alphabet[rand() % sizeof(alphabet)];
+        }
+
+        valid   = reference_valid(buf, len);
+        nvalid += valid;
+
+        assert(encode(buf, len, 4 + 4 + rand() % (len + 1), dbuf) == valid);
+    }
+
+    assert(nvalid > 100);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
@@ -0,0 +1,8 @@
+typedef string component4<>;
+typedef opaque utf8string<>;
+
+struct Names {
+    component4 name;
+    utf8string owner;
+    opaque     raw<>;
+};
@@ -0,0 +1,243 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "view_xdr.h"
+
+#define NUM_BODIES 4
+#define NUM_ITEMS  3
+#define NUM_PIECES 64
+
+static void
+set_name(
+    xdr_string *str,
+    char       *value)
+{
+    str->str = value;
+    str->len = strlen(value);
+} /* set_name */
+
+static int
+is_name(
+    const xdr_string *str,
+    const char       *value)
+{
+    return str->len == strlen(value) && memcmp(str->str, value, str->len) == 0;
+} /* is_name */
+
+static void
+check_msg(
+    struct view_Msg *view,
+    int              contiguous)
+{
+    struct view_Pair pair;
+    struct view_Body body;
+    struct view_Item item;
+    xdr_opaque       opaque;
+    xdr_string       name;
+    uint32_t         num, value, kind;
+    uint64_t         wide;
+    int32_t          delta;
+    float            ratio;
+
+    /* Read back to front so that the offset cache fills in one pass */
+    assert(view_Msg_get_trailer(view, &value) == 0 && value == 0xfeedf00d);
+    assert(view->known == 10);
+
+    assert(view_Msg_get_ratio(view, &ratio) == 0 && ratio == 2.5f);
+    assert(view_Msg_get_xid(view, &value) == 0 && value == 0x1234);
+    assert(view_Msg_get_delta(view, &delta) == 0 && delta == -5);
+
+    assert(view_Msg_get_fixed(view, &pair) == 0);
+    assert(view_Pair_get_a(&pair, &value) == 0 && value == 1);
+    assert(view_Pair_get_b(&pair, &wide) == 0 && wide == 0x0102030405060708ULL);
+
+    assert(view_Msg_get_body(view, &body) == 0);
+    assert(view_Body_get_kind(&body, &kind) == 0 && kind == KIND_NUM);
+    assert(view_Body_get_num(&body, &wide) == 0 && wide == 99);
+    assert(view_Body_get_label(&body, &name) == 1);
+    assert(view_Body_get_code(&body, &value) == 1);
+
+    assert(view_Msg_count_words(view, &num) == 0 && num == 3);
+    assert(view_Msg_get_words(view, 2, &value) == 0 && value == 30);
+    assert(view_Msg_get_words(view, 3, &value) == -1);
+
+    assert(view_Msg_count_pairs(view, &num) == 0 && num == 2);
+    assert(view_Msg_get_pairs(view, 1, &pair) == 0);
+    assert(view_Pair_get_b(&pair, &wide) == 0 && wide == 22);
+
+    assert(view_Msg_count_bodies(view, &num) == 0 && num == NUM_BODIES);
+    assert(view_Msg_get_bodies(view, 0, &body) == 0);
+    assert(view_Body_get_kind(&body, &kind) == 0 && kind == KIND_NONE);
+    assert(view_Body_get_num(&body, &wide) == 1);
+    assert(view_Msg_get_bodies(view, 2, &body) == 0);
+    assert(view_Body_get_pair(&body, &pair) == 0);
+    assert(view_Pair_get_a(&pair, &value) == 0 && value == 5);
+    assert(view_Msg_get_bodies(view, 3, &body) == 0);
+    assert(view_Body_get_kind(&body, &kind) == 0 && kind == 77);
+    assert(view_Body_get_code(&body, &value) == 0 && value == 0x77);
+    assert(view_Body_length(&body) == 8);
+
+    /* Walk the list, each element's next follows it */
+    assert(view_Msg_get_items(view, &item) == 0);
+
+    for (num = 0; num < NUM_ITEMS; ++num) {
+        assert(view_Item_get_value(&item, &value) == 0 && value == 100 + num);
+        if (num + 1 < NUM_ITEMS) {
+            assert(view_Item_get_next(&item, &item) == 0);
+        }
+    }
+
+    assert(view_Item_get_next(&item, &item) == 1);
+
+    assert(view_Msg_get_opt(view, &pair) == 1);
+
+    if (contiguous) {
+        assert(view_Msg_get_magic(view, &opaque) == 0);
+        assert(opaque.len == 8 && memcmp(opaque.data, "magic!!!", 8) == 0);
+        assert(view_Msg_get_handle(view, &opaque) == 0);
+        assert(opaque.len == 5 && memcmp(opaque.data, "hndl!", 5) == 0);
+
+        assert(view_Msg_get_bodies(view, 1, &body) == 0);
+        assert(view_Body_get_label(&body, &name) == 0 && is_name(&name, "label"));
+
+        assert(view_Msg_get_items(view, &item) == 0);
+        assert(view_Item_get_name(&item, &name) == 0 && is_name(&name, "first"));
+    }
+} /* check_msg */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Msg      msg;
+    struct Body     bodies[NUM_BODIES];
+    struct Item     items[NUM_ITEMS];
+    struct Pair     pairs[2], opt;
+    struct view_Msg view;
+    uint32_t        words[3] = { 10, 20, 30 }, value;
+    uint8_t         flat[1024];
+    xdr_iovec       iov_flat, pieces[NUM_PIECES];
+    int             i, len;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(bodies, 0, sizeof(bodies));
+
+    msg.xid     = 0x1234;
+    msg.fixed.a = 1;
+    msg.fixed.b = 0x0102030405060708ULL;
+    memcpy(msg.magic, "magic!!!", 8);
+    msg.handle.data = "hndl!";
+    msg.handle.len  = 5;
+    msg.delta       = -5;
+
+    msg.body.kind = KIND_NUM;
+    msg.body.num  = 99;
+
+    msg.num_words = 3;
+    msg.words     = words;
+
+    pairs[0].a    = 11;
+    pairs[0].b    = 11;
+    pairs[1].a    = 22;
+    pairs[1].b    = 22;
+    msg.num_pairs = 2;
+    msg.pairs     = pairs;
+
+    bodies[0].kind   = KIND_NONE;
+    bodies[1].kind   = KIND_NAME;
+    set_name(&bodies[1].label, "label");
+    bodies[2].kind   = KIND_PAIR;
+    bodies[2].pair.a = 5;
+    bodies[2].pair.b = 6;
+    bodies[3].kind   = 77;
+    bodies[3].code   = 0x77;
+    msg.num_bodies   = NUM_BODIES;
+    msg.bodies       = bodies;
+
+    for (i = 0; i < NUM_ITEMS; ++i) {
+        items[i].value = 100 + i;
+        items[i].next  = i + 1 < NUM_ITEMS ? &items[i + 1] : NULL;
+    }
+
+    set_name(&items[0].name, "first");
+    set_name(&items[1].name, "second");
+    set_name(&items[2].name, "third");
+    msg.items = items;
+
+    msg.opt     = NULL;
+    msg.ratio   = 2.5f;
+    msg.trailer = 0xfeedf00d;
+
+    len = marshall_flat_Msg(&msg, flat, sizeof(flat));
+
+    assert(len > 0);
+
+    xdr_iovec_set_data(&iov_flat, flat);
+    xdr_iovec_set_len(&iov_flat, len);
+
+    view_Msg_init(&view, &iov_flat, 1, 0);
+
+    assert(view_Msg_length(&view) == len);
+
+    check_msg(&view, 1);
+
+    /* Scalars and nested views are read across iovec boundaries */
+    assert(len <= NUM_PIECES * 7);
+
+    for (i = 0; i * 7 < len; ++i) {
+        xdr_iovec_set_data(&pieces[i], flat + i * 7);
+        xdr_iovec_set_len(&pieces[i], len - i * 7 < 7 ? len - i * 7 : 7);
+    }
+
+    view_Msg_init(&view, pieces, i, 0);
+
+    assert(view_Msg_length(&view) == len);
+
+    check_msg(&view, 0);
+
+    /* Views see the wire as it is, there is no decoded copy */
+    flat[3] = 0x56;
+
+    view_Msg_init(&view, &iov_flat, 1, 0);
+
+    assert(view_Msg_get_xid(&view, &value) == 0 && value == 0x1256);
+
+    /* A present optional, and a view at an offset */
+    opt.a   = 7;
+    opt.b   = 8;
+    msg.opt = &opt;
+
+    len = marshall_flat_Msg(&msg, flat + 12, sizeof(flat) - 12);
+
+    xdr_iovec_set_len(&iov_flat, len + 12);
+
+    view_Msg_init(&view, &iov_flat, 1, 12);
+
+    assert(view_Msg_length(&view) == len);
+
+    {
+        struct view_Pair pair;
+
+        assert(view_Msg_get_opt(&view, &pair) == 0);
+        assert(view_Pair_get_a(&pair, &value) == 0 && value == 7);
+    }
+
+    assert(view_Msg_get_trailer(&view, &value) == 0 && value == 0xfeedf00d);
+
+    /* Truncated data is reported rather than read past */
+    xdr_iovec_set_len(&iov_flat, len + 12 - 4);
+
+    view_Msg_init(&view, &iov_flat, 1, 12);
+
+    assert(view_Msg_length(&view) == -1);
+    assert(view_Msg_get_trailer(&view, &value) == -1);
+    assert(view_Msg_get_xid(&view, &value) == 0);
+
+    return 0;
+} /* main */
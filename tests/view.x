@@ -0,0 +1,48 @@
+enum Kind {
+    KIND_NONE = 0,
+    KIND_NUM  = 1,
+    KIND_NAME = 2,
+    KIND_PAIR = 3
+};
+
+typedef string Name<>;
+
+struct Pair {
+    unsigned int a;
+    uint64_t     b;
+};
+
+union Body switch (Kind kind) {
+ case KIND_NONE:
+    void;
+ case KIND_NUM:
+    uint64_t num;
+ case KIND_NAME:
+    Name label;
+ case KIND_PAIR:
+    Pair pair;
+ default:
+    unsigned int code;
+};
+
+struct Item {
+    Name         name;
+    unsigned int value;
+    Item        *next;
+};
+
+struct Msg {
+    unsigned int xid;
+    Pair         fixed;
+    opaque       magic[8];
+    opaque       handle<64>;
+    int          delta;
+    Body         body;
+    unsigned int words<>;
+    Pair         pairs<>;
+    Body         bodies<>;
+    Item        *items;
+    Pair        *opt;
+    float        ratio;
+    unsigned int trailer;
+};
@@ -0,0 +1,179 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Ben Jarvis
+ *
+ * SPDX-License-Identifier: LGPL
+ */
+
+#include <assert.h>
+
+#include "wirestruct_xdr.h"
+
+#define NUM_IDS 37
+
+static uint8_t *
+put32(
+    uint8_t *p,
+    uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+    return p + 4;
+} /* put32 */
+
+static uint8_t *
+put64(
+    uint8_t *p,
+    uint64_t v)
+{
+    return put32(put32(p, v >> 32), v);
+} /* put64 */
+
+int
+main(
+    int   argc,
+    char *argv[])
+{
+    struct Holder   holder1, holder2;
+    struct fsid4    ids[NUM_IDS];
+    struct Mixed    mixed[2];
+    struct nfstime4 times[2];
+    xdr_dbuf       *dbuf;
+    xdr_iovec       iov_in, iov_out[8], iov_split[3];
+    uint8_t         buffer[4096], expect[4096], out[4096], *p;
+    uint64_t        bits;
+    uint32_t        fbits;
+    int             i, rc, len, niov_out = 8;
+
+    dbuf = xdr_dbuf_alloc(64 * 1024);
+
+    for (i = 0; i < NUM_IDS; ++i) {
+        ids[i].major = 0x0102030405060708ULL * (i + 1);
+        ids[i].minor = ~(uint64_t) i;
+    }
+
+    for (i = 0; i < 3; ++i) {
+        holder1.samples[i].id    = 100 + i;
+        holder1.samples[i].value = 1.5f * i;
+    }
+
+    mixed[0].big   = 3.25;
+    mixed[0].small = 7;
+    mixed[0].color = BLUE;
+    mixed[1].big   = -1e300;
+    mixed[1].small = 0xdeadbeef;
+    mixed[1].color = RED;
+
+    times[0].seconds  = -5;
+    times[0].nseconds = 999;
+    times[1].seconds  = 0x7fffffffffffLL;
+    times[1].nseconds = 1;
+
+    holder1.num_ids   = NUM_IDS;
+    holder1.ids       = ids;
+    holder1.num_mixed = 2;
+    holder1.mixed     = mixed;
+    holder1.num_times = 2;
+    holder1.times     = times;
+
+    /* Reference encoding, field by field */
+    p = put32(expect, NUM_IDS);
+
+    for (i = 0; i < NUM_IDS; ++i) {
+        p = put64(put64(p, ids[i].major), ids[i].minor);
+    }
+
+    for (i = 0; i < 3; ++i) {
+        memcpy(&fbits, &holder1.samples[i].value, 4);
+        p = put32(put32(p, holder1.samples[i].id), fbits);
+    }
+
+    p = put32(p, 2);
+
+    for (i = 0; i < 2; ++i) {
+        memcpy(&bits, &mixed[i].big, 8);
+        p = put32(put32(put64(p, bits), mixed[i].small), mixed[i].color);
+    }
+
+    p = put32(p, 2);
+
+    for (i = 0; i < 2; ++i) {
+        p = put32(put64(p, times[i].seconds), times[i].nseconds);
+    }
+
+    len = p - expect;
+
+    xdr_iovec_set_data(&iov_in, buffer);
+    xdr_iovec_set_len(&iov_in, sizeof(buffer));
+
+    rc = marshall_Holder(&holder1, &iov_in, iov_out, &niov_out, NULL, 0);
+
+    assert(rc == len);
+    assert(niov_out == 1);
+    assert(memcmp(xdr_iovec_data(&iov_out[0]), expect, len) == 0);
+
+    rc = marshall_flat_Holder(&holder1, out, sizeof(out));
+
+    assert(rc == len && memcmp(out, expect, len) == 0);
+
+    assert(marshall_flat_Holder(&holder1, out, len - 1) == -1);
+
+    /* Contiguous input is swapped straight out of the iovec */
+    xdr_iovec_set_data(&iov_split[0], expect);
+    xdr_iovec_set_len(&iov_split[0], len);
+
+    rc = unmarshall_Holder(&holder2, iov_split, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(holder2.num_ids == NUM_IDS);
+    assert(memcmp(holder2.ids, ids, sizeof(ids)) == 0);
+    assert(holder2.samples[2].id == 102 && holder2.samples[2].value == 3.0f);
+    assert(holder2.num_mixed == 2);
+    assert(holder2.mixed[0].big == 3.25 && holder2.mixed[0].color == BLUE);
+    assert(holder2.mixed[1].big == -1e300 && holder2.mixed[1].small == 0xdeadbeef);
+    assert(holder2.num_times == 2);
+    assert(holder2.times[0].seconds == -5 && holder2.times[1].nseconds == 1);
+
+    /* Input split inside elements is gathered and swapped in place */
+    xdr_iovec_set_data(&iov_split[0], expect);
+    xdr_iovec_set_len(&iov_split[0], 13);
+    xdr_iovec_set_data(&iov_split[1], expect + 13);
+    xdr_iovec_set_len(&iov_split[1], NUM_IDS * 16 + 11 - 13);
+    xdr_iovec_set_data(&iov_split[2], expect + NUM_IDS * 16 + 11);
+    xdr_iovec_set_len(&iov_split[2], len - NUM_IDS * 16 - 11);
+
+    xdr_dbuf_reset(dbuf);
+    memset(&holder2, 0, sizeof(holder2));
+
+    rc = unmarshall_Holder(&holder2, iov_split, 3, NULL, dbuf);
+
+    assert(rc == len);
+    assert(memcmp(holder2.ids, ids, sizeof(ids)) == 0);
+    assert(holder2.samples[0].id == 100 && holder2.samples[1].value == 1.5f);
+    assert(holder2.mixed[1].big == -1e300 && holder2.mixed[1].color == RED);
+
+    /* Empty vectors */
+    holder1.num_ids   = 0;
+    holder1.num_mixed = 0;
+    holder1.num_times = 0;
+
+    len = marshall_flat_Holder(&holder1, out, sizeof(out));
+
+    assert(len == 4 + 3 * 8 + 4 + 4);
+
+    xdr_iovec_set_data(&iov_split[0], out);
+    xdr_iovec_set_len(&iov_split[0], len);
+
+    xdr_dbuf_reset(dbuf);
+
+    rc = unmarshall_Holder(&holder2, iov_split, 1, NULL, dbuf);
+
+    assert(rc == len);
+    assert(holder2.num_ids == 0 && holder2.num_mixed == 0);
+    assert(holder2.samples[1].id == 101);
+
+    xdr_dbuf_free(dbuf);
+
+    return 0;
+} /* main */
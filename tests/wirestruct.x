@@ -0,0 +1,33 @@
+enum Color {
+    RED  = 0,
+    BLUE = 1
+};
+
+struct fsid4 {
+    uint64_t major;
+    uint64_t minor;
+};
+
+struct Sample {
+    unsigned int id;
+    float        value;
+};
+
+struct Mixed {
+    double       big;
+    unsigned int small;
+    Color        color;
+};
+
+/* Padded in C, so converted an element at a time */
+struct nfstime4 {
+    int64_t      seconds;
+    unsigned int nseconds;
+};
+
+struct Holder {
+    fsid4    ids<>;
+    Sample   samples[3];
+    Mixed    mixed<>;
+    nfstime4 times<>;
+};